@@ -0,0 +1,164 @@
+const fs = require("fs");
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { loadRuntime } = require("./wasm-runtime");
+
+const buildDir = pathlib.resolve(__dirname, "../build");
+// same as the view in ViewRenderer.ts
+const tileSize = 32;
+const viewWidth = 41;
+const viewHeight = 25;
+// a made up atlas of atlasTiles x atlasTiles sprites
+const atlasTiles = 16;
+// about how many cells a turn changes
+const dirtyCells = 24;
+
+function parseArgs(argv) {
+    const args = {
+        frames: 1000,
+        seed: 1
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const value = argv[i + 1];
+        switch (argv[i]) {
+            case "--frames": args.frames = parseInt(value, 10); i++; break;
+            case "--seed": args.seed = parseInt(value, 10); i++; break;
+            default:
+                console.error(`Unknown argument ${argv[i]}`);
+                console.error("usage: composite.js [--frames n] [--seed n]");
+                process.exit(1);
+        }
+    }
+    return args;
+}
+
+// present hands the pixels to the canvas as an ImageData, node has neither
+global.ImageData = class ImageData {
+    constructor(data, width, height) {
+        this.data = data;
+        this.width = width;
+        this.height = height;
+    }
+};
+
+function stubCanvas() {
+    return {
+        width: viewWidth * tileSize,
+        height: viewHeight * tileSize,
+        getContext: () => ({ putImageData() {} })
+    };
+}
+
+function stubSprites(random) {
+    const size = atlasTiles * tileSize;
+    const data = new Uint8ClampedArray(size * size * 4);
+    for (let i = 0; i < data.length; i++) {
+        data[i] = random() * 256;
+    }
+    return {
+        loaded: true,
+        getSheetPixels: () => ({ width: size, height: size, data }),
+        getSprite: id => ({
+            x: (id % atlasTiles) * tileSize,
+            y: Math.floor(id / atlasTiles) * tileSize,
+            w: tileSize,
+            h: tileSize
+        })
+    };
+}
+
+function lcg(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+        return state / 4294967296;
+    };
+}
+
+// draws one cell the way ViewRenderer.present does for the three kinds of cells
+function drawCell(backend, random, x, y) {
+    const px = x * tileSize;
+    const py = y * tileSize;
+    const sprite = () => Math.floor(random() * atlasTiles * atlasTiles);
+    const kind = random();
+    backend.clear(px, py, tileSize, tileSize);
+    if (kind < 0.2) {
+        // unexplored
+        return;
+    }
+    if (kind < 0.5) {
+        // remembered
+        backend.setAlpha(0.5);
+        backend.fill(px, py, tileSize, tileSize, "rgb(20,12,28)");
+        backend.sprite(sprite(), px, py);
+        backend.setAlpha(1);
+        return;
+    }
+    backend.fill(px, py, tileSize, tileSize, "rgb(20,12,28)");
+    backend.sprite(sprite(), px, py);
+    if (kind > 0.9) {
+        // an entity with its health bar
+        backend.sprite(sprite(), px, py);
+        const barWidth = Math.floor(tileSize * random());
+        backend.fill(px, py + tileSize - 3, barWidth, 3, "rgb(0,255,0)");
+        backend.fill(px + barWidth, py + tileSize - 3, tileSize - barWidth, 3, "rgb(255,0,0)");
+    }
+}
+
+function measure(frames, frame) {
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < frames; i++) {
+        frame(i);
+    }
+    return Number(process.hrtime.bigint() - start) / 1e6 / frames;
+}
+
+async function main() {
+    const args = parseArgs(process.argv.slice(2));
+    const wasm = await WebAssembly.compile(fs.readFileSync(pathlib.join(buildDir, "digital-fov.wasm")));
+    await loadRuntime(buildDir, wasm);
+    const { CompositorBackend } = await import(pathToFileURL(pathlib.join(buildDir, "CompositorBackend.js")).href);
+    const random = lcg(args.seed);
+    const backend = new CompositorBackend(stubCanvas(), stubSprites(random));
+
+    const repaint = () => {
+        for (let x = 0; x < viewWidth; x++) {
+            for (let y = 0; y < viewHeight; y++) {
+                drawCell(backend, random, x, y);
+            }
+        }
+        backend.present();
+    };
+    // warm up the atlas upload and the jit
+    repaint();
+    const report = {
+        view: `${viewWidth}x${viewHeight}`,
+        frames: args.frames,
+        // every cell drawn again
+        repaintMs: measure(args.frames, repaint),
+        // the cells of a usual turn
+        dirtyMs: measure(args.frames, () => {
+            for (let i = 0; i < dirtyCells; i++) {
+                drawCell(backend, random, Math.floor(random() * viewWidth), Math.floor(random() * viewHeight));
+            }
+            backend.present();
+        }),
+        // the camera followed a step, the exposed column is drawn
+        scrollMs: measure(args.frames, i => {
+            const dx = i % 2 === 0 ? 1 : -1;
+            backend.scroll(-dx * tileSize, 0);
+            const x = dx > 0 ? viewWidth - 1 : 0;
+            for (let y = 0; y < viewHeight; y++) {
+                drawCell(backend, random, x, y);
+            }
+            backend.present();
+        })
+    };
+    backend.dispose();
+    console.log(JSON.stringify(report, null, 2));
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
@@ -39,6 +39,30 @@ function makeTypes(data, rootName) {
     return result;
 }
 
+// sprite ids are assigned in input order, NUM_SPRITES is one past the last
+function makeSpriteEnum(sheetMeta) {
+    const names = Object.keys(sheetMeta);
+    let result = "declare const enum SpriteId {\n";
+    result += names.map((name, id) => `  ${name} = ${id}`).join(",\n");
+    result += `,\n  NUM_SPRITES = ${names.length}`;
+    result += "\n}\n";
+    return result;
+}
+
+// x, y, w, h of every sprite as little endian int32s, indexed by sprite id
+function makeAtlas(sheetMeta) {
+    const names = Object.keys(sheetMeta);
+    const stride = 4;
+    const atlas = Buffer.alloc(names.length * stride * Int32Array.BYTES_PER_ELEMENT);
+    names.forEach((name, id) => {
+        const {x, y, w, h} = sheetMeta[name];
+        [x, y, w, h].forEach((value, i) => {
+            atlas.writeInt32LE(value, (id * stride + i) * Int32Array.BYTES_PER_ELEMENT);
+        });
+    });
+    return atlas;
+}
+
 async function makeMeta(filenames) {
     const sheetMeta = {};
     let ox = 0;
@@ -79,6 +103,8 @@ async function main(inputFile, outputFile, outputTypeFile) {
         writes.push(sheetWrite);
         const metaWrite = write(`${outDirPath}/${outFileBasename}.json`, JSON.stringify(await sheetMeta));
         writes.push(metaWrite);
+        const atlasWrite = write(`${outDirPath}/${outFileBasename}.atlas`, makeAtlas(await sheetMeta));
+        writes.push(atlasWrite);
     }
     
     if (outputTypeFile) {
@@ -88,7 +114,7 @@ async function main(inputFile, outputFile, outputTypeFile) {
         if (typeRootname.endsWith(".d")) {
             typeRootname = typeRootname.slice(0, -2);
         }
-        const sheetTypes = makeTypes(await sheetMeta, typeRootname);
+        const sheetTypes = makeTypes(await sheetMeta, typeRootname) + "\n" + makeSpriteEnum(await sheetMeta);
         const typesWrite = write(outTypeFilePath, sheetTypes);
         writes.push(typesWrite);
     }
@@ -106,9 +132,10 @@ Usage:
         files to use for the spritesheet.
   -o output-file
         Path to output file.
-        Can be .gif or .json, both will be output regardless.
+        Can be .gif, .json or .atlas, all will be output regardless.
   -t output-type-file
         Path to output TypeScript typings file.
+        Also declares the SpriteId enum.
 
 The -i option is required. At least one of -o or -t must be specified.
 `
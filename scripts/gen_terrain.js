@@ -0,0 +1,117 @@
+const fs = require("fs");
+const pathlib = require("path");
+
+// the kernels index their table with a byte
+const maxKinds = 256;
+
+// bit of every flag, in both outputs
+const flags = [
+    {name: "Opaque", key: "opaque", bit: 1},
+    {name: "BlocksMovement", key: "blocksMovement", bit: 2}
+];
+
+function flagsOf(terrain) {
+    return flags.reduce((value, flag) => terrain[flag.key] === true ? value | flag.bit : value, 0);
+}
+
+// StoneWall -> STONE_WALL
+function cName(name) {
+    return name.replace(/([a-z0-9])([A-Z])/g, "$1_$2").toUpperCase();
+}
+
+function makeHeader(kinds, inputFile) {
+    let result = `/* generated by scripts/${pathlib.basename(__filename)} from ${inputFile}, do not edit */\n\n`;
+    result += "#ifndef TERRAIN_H\n#define TERRAIN_H\n\n";
+    result += "/* TerrainKind in terrainKinds.ts */\nenum terrain_kind\n{\n";
+    result += kinds.map((terrain, kind) => `  T_${cName(terrain.kind)} = ${kind}`).join(",\n");
+    result += "\n};\n\n";
+    result += `#define TERRAIN_KINDS ${kinds.length}\n`;
+    result += `#define TERRAIN_TABLE_SIZE ${maxKinds}\n`;
+    result += flags.map(flag => `#define TERRAIN_${cName(flag.name)} ${flag.bit}\n`).join("");
+    result += "\n/* flags of every terrain kind, unused kinds have none */\n";
+    result += "static const unsigned char terrain_flags[TERRAIN_TABLE_SIZE] =\n{\n";
+    result += "  " + kinds.map(flagsOf).join(", ");
+    result += "\n};\n\n#endif\n";
+    return result;
+}
+
+function makeModule(kinds, inputFile) {
+    let result = `// generated by scripts/${pathlib.basename(__filename)} from ${inputFile}, do not edit\n\n`;
+    result += "export enum TerrainKind {\n";
+    result += kinds.map(terrain => `    ${terrain.kind}`).join(",\n");
+    result += "\n}\n\n";
+    result += "export const enum TerrainFlag {\n";
+    result += flags.map(flag => `    ${flag.name} = ${flag.bit}`).join(",\n");
+    result += "\n}\n\n";
+    result += "// flags of every terrain kind, indexed by kind\n";
+    result += `export const terrainFlags = new Uint8Array([${kinds.map(flagsOf).join(", ")}]);\n`;
+    return result;
+}
+
+function printHelp() {
+    console.error(
+`${pathlib.basename(__filename)}
+Usage:
+
+  -i input-file
+        Path to a JSON file listing the terrain kinds in order
+        and their properties.
+  -c output-header
+        Path to the C header for the kernels.
+  -t output-module
+        Path to the TypeScript module with TerrainKind,
+        TerrainFlag and the flags of every kind.
+
+The -i option is required. At least one of -c or -t must be specified.
+`
+    );
+}
+
+function exitFail() {
+    printHelp();
+    process.exit(1);
+}
+
+function parseArgs() {
+    const args = process.argv.slice(2);
+    if (args.length < 1 || args.find(arg => arg === "-h" || arg === "--help")) {
+        exitFail();
+    }
+    const opts = {
+        i: null,
+        c: null,
+        t: null
+    };
+    for (let i = 0; i < args.length; i += 2) {
+        const opt = args[i].replace(/^-/, "");
+        if (!(opt in opts) || args[i + 1] === undefined) {
+            console.error("Unknown option: " + args[i]);
+            exitFail();
+        }
+        opts[opt] = args[i + 1];
+    }
+    if (opts.i === null) {
+        console.error("No input-file specified.");
+        exitFail();
+    } else if (opts.c === null && opts.t === null) {
+        console.error("No output-header or output-module specified.");
+        exitFail();
+    }
+    return [opts.i, opts.c, opts.t];
+}
+
+function main(inputFile, headerFile, moduleFile) {
+    const kinds = JSON.parse(fs.readFileSync(inputFile, "utf8"));
+    if (kinds.length > maxKinds) {
+        console.error(`${inputFile} has ${kinds.length} terrain kinds, the kernels take at most ${maxKinds}`);
+        process.exit(1);
+    }
+    if (headerFile) {
+        fs.writeFileSync(headerFile, makeHeader(kinds, inputFile));
+    }
+    if (moduleFile) {
+        fs.writeFileSync(moduleFile, makeModule(kinds, inputFile));
+    }
+}
+
+main(...parseArgs());
@@ -0,0 +1,166 @@
+const fs = require("fs");
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { loadRuntime } = require("./wasm-runtime");
+
+const buildDir = pathlib.resolve(__dirname, "../build");
+
+function parseArgs(argv) {
+    const args = {
+        games: 20,
+        maxRounds: 500,
+        seed: 1,
+        // player turns between two checks
+        every: 5,
+        // random cells near the monsters asked about at every check
+        cells: 200
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const value = argv[i + 1];
+        switch (argv[i]) {
+            case "--games": args.games = parseInt(value, 10); i++; break;
+            case "--max-rounds": args.maxRounds = parseInt(value, 10); i++; break;
+            case "--seed": args.seed = parseInt(value, 10); i++; break;
+            case "--every": args.every = parseInt(value, 10); i++; break;
+            case "--cells": args.cells = parseInt(value, 10); i++; break;
+            default:
+                console.error(`Unknown argument ${argv[i]}`);
+                console.error("usage: perception.js [--games n] [--max-rounds n] [--seed n] [--every turns] [--cells n]");
+                process.exit(1);
+        }
+    }
+    return args;
+}
+
+function import_(name) {
+    return import(pathToFileURL(pathlib.join(buildDir, name)).href);
+}
+
+function lcg(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+        return state / 4294967296;
+    };
+}
+
+function sameSet(a, b) {
+    return a.length === b.length && a.every(x => b.includes(x));
+}
+
+function names(entities) {
+    return entities.map(e => `${e.constructor.name}#${e.id}`).join(", ");
+}
+
+// Compares what Perception derives from the FOVs of the humans with
+// what every monster sees in an FOV of its own.
+class Checker {
+    constructor(modules, random) {
+        this.modules = modules;
+        this.random = random;
+        this.checks = 0;
+        this.cells = 0;
+        this.mismatches = [];
+    }
+
+    error(text) {
+        if (this.mismatches.length < 20) {
+            this.mismatches.push(text);
+        }
+    }
+
+    check(game, numCells) {
+        const { Human, Visibility } = this.modules;
+        const level = game.level;
+        const observers = game.perception.observers(level);
+        const monsters = level.entities.filter(e =>
+            !(e instanceof Human) && e.location !== undefined && e.vision !== undefined);
+        // computed here instead of through Vision so the game does not see any difference
+        const fovs = monsters.map(m => level.getFieldOfViewAt(m.location.x, m.location.y, m.vision.fovRadius));
+        const sees = (i, x, y) => {
+            const {x: mx, y: my} = monsters[i].location;
+            const r = monsters[i].vision.fovRadius;
+            const fx = x - mx + r;
+            const fy = y - my + r;
+            return fx >= 0 && fx <= 2 * r && fy >= 0 && fy <= 2 * r &&
+                fovs[i].columns[fx][fy] === Visibility.Visible;
+        };
+        const where = `seed ${game.rng.seed} round ${game.round} depth ${level.depth}`;
+        this.checks++;
+
+        monsters.forEach((monster, i) => {
+            const expected = observers.filter(o => sees(i, o.location.x, o.location.y));
+            const actual = game.perception.observersSeenBy(monster);
+            if (!sameSet(expected, actual)) {
+                this.error(`${where}: ${names([monster])} sees [${names(expected)}], observersSeenBy gave [${names(actual)}]`);
+            }
+        });
+
+        const cells = observers.map(o => [o.location.x, o.location.y]);
+        for (let n = 0; n < numCells && monsters.length > 0; n++) {
+            const monster = monsters[Math.floor(this.random() * monsters.length)];
+            const r = monster.vision.fovRadius;
+            const x = monster.location.x + Math.floor(this.random() * (2 * r + 1)) - r;
+            const y = monster.location.y + Math.floor(this.random() * (2 * r + 1)) - r;
+            if (level.withinBounds(x, y)) {
+                cells.push([x, y]);
+            }
+        }
+        for (const [x, y] of cells) {
+            const expected = monsters.filter((_, i) => sees(i, x, y));
+            const actual = game.perception.seersOf(level, x, y);
+            this.cells++;
+            if (!sameSet(expected, actual)) {
+                this.error(`${where}: cell ${x}, ${y} is seen by [${names(expected)}], seersOf gave [${names(actual)}]`);
+            }
+        }
+        for (const fov of fovs) {
+            fov.dispose();
+        }
+    }
+}
+
+async function main() {
+    const args = parseArgs(process.argv.slice(2));
+    const wasm = await WebAssembly.compile(fs.readFileSync(pathlib.join(buildDir, "digital-fov.wasm")));
+    await loadRuntime(buildDir, wasm);
+    const { Game } = await import_("Game.js");
+    const { Human } = await import_("entities/Human.js");
+    const { Visibility } = await import_("fov.js");
+    const { Profiler } = await import_("Profiler.js");
+    const checker = new Checker({ Human, Visibility }, lcg(args.seed));
+
+    for (let seed = args.seed; seed < args.seed + args.games; seed++) {
+        const game = new Game({seed, headless: true, aiPlayer: true, maxRounds: args.maxRounds});
+        let turns = 0;
+        // the end of a player turn is the one place the game stops at between actions
+        Profiler.enable(() => {
+            if (++turns % args.every === 0) {
+                checker.check(game, args.cells);
+            }
+        });
+        try {
+            await game.run();
+        } finally {
+            Profiler.disable();
+        }
+        game.dispose();
+        process.stderr.write(`\r${seed - args.seed + 1}/${args.games}`);
+    }
+    process.stderr.write("\n");
+
+    console.log(JSON.stringify({
+        games: args.games,
+        checks: checker.checks,
+        cells: checker.cells,
+        mismatches: checker.mismatches
+    }, null, 2));
+    if (checker.mismatches.length > 0) {
+        process.exit(1);
+    }
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
@@ -0,0 +1,25 @@
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { parentPort, workerData } = require("worker_threads");
+const { loadRuntime } = require("./wasm-runtime");
+
+const buildDir = workerData.buildDir;
+
+async function main() {
+    await loadRuntime(buildDir, workerData.wasm);
+    const { simulateGame } = await import(pathToFileURL(pathlib.join(buildDir, "Simulation.js")).href);
+    parentPort.on("message", async seed => {
+        try {
+            const result = await simulateGame(seed, workerData.maxRounds);
+            parentPort.postMessage({seed, result});
+        } catch (err) {
+            parentPort.postMessage({seed, error: err.stack || String(err)});
+        }
+    });
+    parentPort.postMessage("ready");
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
@@ -0,0 +1,99 @@
+const fs = require("fs");
+const os = require("os");
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { Worker } = require("worker_threads");
+
+const buildDir = pathlib.resolve(__dirname, "../build");
+
+function parseArgs(argv) {
+    const args = {
+        games: 1000,
+        maxRounds: 2000,
+        workers: os.cpus().length,
+        seed: 1,
+        out: null
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const value = argv[i + 1];
+        switch (argv[i]) {
+            case "--games": args.games = parseInt(value, 10); i++; break;
+            case "--max-rounds": args.maxRounds = parseInt(value, 10); i++; break;
+            case "--workers": args.workers = parseInt(value, 10); i++; break;
+            case "--seed": args.seed = parseInt(value, 10); i++; break;
+            case "--out": args.out = value; i++; break;
+            default:
+                console.error(`Unknown argument ${argv[i]}`);
+                console.error("usage: simulate.js [--games n] [--max-rounds n] [--workers n] [--seed n] [--out report.json]");
+                process.exit(1);
+        }
+    }
+    return args;
+}
+
+// Every worker takes the next seed as soon as it is done with a game,
+// so a few long games do not hold up a whole share of the batch.
+function runBatch(wasm, seeds, args) {
+    return new Promise((resolve, reject) => {
+        const results = [];
+        let next = 0;
+        let running = 0;
+        const numWorkers = Math.max(Math.min(args.workers, seeds.length), 1);
+        for (let i = 0; i < numWorkers; i++) {
+            const worker = new Worker(pathlib.join(__dirname, "simulate-worker.js"), {
+                workerData: {wasm, buildDir, maxRounds: args.maxRounds}
+            });
+            running++;
+            const feed = () => {
+                if (next < seeds.length) {
+                    worker.postMessage(seeds[next++]);
+                } else {
+                    worker.terminate();
+                }
+            };
+            worker.on("message", msg => {
+                if (msg !== "ready") {
+                    if (msg.error !== undefined) {
+                        console.error(`Game ${msg.seed} failed: ${msg.error}`);
+                    } else {
+                        results.push(msg.result);
+                        process.stderr.write(`\r${results.length}/${seeds.length}`);
+                    }
+                }
+                feed();
+            });
+            worker.on("error", reject);
+            worker.on("exit", () => {
+                running--;
+                if (running === 0) {
+                    process.stderr.write("\n");
+                    resolve(results);
+                }
+            });
+        }
+    });
+}
+
+async function main() {
+    const args = parseArgs(process.argv.slice(2));
+    // compiled once here, the workers only instantiate it
+    const wasm = await WebAssembly.compile(fs.readFileSync(pathlib.join(buildDir, "digital-fov.wasm")));
+    const { batchSeeds, summarize } = await import(pathToFileURL(pathlib.join(buildDir, "SimulationStats.js")).href);
+    const seeds = batchSeeds(args.seed, args.games);
+    const start = Date.now();
+    const results = await runBatch(wasm, seeds, args);
+    const order = new Map(seeds.map((seed, i) => [seed, i]));
+    results.sort((a, b) => order.get(a.seed) - order.get(b.seed));
+    const report = summarize(results, args.workers, Date.now() - start);
+    const json = JSON.stringify(report, null, 2);
+    if (args.out === null) {
+        console.log(json);
+    } else {
+        fs.writeFileSync(args.out, json);
+    }
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
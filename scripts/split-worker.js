@@ -0,0 +1,21 @@
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { parentPort, workerData } = require("worker_threads");
+const { loadRuntime } = require("./wasm-runtime");
+
+const buildDir = workerData.buildDir;
+
+// the game worker of the page, with the port of worker_threads instead of the worker scope
+async function main() {
+    await loadRuntime(buildDir, workerData.wasm);
+    const { serveGame } = await import(pathToFileURL(pathlib.join(buildDir, "GameWorker.js")).href);
+    const { keyboard, finished } = serveGame(workerData.init, parentPort);
+    parentPort.on("message", keyPress => keyboard.press(keyPress));
+    await finished;
+    process.exit(0);
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
@@ -0,0 +1,180 @@
+const fs = require("fs");
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+const { Worker } = require("worker_threads");
+
+const buildDir = pathlib.resolve(__dirname, "../build");
+// same as the view in ViewRenderer.ts
+const viewWidth = 41;
+const viewHeight = 25;
+
+function parseArgs(argv) {
+    const args = {
+        seed: 1,
+        maxRounds: 500,
+        channelSize: 1 << 20,
+        post: false
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const value = argv[i + 1];
+        switch (argv[i]) {
+            case "--seed": args.seed = parseInt(value, 10); i++; break;
+            case "--max-rounds": args.maxRounds = parseInt(value, 10); i++; break;
+            case "--channel-size": args.channelSize = parseInt(value, 10); i++; break;
+            case "--post": args.post = true; break;
+            default:
+                console.error(`Unknown argument ${argv[i]}`);
+                console.error("usage: split.js [--seed n] [--max-rounds n] [--channel-size bytes] [--post]");
+                process.exit(1);
+        }
+    }
+    return args;
+}
+
+// Stands in for GameClient: keeps the same mirror of the view as ViewRenderer
+// and counts every delta that does not fit what was sent before it.
+class StubRenderer {
+    constructor() {
+        this.cameraX = 0;
+        this.cameraY = 0;
+        this.entities = new Map();
+        this.finished = false;
+        this.frames = 0;
+        this.bytes = 0;
+        this.largestFrame = 0;
+        this.counts = {view: 0, repaint: 0, cell: 0, entityMove: 0, entityHealth: 0, entityRemove: 0, message: 0, menu: 0};
+        this.errors = [];
+    }
+
+    inView(x, y) {
+        const vx = x - this.cameraX + (viewWidth - 1) / 2;
+        const vy = y - this.cameraY + (viewHeight - 1) / 2;
+        return vx >= 0 && vx < viewWidth && vy >= 0 && vy < viewHeight;
+    }
+
+    error(text) {
+        if (this.errors.length < 20) {
+            this.errors.push(`frame ${this.frames}: ${text}`);
+        }
+    }
+
+    frame(bytes, decodeFrame) {
+        this.frames++;
+        this.bytes += bytes.length;
+        this.largestFrame = Math.max(this.largestFrame, bytes.length);
+        decodeFrame(bytes, this);
+    }
+
+    view(cameraX, cameraY, repaint) {
+        this.counts.view++;
+        this.cameraX = cameraX;
+        this.cameraY = cameraY;
+        if (repaint) {
+            this.counts.repaint++;
+            this.entities.clear();
+        }
+    }
+
+    cell(x, y) {
+        this.counts.cell++;
+        if (!this.inView(x, y)) { this.error(`cell ${x}, ${y} out of view`); }
+    }
+
+    entityMove(id, sprite, x, y) {
+        this.counts.entityMove++;
+        if (!this.inView(x, y)) { this.error(`entity ${id} moved out of view to ${x}, ${y}`); }
+        this.entities.set(id, {x, y, sprite});
+    }
+
+    entityHealth(id, fraction) {
+        this.counts.entityHealth++;
+        if (!this.entities.has(id)) { this.error(`health of unknown entity ${id}`); }
+        if (!(fraction >= 0 && fraction <= 1)) { this.error(`health of entity ${id} is ${fraction}`); }
+    }
+
+    entityRemove(id) {
+        this.counts.entityRemove++;
+        if (!this.entities.delete(id)) { this.error(`removed unknown entity ${id}`); }
+    }
+
+    message() {
+        this.counts.message++;
+    }
+
+    menu() {
+        this.counts.menu++;
+    }
+
+    gameOver() {
+        this.finished = true;
+    }
+}
+
+async function main() {
+    const args = parseArgs(process.argv.slice(2));
+    const wasm = await WebAssembly.compile(fs.readFileSync(pathlib.join(buildDir, "digital-fov.wasm")));
+    const { decodeFrame } = await import(pathToFileURL(pathlib.join(buildDir, "RenderDelta.js")).href);
+    const { createRenderChannel, RenderChannelReader } = await import(pathToFileURL(pathlib.join(buildDir, "RenderChannel.js")).href);
+    const channel = args.post ? null : createRenderChannel(args.channelSize);
+    const reader = channel !== null ? new RenderChannelReader(channel) : null;
+    const stub = new StubRenderer();
+    const init = {wasmBuild: "digital-fov.js", seed: args.seed, aiPlayer: true, maxRounds: args.maxRounds, channel};
+    const worker = new Worker(pathlib.join(__dirname, "split-worker.js"), {workerData: {wasm, buildDir, init}});
+    const start = Date.now();
+    let maxUsed = 0;
+
+    await new Promise((resolve, reject) => {
+        // the main thread of the page reads once per animation frame
+        const poll = () => {
+            if (reader !== null) {
+                maxUsed = Math.max(maxUsed, reader.used);
+                let frame;
+                while ((frame = reader.read()) !== null) {
+                    stub.frame(frame, decodeFrame);
+                }
+            }
+            if (stub.finished) {
+                resolve();
+            } else {
+                setTimeout(poll, 16);
+            }
+        };
+        worker.on("message", msg => {
+            if (msg.error !== undefined) {
+                reject(new Error(msg.error));
+            } else if (msg.frame !== undefined) {
+                stub.frame(msg.frame, decodeFrame);
+            }
+        });
+        worker.on("error", reject);
+        worker.on("exit", code => {
+            // frames still in the channel are read by the next poll
+            setTimeout(() => {
+                if (!stub.finished) {
+                    reject(new Error(`Game worker exited with ${code} before the game ended`));
+                }
+            }, 100);
+        });
+        poll();
+    });
+    await worker.terminate();
+
+    const report = {
+        transport: reader !== null ? "channel" : "postMessage",
+        ms: Date.now() - start,
+        frames: stub.frames,
+        bytes: stub.bytes,
+        largestFrame: stub.largestFrame,
+        maxChannelUsed: reader !== null ? maxUsed : null,
+        records: stub.counts,
+        visibleEntitiesAtEnd: stub.entities.size,
+        errors: stub.errors
+    };
+    console.log(JSON.stringify(report, null, 2));
+    process.exit(stub.errors.length === 0 ? 0 : 1);
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
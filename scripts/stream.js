@@ -0,0 +1,171 @@
+const pathlib = require("path");
+const { pathToFileURL } = require("url");
+
+const buildDir = pathlib.resolve(__dirname, "../build");
+// Overflow is a const enum, the compiled module has no object for it
+const DropOldest = 0;
+const Backpressure = 1;
+
+// lets every pending promise callback run
+function settle() {
+    return new Promise(resolve => setImmediate(resolve));
+}
+
+async function isPending(promise) {
+    let done = false;
+    promise.then(() => { done = true; }, () => { done = true; });
+    await settle();
+    return !done;
+}
+
+function same(actual, expected) {
+    return JSON.stringify(actual) === JSON.stringify(expected);
+}
+
+// a consumer driven one item at a time, it subscribes with the first next
+function consumer(iterable) {
+    return iterable[Symbol.asyncIterator]();
+}
+
+async function takeValues(iterator, count) {
+    const values = [];
+    for (let i = 0; i < count; i++) {
+        values.push((await iterator.next()).value);
+    }
+    return values;
+}
+
+const cases = {
+    async broadcast(AsyncStream) {
+        const stream = new AsyncStream(false, 8);
+        const a = consumer(stream);
+        const b = consumer(stream);
+        const firstA = a.next();
+        const firstB = b.next();
+        for (let i = 0; i < 5; i++) {
+            stream.add(i);
+        }
+        const valuesA = [(await firstA).value, ...await takeValues(a, 4)];
+        const valuesB = [(await firstB).value, ...await takeValues(b, 4)];
+        return same(valuesA, [0, 1, 2, 3, 4]) && same(valuesB, [0, 1, 2, 3, 4]);
+    },
+
+    async dropOldest(AsyncStream) {
+        const stream = new AsyncStream(true, 4, DropOldest);
+        const slow = consumer(stream);
+        const first = slow.next();
+        stream.add(0);
+        await first;
+        for (let i = 1; i <= 9; i++) {
+            if (!stream.add(i)) { return false; }
+        }
+        // 1 to 5 were overwritten before the consumer took them
+        return stream.dropped === 5 && same(await takeValues(slow, 4), [6, 7, 8, 9]);
+    },
+
+    async backpressure(AsyncStream) {
+        const stream = new AsyncStream(true, 4, Backpressure);
+        const slow = consumer(stream);
+        const first = slow.next();
+        for (let i = 0; i < 4; i++) {
+            stream.add(i);
+        }
+        await first;
+        // the consumer took 0 and releases it as the only one, so there is room for 4
+        if (!stream.add(4) || stream.add(5)) { return false; }
+        const put = stream.put(5);
+        if (!await isPending(put)) { return false; }
+        const taken = await takeValues(slow, 1);
+        return await put && same(taken, [1]) && same(await takeValues(slow, 4), [2, 3, 4, 5]);
+    },
+
+    async batches(AsyncStream) {
+        const stream = new AsyncStream(true, 16);
+        for (let i = 0; i < 10; i++) {
+            stream.add(i);
+        }
+        const batches = consumer({[Symbol.asyncIterator]: () => stream.batches(4)});
+        const taken = await takeValues(batches, 3);
+        const next = batches.next();
+        stream.add(10);
+        stream.add(11);
+        taken.push((await next).value);
+        return same(taken, [[0, 1, 2, 3], [4, 5, 6, 7], [8, 9], [10, 11]]);
+    },
+
+    // the slowest consumer leaving frees the ring for a waiting put
+    async unsubscribeWakesPut(AsyncStream) {
+        const stream = new AsyncStream(true, 4, Backpressure);
+        const fast = consumer(stream);
+        const slow = consumer(stream);
+        const firstFast = fast.next();
+        const firstSlow = slow.next();
+        for (let i = 0; i < 4; i++) {
+            stream.add(i);
+        }
+        await firstFast;
+        await firstSlow;
+        // both took 0, the slow one stops there
+        if (!stream.add(4)) { return false; }
+        await takeValues(fast, 4);
+        const put = stream.put(5);
+        if (!await isPending(put)) { return false; }
+        await slow.return();
+        return await isPending(put) === false && await put && same(await takeValues(fast, 1), [5]);
+    },
+
+    // without consumers an unbuffered stream keeps nothing, a waiting put gives up
+    async unsubscribeRefusesPut(AsyncStream) {
+        const stream = new AsyncStream(false, 4, Backpressure);
+        const only = consumer(stream);
+        const first = only.next();
+        for (let i = 0; i < 4; i++) {
+            stream.add(i);
+        }
+        await first;
+        stream.add(4);
+        const put = stream.put(5);
+        if (!await isPending(put)) { return false; }
+        await only.return();
+        return await isPending(put) === false && !await put && stream.consumerCount === 0;
+    },
+
+    async terminate(AsyncStream) {
+        const full = new AsyncStream(true, 2, Backpressure);
+        full.add(0);
+        full.add(1);
+        const put = full.put(2);
+        const empty = new AsyncStream(true, 2);
+        const waiting = consumer(empty).next();
+        if (!await isPending(put) || !await isPending(waiting)) { return false; }
+        full.terminate();
+        empty.terminate();
+        return !await put && (await waiting).done;
+    }
+};
+
+async function main() {
+    const { AsyncStream } = await import(pathToFileURL(pathlib.join(buildDir, "AsyncStream.js")).href);
+    const failed = [];
+    for (const name of Object.keys(cases)) {
+        let ok;
+        try {
+            ok = await cases[name](AsyncStream);
+        } catch (err) {
+            console.error(err);
+            ok = false;
+        }
+        console.log(`${ok ? "ok" : "FAILED"} ${name}`);
+        if (!ok) {
+            failed.push(name);
+        }
+    }
+    if (failed.length > 0) {
+        process.exit(1);
+    }
+}
+
+main().catch(err => {
+    console.error(err);
+    process.exit(1);
+});
@@ -0,0 +1,24 @@
+const fs = require("fs");
+const pathlib = require("path");
+const vm = require("vm");
+
+// Loads the emscripten glue as a classic script so that its Module is the global
+// the game expects, instantiating the module the parent thread already compiled.
+function loadRuntime(buildDir, wasm) {
+    return new Promise(resolve => {
+        global.Module = {
+            instantiateWasm(imports, receiveInstance) {
+                WebAssembly.instantiate(wasm, imports)
+                    .then(instance => receiveInstance(instance, wasm));
+                return {};
+            },
+            onRuntimeInitialized: resolve
+        };
+        global.require = require;
+        global.__dirname = buildDir;
+        const filename = pathlib.join(buildDir, "digital-fov.js");
+        vm.runInThisContext(fs.readFileSync(filename, "utf8"), {filename});
+    });
+}
+
+module.exports = { loadRuntime };
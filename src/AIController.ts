@@ -1,24 +1,45 @@
 import { Action } from "./actions/Action";
 import { ActionFactory } from "./actions/ActionFactory";
+import { ChaseKind, chaseStep, IntentKind } from "./AIPlan";
+import { ByteReader, ByteWriter } from "./ByteBuffer";
+import { Controlled } from "./components/Controlled";
 import { Location } from "./components/Location";
 import { Vision } from "./components/Vision";
 import { ControllerKind, IController } from "./Controller";
 import { Bind } from "./decorators";
 import { Entity } from "./entities/Entity";
 import { Human } from "./entities/Human";
+import { findById, Id } from "./Id";
 import { Visibility } from "./fov";
 import { Game, GameEventTopic } from "./Game";
-import { distance, Vec2 } from "./geometry";
-import { blindPath, drunkWalk } from "./pathfinding";
-import { isNotNull } from "./utils";
+import { Vec2 } from "./geometry";
+import { BlindPath, drunkWalk } from "./pathfinding";
+import { isDefined, isNotNull } from "./utils";
+
+// what the actor decided to do ahead of its turn, see AIPlanner
+export interface Intent {
+    // where the actor was when it decided
+    readonly x: number;
+    readonly y: number;
+    readonly kind: IntentKind;
+    readonly dx: number;
+    readonly dy: number;
+    readonly target: Id | null;
+}
+
+const noId = -1;
+
+// a wandering actor moves on all but the last of every wanderCycle turns and rests on that one
+export const wanderCycle = 2;
 
 export class AIController extends IController {
     public readonly kind = ControllerKind.AI;
 
     private attackTarget: Entity | null = null;
     private wanderTarget: Vec2 | null = null;
-    private wanderPath: IterableIterator<Vec2> | null = null;
+    private wanderPath: BlindPath | null = null;
     private wanderCounter: number = 0;
+    private intent: Intent | null = null;
 
     constructor(game: Game, actor: Entity) {
         super(game, actor);
@@ -32,10 +53,27 @@ export class AIController extends IController {
         }
     }
 
+    // humans fight everything else that acts
+    private isEnemy(entity: Entity): boolean {
+        return entity !== this.actor &&
+            entity.hasComponent(Controlled.Component) &&
+            (entity instanceof Human) !== (this.actor instanceof Human);
+    }
+
     private findNewAttackTarget(): Entity | null {
         if (!this.actor.hasComponents(Location.Component, Vision.Component)) {
             return null;
         }
+        if (!(this.actor instanceof Human)) {
+            // monsters notice the player side through its FOV instead of their own
+            for (const observer of this.game.perception.observersSeenBy(this.actor)) {
+                if (this.isEnemy(observer)) {
+                    return observer;
+                }
+            }
+            return null;
+        }
+        // the FOV of a human is the one perception is derived from anyway
         const {dungeonLevel: level, x, y} = this.actor.location;
         const {fov, fovRadius: r} = this.actor.vision;
         for (let fx = 0; fx < fov.width; fx++) {
@@ -47,7 +85,7 @@ export class AIController extends IController {
                     const dy = y + fy - r;
                     const entities = level.entitiesAt(dx, dy);
                     for (const entity of entities) {
-                        if (entity instanceof Human) {
+                        if (this.isEnemy(entity)) {
                             return entity;
                         }
                     }
@@ -70,35 +108,34 @@ export class AIController extends IController {
             return null;
         }
         const {dungeonLevel: level, x, y} = this.actor.location;
-        const {pathmap} = target.location;
-        const dir = pathmap.getNextDirection(x, y);
-        if (dir === null) { return null; }
-        const [dx, dy] = dir;
-        const nx = x + dx;
-        const ny = y + dy;
-        // standing next to target
-        if (distance(x, y, nx, ny) < 2 && level.entitiesAt(nx, ny).includes(target)) {
-            return ActionFactory.createAttackAction(dx, dy);
-        }
-        if (pathmap.reachesTarget) {
-            // lose target if it's too far
-            const dist = pathmap.distanceAt(nx, ny);
-            if (dist > this.actor.vision.fovRadius * 1.5) {
+        // the pathmap and the cells it steps to are on the level of the target
+        const {dungeonLevel: targetLevel, pathmap, x: tx, y: ty} = target.location;
+        const step = chaseStep(pathmap, pathmap.reachesTarget, targetLevel, x, y, tx, ty, this.actor.vision.fovRadius);
+        const {dx, dy} = step;
+        let kind = step.kind;
+        // a target on another level only seems to stand next to the actor
+        if (kind === ChaseKind.Attack && targetLevel !== level) {
+            kind = pathmap.reachesTarget ? ChaseKind.Approach : ChaseKind.Stagger;
+        }
+        switch (kind) {
+            case ChaseKind.Blocked:
+                return null;
+            case ChaseKind.GiveUp:
                 this.attackTarget = null;
                 return null;
-            }
-            // move towards
-            return ActionFactory.createMoveAction(dx, dy);
+            case ChaseKind.Attack:
+                return ActionFactory.createAttackAction(dx, dy);
+            case ChaseKind.Approach:
+                return ActionFactory.createMoveAction(dx, dy);
+        }
+        // can sense target but can't find path
+        // drunkWalk slowly
+        let drunkDir: Vec2 | null;
+        if (++this.wanderCounter >= wanderCycle || (drunkDir = drunkWalk(this.game.rng, level, x, y)) === null) {
+            this.wanderCounter = 0;
+            return ActionFactory.createRestAction();
         } else {
-            // can sense target but can't find path
-            // drunkWalk slowly
-            let drunkDir: Vec2 | null;
-            if (++this.wanderCounter > 1 || (drunkDir = drunkWalk(this.game.rng, level, x, y)) === null) {
-                this.wanderCounter = 0;
-                return ActionFactory.createRestAction();
-            } else {
-                return ActionFactory.createMoveAction(drunkDir[0], drunkDir[1]);
-            }
+            return ActionFactory.createMoveAction(drunkDir[0], drunkDir[1]);
         }
     }
 
@@ -127,27 +164,87 @@ export class AIController extends IController {
             }
             const target = this.wanderTarget;
             if (target === null) { return null; }
-            this.wanderPath = blindPath(level, x, y, target[0], target[1]);
+            this.wanderPath = new BlindPath(level, x, y, target[0], target[1]);
         }
         const path = this.wanderPath;
         // move slowly
-        if (++this.wanderCounter > 1) {
+        if (++this.wanderCounter >= wanderCycle) {
             this.wanderCounter = 0;
             return ActionFactory.createRestAction();
         }
         const next = path.next();
-        if (next.done) {
+        if (next === null) {
             this.wanderPath = null;
             this.wanderTarget = null;
             return this.wander();
         }
-        const [nx, ny] = next.value;
+        const [nx, ny] = next;
         const dx = nx - x;
         const dy = ny - y;
         return ActionFactory.createMoveAction(dx, dy);
     }
 
+    public get hasIntent(): boolean {
+        return this.intent !== null;
+    }
+
+    // what the actor chases, null if it has to look for something first
+    public get currentTarget(): Entity | null {
+        return this.attackTarget;
+    }
+
+    public setIntent(intent: Intent) {
+        this.intent = intent;
+    }
+
+    // the planned action if it still makes sense, null if the actor has to decide again
+    private followIntent(intent: Intent): Action | null {
+        if (!this.actor.hasComponent(Location.Component)) {
+            return null;
+        }
+        const {dungeonLevel: level, x, y} = this.actor.location;
+        if (x !== intent.x || y !== intent.y) {
+            return null;
+        }
+        if (intent.target === null) {
+            this.attackTarget = null;
+        } else if (this.attackTarget === null || this.attackTarget.id !== intent.target) {
+            this.attackTarget = findById(level.entities, intent.target);
+        }
+        const nx = x + intent.dx;
+        const ny = y + intent.dy;
+        switch (intent.kind) {
+            case IntentKind.Wander:
+                return this.wander() || ActionFactory.createRestAction();
+            case IntentKind.Move:
+                // someone else took the cell
+                if (!level.travelable(nx, ny)) { return null; }
+                break;
+            case IntentKind.Attack:
+                // the target moved away
+                if (this.attackTarget === null || !level.entitiesAt(nx, ny).includes(this.attackTarget)) {
+                    return null;
+                }
+                break;
+            default:
+                return null;
+        }
+        this.wanderPath = null;
+        this.wanderTarget = null;
+        return intent.kind === IntentKind.Attack ?
+            ActionFactory.createAttackAction(intent.dx, intent.dy) :
+            ActionFactory.createMoveAction(intent.dx, intent.dy);
+    }
+
     public async getAction(): Promise<Action> {
+        const intent = this.intent;
+        if (intent !== null) {
+            this.intent = null;
+            const planned = this.followIntent(intent);
+            if (isNotNull(planned)) {
+                return planned;
+            }
+        }
         const chase = this.chaseEnemy();
         if (isNotNull(chase)) {
             this.wanderPath = null;
@@ -157,6 +254,60 @@ export class AIController extends IController {
         return this.wander() || ActionFactory.createRestAction();
     }
 
+    public reset() {
+        this.attackTarget = null;
+        this.wanderTarget = null;
+        this.wanderPath = null;
+        this.wanderCounter = 0;
+        this.intent = null;
+    }
+
+    public save(writer: ByteWriter) {
+        writer.i32(this.attackTarget === null ? noId : this.attackTarget.id);
+        const wanderTarget = this.wanderTarget;
+        writer.u8(wanderTarget === null ? 0 : 1);
+        if (wanderTarget !== null) {
+            writer.u16(wanderTarget[0]);
+            writer.u16(wanderTarget[1]);
+        }
+        writer.u8(this.wanderPath === null ? 0 : 1);
+        if (this.wanderPath !== null) {
+            this.wanderPath.save(writer);
+        }
+        writer.u32(this.wanderCounter);
+        const intent = this.intent;
+        writer.u8(intent === null ? 0 : 1);
+        if (intent !== null) {
+            writer.u16(intent.x);
+            writer.u16(intent.y);
+            writer.u8(intent.kind);
+            writer.i32(intent.dx);
+            writer.i32(intent.dy);
+            writer.i32(intent.target === null ? noId : intent.target);
+        }
+    }
+
+    public restore(reader: ByteReader, entities: Map<Id, Entity>) {
+        const level = this.actor.assertHasComponent(Location.Component).location.dungeonLevel;
+        const targetId = reader.i32();
+        const target = entities.get(targetId);
+        this.attackTarget = targetId !== noId && isDefined(target) ? target : null;
+        this.wanderTarget = reader.u8() !== 0 ? [reader.u16(), reader.u16()] : null;
+        this.wanderPath = reader.u8() !== 0 ? BlindPath.restore(level, reader) : null;
+        this.wanderCounter = reader.u32();
+        if (reader.u8() !== 0) {
+            const x = reader.u16();
+            const y = reader.u16();
+            const kind = reader.u8() as IntentKind;
+            const dx = reader.i32();
+            const dy = reader.i32();
+            const intentTarget = reader.i32();
+            this.intent = {x, y, kind, dx, dy, target: intentTarget === noId ? null : intentTarget};
+        } else {
+            this.intent = null;
+        }
+    }
+
     public dispose() {
         this.game.removeEventListener(GameEventTopic.Death, this.onEntityDeath);
     }
@@ -0,0 +1,238 @@
+import { Array2d } from "./Array2d";
+import { seesObserver } from "./fov";
+import { DistanceGrid, Distances, floodDistances, stepTowards, unreachedDistance, Walkable } from "./pathfinding";
+
+/*
+Everything an AI worker gets to see of a level and what it answers with.
+Kept free of the game classes so that it can be loaded in a worker.
+
+The world is a read-only copy of a window of the level around the planned actors
+and the humans they chase, cells outside of it are treated as walls.
+The window reaches planMargin around every human, so the distances an actor acts on
+are the same as in the Pathmap of the human on the live level.
+*/
+
+export interface PlanWorld {
+    // position of the window in the level
+    readonly left: number;
+    readonly top: number;
+    readonly width: number;
+    readonly height: number;
+    // terrain kind of every cell for the FOV kernels, column major
+    readonly terrain: Uint8Array;
+    // 1 where the terrain or an entity blocks movement, column major
+    readonly blocked: Uint8Array;
+    // (id, x, y, fov radius) of the humans the actors notice and chase, in the order Perception lists them
+    readonly observers: Int32Array;
+}
+
+export interface PlanRequest {
+    readonly world: PlanWorld;
+    // (id, x, y, fov radius, id of the target it already chases or noTarget)
+    readonly actors: Int32Array;
+}
+
+// what the worker answers with its wasm kernels
+export interface PlanSight {
+    // FOV of the observer at index i of world.observers, laid out like Vision.fov
+    observerFov(i: number): Array2d;
+    // between two cells of the world in level coordinates
+    lineOfSight(fromx: number, fromy: number, tox: number, toy: number): boolean;
+}
+
+export const noTarget = -1;
+export const actorStride = 5;
+export const observerStride = 4;
+// (id, x, y, kind, dx, dy, target id)
+export const intentStride = 7;
+// sent by a worker once it is ready to take requests
+export const workerReady = "ready";
+
+export const enum IntentKind {
+    // needs the live level or the rng, decided when the actor's turn comes
+    Undecided,
+    Wander,
+    Move,
+    Attack
+}
+
+export const enum ChaseKind {
+    // nowhere to step, the actor wanders but keeps its target
+    Blocked,
+    // the target is too far, the actor forgets it
+    GiveUp,
+    Attack,
+    Approach,
+    // there is no path to the target, the actor staggers about, which needs the rng
+    Stagger
+}
+
+export interface ChaseStep {
+    readonly kind: ChaseKind;
+    readonly dx: number;
+    readonly dy: number;
+}
+
+// how far around a human the world has to reach for actors that see as far as fovRadius,
+// a distance is exact unless it is at least this, and chaseStep gives up well before that
+export function planMargin(fovRadius: number): number {
+    return Math.ceil(fovRadius * 1.5) + 2;
+}
+
+// the chase rules of AIController, the workers use the same ones
+// so a planned intent is what the actor would decide at planning time
+export function chaseStep(
+    distances: Distances, reachesTarget: boolean, walkable: Walkable,
+    x: number, y: number, tx: number, ty: number, fovRadius: number
+): ChaseStep {
+    const dir = stepTowards(distances, walkable, x, y, tx, ty);
+    if (dir === null) {
+        return {kind: ChaseKind.Blocked, dx: 0, dy: 0};
+    }
+    const [dx, dy] = dir;
+    // standing next to target
+    if (x + dx === tx && y + dy === ty) {
+        return {kind: ChaseKind.Attack, dx, dy};
+    }
+    // can sense target but can't find path
+    if (!reachesTarget) {
+        return {kind: ChaseKind.Stagger, dx, dy};
+    }
+    // lose target if it's too far
+    if (distances.distanceAt(x + dx, y + dy) > fovRadius * 1.5) {
+        return {kind: ChaseKind.GiveUp, dx, dy};
+    }
+    return {kind: ChaseKind.Approach, dx, dy};
+}
+
+function withinWorld(world: PlanWorld, x: number, y: number): boolean {
+    return x >= world.left && x < world.left + world.width && y >= world.top && y < world.top + world.height;
+}
+
+// the world as a level to walk on
+class WorldMap implements Walkable {
+    constructor(private readonly world: PlanWorld) {}
+
+    public travelable(x: number, y: number): boolean {
+        const {world} = this;
+        return withinWorld(world, x, y) && world.blocked[(x - world.left) * world.height + (y - world.top)] === 0;
+    }
+}
+
+// distances to one target within the world, what the Pathmap of the target holds
+class WorldDistances implements DistanceGrid, Distances {
+    private readonly map: Uint8Array;
+    public readonly reachesTarget: boolean;
+
+    constructor(private readonly world: PlanWorld, walkable: Walkable, tx: number, ty: number) {
+        this.map = new Uint8Array(world.width * world.height);
+        this.map.fill(unreachedDistance);
+        this.reachesTarget = floodDistances(this, walkable, tx, ty);
+    }
+
+    private index(x: number, y: number): number {
+        return (x - this.world.left) * this.world.height + (y - this.world.top);
+    }
+
+    public withinBounds(x: number, y: number): boolean {
+        return withinWorld(this.world, x, y);
+    }
+
+    public get(x: number, y: number): number {
+        return this.map[this.index(x, y)];
+    }
+
+    public set(x: number, y: number, value: number) {
+        this.map[this.index(x, y)] = value;
+    }
+
+    public distanceAt(x: number, y: number): number {
+        return this.get(x, y);
+    }
+}
+
+function findObserver(world: PlanWorld, id: number): number {
+    const {observers} = world;
+    for (let i = 0; i * observerStride < observers.length; i++) {
+        if (observers[i * observerStride] === id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// the first observer the actor at x, y sees, what Perception.observersSeenBy starts with
+function noticeObserver(world: PlanWorld, sight: PlanSight, x: number, y: number, r: number): number {
+    const {observers} = world;
+    for (let i = 0; i * observerStride < observers.length; i++) {
+        const ox = observers[i * observerStride + 1];
+        const oy = observers[i * observerStride + 2];
+        const or = observers[i * observerStride + 3];
+        if (seesObserver(x, y, r, ox, oy, or, () => sight.observerFov(i), () => sight.lineOfSight(x, y, ox, oy))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// what each actor would do if it acted on the world as it is,
+// the target search of AIController and chaseStep, anything that needs the rng is left Undecided
+export function planIntents(request: PlanRequest, sight: PlanSight): Int32Array {
+    const {world, actors} = request;
+    const map = new WorldMap(world);
+    // flooded once per target for all the actors chasing it
+    const flooded: Map<number, WorldDistances> = new Map();
+    const numActors = actors.length / actorStride;
+    const intents = new Int32Array(numActors * intentStride);
+    for (let a = 0; a < numActors; a++) {
+        const base = a * actorStride;
+        const id = actors[base];
+        const x = actors[base + 1];
+        const y = actors[base + 2];
+        const r = actors[base + 3];
+        let target = actors[base + 4];
+        let kind = IntentKind.Undecided;
+        let dx = 0;
+        let dy = 0;
+        const observer = target === noTarget ? noticeObserver(world, sight, x, y, r) : findObserver(world, target);
+        if (observer < 0) {
+            // a target that is not in the world is left to the actor's turn
+            if (target === noTarget) {
+                kind = IntentKind.Wander;
+            }
+        } else {
+            target = world.observers[observer * observerStride];
+            const tx = world.observers[observer * observerStride + 1];
+            const ty = world.observers[observer * observerStride + 2];
+            let distances = flooded.get(observer);
+            if (distances === undefined) {
+                distances = new WorldDistances(world, map, tx, ty);
+                flooded.set(observer, distances);
+            }
+            const step = chaseStep(distances, distances.reachesTarget, map, x, y, tx, ty, r);
+            dx = step.dx;
+            dy = step.dy;
+            switch (step.kind) {
+                case ChaseKind.Blocked:
+                    kind = IntentKind.Wander;
+                    break;
+                case ChaseKind.GiveUp:
+                    kind = IntentKind.Wander;
+                    target = noTarget;
+                    break;
+                case ChaseKind.Attack:
+                    kind = IntentKind.Attack;
+                    break;
+                case ChaseKind.Approach:
+                    kind = IntentKind.Move;
+                    break;
+                case ChaseKind.Stagger:
+                    // the actor drunk walks on its turn
+                    kind = IntentKind.Undecided;
+                    break;
+            }
+        }
+        intents.set([id, x, y, kind, dx, dy, target], a * intentStride);
+    }
+    return intents;
+}
@@ -0,0 +1,159 @@
+import { actorStride, intentStride, noTarget, observerStride, planMargin, PlanRequest, PlanWorld, workerReady } from "./AIPlan";
+import { AIController, Intent } from "./AIController";
+import { Controlled, energyGain, energyTreshold } from "./components/Controlled";
+import { Location } from "./components/Location";
+import { Physical } from "./components/Physical";
+import { Vision } from "./components/Vision";
+import { DungeonLevel } from "./DungeonLevel";
+import { Entity } from "./entities/Entity";
+import { Human } from "./entities/Human";
+import { Perception, Seer } from "./Perception";
+import { Profiler, ProfileZone } from "./Profiler";
+import { TerrainFlag, terrainFlags } from "./Terrain";
+import { WorkerPool } from "./WorkerPool";
+
+type Actor = Entity & typeof Controlled.Component.prototype;
+type PlannedActor = Actor & typeof Location.Component.prototype & typeof Vision.Component.prototype;
+
+// Decision phase of the AI that runs in workers.
+// The AI actors that are about to act in the same round decide what they want to do
+// in parallel against a copy of the level: each worker finds the targets of its actors,
+// floods the distances to them and picks the steps, AIController then carries the intents out
+// in turn order and only decides again if the world changed under an intent.
+export class AIPlanner {
+    private readonly pool: WorkerPool<PlanRequest, Int32Array>;
+
+    constructor(numWorkers: number, private readonly perception: Perception) {
+        this.pool = new WorkerPool("ai-worker.js", numWorkers, workerReady);
+    }
+
+    public start(): Promise<void> {
+        return this.pool.start();
+    }
+
+    // true if the actor is about to act and should wait for a plan first
+    public needsPlan(actor: Actor): boolean {
+        const {controller, energy} = actor.controlled;
+        return controller instanceof AIController && !controller.hasIntent && energy >= energyTreshold;
+    }
+
+    // plans for the actor whose turn it is and the ones after it in this round that will act
+    public async plan(level: DungeonLevel, current: Actor, upcoming: Array<Actor>) {
+        // the enemies of the planned actors, the only ones they notice
+        const observers = this.perception.observers(level).filter(o => o.hasComponent(Controlled.Component));
+        const actors: Array<PlannedActor> = [];
+        for (const actor of upcoming) {
+            const {controller} = actor.controlled;
+            if (!(controller instanceof AIController) || controller.hasIntent) { continue; }
+            // the targets of the plans are humans, an AI controlled human decides on its own
+            if (actor instanceof Human) { continue; }
+            if (!actor.hasComponents(Location.Component, Vision.Component)) { continue; }
+            if (actor.location.dungeonLevel !== level) { continue; }
+            const ready = actor === current ?
+                actor.controlled.energy >= energyTreshold :
+                actor.controlled.energy + energyGain >= energyTreshold;
+            if (!ready) { continue; }
+            // chasing something on another level is left to the actor's turn
+            const target = controller.currentTarget;
+            if (target !== null && !observers.includes(target as Seer)) { continue; }
+            actors.push(actor);
+        }
+        if (actors.length === 0) { return; }
+
+        Profiler.begin(ProfileZone.Plan);
+        const world = AIPlanner.snapshot(level, actors, observers);
+        const numRequests = Math.min(this.pool.size, actors.length);
+        const requests: Array<PlanRequest> = [];
+        for (let i = 0; i < numRequests; i++) {
+            const from = Math.floor(actors.length * i / numRequests);
+            const to = Math.floor(actors.length * (i + 1) / numRequests);
+            requests.push({world, actors: AIPlanner.encodeActors(actors.slice(from, to))});
+        }
+        const responses = await this.pool.run(requests);
+        Profiler.end(ProfileZone.Plan);
+
+        const byId: Map<number, PlannedActor> = new Map();
+        for (const actor of actors) {
+            byId.set(actor.id, actor);
+        }
+        for (const intents of responses) {
+            for (let i = 0; i < intents.length; i += intentStride) {
+                const actor = byId.get(intents[i]);
+                if (actor === undefined) { continue; }
+                const intent: Intent = {
+                    x: intents[i + 1],
+                    y: intents[i + 2],
+                    kind: intents[i + 3],
+                    dx: intents[i + 4],
+                    dy: intents[i + 5],
+                    target: intents[i + 6] === noTarget ? null : intents[i + 6]
+                };
+                (actor.controlled.controller as AIController).setIntent(intent);
+            }
+        }
+    }
+
+    private static encodeActors(actors: Array<PlannedActor>): Int32Array {
+        const encoded = new Int32Array(actors.length * actorStride);
+        actors.forEach((actor, i) => {
+            const target = (actor.controlled.controller as AIController).currentTarget;
+            encoded.set([
+                actor.id, actor.location.x, actor.location.y, actor.vision.fovRadius,
+                target === null ? noTarget : target.id
+            ], i * actorStride);
+        });
+        return encoded;
+    }
+
+    // the part of the level the actors can see and chase in
+    private static snapshot(level: DungeonLevel, actors: Array<PlannedActor>, observers: Array<Seer>): PlanWorld {
+        let reach = 0;
+        let x0 = Infinity;
+        let y0 = Infinity;
+        let x1 = -Infinity;
+        let y1 = -Infinity;
+        for (const actor of actors) {
+            reach = Math.max(reach, actor.vision.fovRadius);
+            // the cells the actor can step to
+            x0 = Math.min(x0, actor.location.x - 1);
+            y0 = Math.min(y0, actor.location.y - 1);
+            x1 = Math.max(x1, actor.location.x + 1);
+            y1 = Math.max(y1, actor.location.y + 1);
+        }
+        const encodedObservers = new Int32Array(observers.length * observerStride);
+        observers.forEach((observer, i) => {
+            const {x, y} = observer.location;
+            const r = observer.vision.fovRadius;
+            encodedObservers.set([observer.id, x, y, r], i * observerStride);
+            // its FOV and every distance the actors chasing it act on
+            const margin = Math.max(planMargin(reach), r);
+            x0 = Math.min(x0, x - margin);
+            y0 = Math.min(y0, y - margin);
+            x1 = Math.max(x1, x + margin);
+            y1 = Math.max(y1, y + margin);
+        });
+        const left = Math.max(x0, 0);
+        const top = Math.max(y0, 0);
+        const width = Math.min(x1, level.width - 1) - left + 1;
+        const height = Math.min(y1, level.height - 1) - top + 1;
+
+        const terrain = new Uint8Array(width * height);
+        level.copyTerrain(left, top, width, height, terrain);
+        const blocked = new Uint8Array(width * height);
+        for (let i = 0; i < blocked.length; i++) {
+            blocked[i] = terrainFlags[terrain[i]] & TerrainFlag.BlocksMovement ? 1 : 0;
+        }
+        for (const entity of level.entities) {
+            if (!entity.hasComponents(Location.Component, Physical.Component) || !entity.physical.blocksMovement) { continue; }
+            const {x, y} = entity.location;
+            if (x >= left && x < left + width && y >= top && y < top + height) {
+                blocked[(x - left) * height + (y - top)] = 1;
+            }
+        }
+        return {left, top, width, height, terrain, blocked, observers: encodedObservers};
+    }
+
+    public dispose() {
+        this.pool.dispose();
+    }
+}
@@ -0,0 +1,60 @@
+import { observerStride, planIntents, PlanRequest, PlanSight, workerReady } from "./AIPlan";
+import { Array2d, Array2dPool } from "./Array2d";
+import { lineOfSight, updateFieldOfView } from "./fov";
+
+// Entry point of the workers started by AIPlanner, loaded by ai-worker.js
+// once the wasm runtime of the worker is up.
+
+const scope = self as unknown as Worker;
+const fovBuffers = new Array2dPool();
+let terrain: Array2d | null = null;
+
+// grows the terrain buffer so the world fits, the buffer may be larger than it
+function terrainBuffer(width: number, height: number): Array2d {
+    if (terrain === null || terrain.width < width || terrain.height < height) {
+        const mapWidth = terrain === null ? width : Math.max(terrain.width, width);
+        const mapHeight = terrain === null ? height : Math.max(terrain.height, height);
+        if (terrain !== null) {
+            terrain.dispose();
+        }
+        terrain = new Array2d(mapWidth, mapHeight);
+    }
+    return terrain;
+}
+
+scope.onmessage = (e: MessageEvent) => {
+    const request = e.data as PlanRequest;
+    const {world} = request;
+    const {left, top, width, height, observers} = world;
+    const map = terrainBuffer(width, height);
+    const columns = map.columns;
+    for (let x = 0; x < width; x++) {
+        columns[x].set(world.terrain.subarray(x * height, (x + 1) * height));
+    }
+    // computed when an actor is close enough to need one
+    const fovs: Map<number, Array2d> = new Map();
+    const sight: PlanSight = {
+        observerFov: i => {
+            let fov = fovs.get(i);
+            if (fov === undefined) {
+                const r = observers[i * observerStride + 3];
+                const d = 2 * r + 1;
+                fov = fovBuffers.acquire(d, d);
+                const cx = observers[i * observerStride + 1] - left;
+                const cy = observers[i * observerStride + 2] - top;
+                updateFieldOfView(map, width, height, fov, cx, cy, r);
+                fovs.set(i, fov);
+            }
+            return fov;
+        },
+        lineOfSight: (fromx, fromy, tox, toy) =>
+            lineOfSight(map, width, height, fromx - left, fromy - top, tox - left, toy - top)
+    };
+    const intents = planIntents(request, sight);
+    for (const fov of fovs.values()) {
+        fov.dispose();
+    }
+    scope.postMessage(intents, [intents.buffer]);
+};
+
+scope.postMessage(workerReady);
@@ -1,39 +1,135 @@
 import { FovModule } from "./fov";
+import { ProfileCounter, Profiler } from "./Profiler";
+import { assertDefined } from "./utils";
 
 const NULL = 0;
 const sizeofInt32 = Int32Array.BYTES_PER_ELEMENT;
+// assumes pointers are 32
+const sizeofPtr = 4;
 
+// int** in the wasm heap, allocated as one block by create_array2d.
+// Views into the heap are detached when the memory grows,
+// so the column views are derived again whenever the heap has been replaced.
 export class Array2d {
     private ptr_: IntPtrPtr = NULL;
-    private disposed: boolean = false;
-    public readonly columns: Array<Int32Array> = [];
+    private disposed_: boolean = false;
+    private columns_: Array<Int32Array> = [];
+    // the heap the column views were made from
+    private heap: ArrayBuffer | null = null;
 
     constructor(
         public readonly width: number,
-        public readonly height: number
+        public readonly height: number,
+        // buffers from a pool go back to it when disposed
+        private readonly pool: Array2dPool | null = null
     ) {
-        // assumes pointers are 32
         if ((this.ptr_ = FovModule._create_array2d(width, height)) === NULL) {
             throw new Error("Failed to allocate Array2d");
         }
-        const offset = this.ptr_ / sizeofInt32;
-        const colPtrs = FovModule.HEAP32.subarray(offset, offset + width); 
-        for (let x = 0; x < width; x++) {
-            const colOffset = colPtrs[x] / sizeofInt32;
-            this.columns[x] = FovModule.HEAP32.subarray(colOffset, colOffset + height);
-        }
+        Profiler.count(ProfileCounter.Allocations);
     }
 
     public get ptr(): IntPtrPtr {
-        if (this.disposed) {
+        if (this.disposed_) {
             throw new Error("Trying to use disposed Array2d");
         }
         return this.ptr_;
     }
 
+    public get disposed(): boolean {
+        return this.disposed_;
+    }
+
+    public get columns(): Array<Int32Array> {
+        const heap = FovModule.HEAP32;
+        if (heap.buffer !== this.heap) {
+            // the cells follow the column pointers
+            const cells = (this.ptr + this.width * sizeofPtr) / sizeofInt32;
+            for (let x = 0; x < this.width; x++) {
+                const colOffset = cells + x * this.height;
+                this.columns_[x] = heap.subarray(colOffset, colOffset + this.height);
+            }
+            this.heap = heap.buffer;
+        }
+        return this.columns_;
+    }
+
     public dispose() {
+        if (this.pool !== null) {
+            this.pool.release(this);
+        } else {
+            this.free();
+        }
+    }
+
+    // gives the memory back to the allocator even if the buffer came from a pool
+    public free() {
+        if (this.disposed_) { return; }
         FovModule._free_array2d(this.ptr_, this.width, this.height);
         this.ptr_ = NULL;
-        this.disposed = true;
+        this.disposed_ = true;
+        this.columns_.length = 0;
+        this.heap = null;
+    }
+}
+
+// Reuses buffers of the same size instead of going back to the allocator,
+// which keeps the heap from fragmenting as actors come and go.
+// Everything the pool handed out can be freed in one go,
+// so a pool also works as the arena of a level.
+export class Array2dPool {
+    private readonly idle: Map<number, Array<Array2d>> = new Map();
+    private readonly isIdle: Set<Array2d> = new Set();
+    private readonly owned: Set<Array2d> = new Set();
+
+    // how many unused buffers of each size are kept
+    constructor(private readonly maxIdlePerSize: number = 16) {}
+
+    private static sizeClass(width: number, height: number): number {
+        return width * 0x10000 + height;
+    }
+
+    public get numOwned(): number {
+        return this.owned.size;
+    }
+
+    public acquire(width: number, height: number): Array2d {
+        const idle = this.idle.get(Array2dPool.sizeClass(width, height));
+        if (idle !== undefined && idle.length > 0) {
+            const arr = assertDefined(idle.pop());
+            this.isIdle.delete(arr);
+            return arr;
+        }
+        const arr = new Array2d(width, height, this);
+        this.owned.add(arr);
+        return arr;
+    }
+
+    public release(arr: Array2d) {
+        if (arr.disposed || this.isIdle.has(arr)) { return; }
+        const sizeClass = Array2dPool.sizeClass(arr.width, arr.height);
+        let idle = this.idle.get(sizeClass);
+        if (idle === undefined) {
+            idle = [];
+            this.idle.set(sizeClass, idle);
+        }
+        if (idle.length < this.maxIdlePerSize) {
+            idle.push(arr);
+            this.isIdle.add(arr);
+        } else {
+            this.owned.delete(arr);
+            arr.free();
+        }
+    }
+
+    // frees every buffer of the pool, also the ones still in use
+    // the pool itself can still be used afterwards
+    public freeAll() {
+        for (const arr of this.owned) {
+            arr.free();
+        }
+        this.owned.clear();
+        this.idle.clear();
+        this.isIdle.clear();
     }
 }
@@ -1,25 +1,56 @@
-import { StrictMap } from "./StrictMap";
+// what add does when the slowest consumer is a whole ring behind
+export const enum Overflow {
+    // overwrite the oldest item, consumers that had not taken it yet skip it
+    DropOldest,
+    // refuse the item, put waits for room instead
+    Backpressure
+}
+
+// a consumer's position in the stream, the sequence number of the next item it takes
+interface Cursor {
+    next: number;
+}
 
 // Kind of like a queue.
 // Implements Symbol.asyncIterator and can be conveniently used with
 // infinite for-await-of loops.
 // One stream can be used by multiple loops and every loop will
 // receive every item.
+// Items live in a fixed ring and every consumer only keeps a sequence number into it,
+// so adding and taking don't depend on how many items or consumers there are.
 export class AsyncStream<T = any> {
-    // the underlying main data store of this class
-    private items: T[] = [];
-    // tracks how many times each item has been consumed
-    private itemConsumptionCounts: number[] = [];
-    // tracks the current index of each consumer (in the items array)
-    private consumerIndices: StrictMap<Symbol, number> = new StrictMap();
-    // contains the resolve functions for the itemAdded method
-    private locks: Function[] = [];
-    // contains the corresponding reject functions
-    private rejects: Function[] = [];
+    // the item with sequence number n is in slot n & mask
+    private readonly items: Array<T | undefined>;
+    private readonly mask: number;
+    // sequence number of the next item added
+    private head: number = 0;
+    // sequence number of the oldest item still kept,
+    // only moved past the slowest consumer when the ring is full or it has a single consumer
+    private tail: number = 0;
+    private readonly cursors: Set<Cursor> = new Set();
+    // one promise shared by every consumer waiting for an item, false once terminated
+    private itemAdded: Promise<boolean> | null = null;
+    private resolveItemAdded: ((added: boolean) => void) | null = null;
+    // the same for producers waiting in put
+    private spaceFreed: Promise<boolean> | null = null;
+    private resolveSpaceFreed: ((freed: boolean) => void) | null = null;
+    private dropped_: number = 0;
 
     private terminated = false;
 
-    constructor(private buffered: boolean) {}
+    // capacity is rounded up to a power of two
+    constructor(
+        private readonly buffered: boolean,
+        capacity: number = 256,
+        private readonly overflow: Overflow = Overflow.DropOldest
+    ) {
+        let size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        this.items = new Array(size);
+        this.mask = size - 1;
+    }
 
     // the main use of this class
     // each invocation of this function is a new "consumer"
@@ -28,93 +59,221 @@ export class AsyncStream<T = any> {
             return;
         }
 
-        const id = Symbol();
-        this.consumerIndices.set(id, 0);
-
+        const cursor = this.subscribe();
         try {
             // yield items forever
             // wait for items to be added if there are none
             while (true) {
-                if (this.items.length === 0 || this.consumerIndices.get(id) >= this.items.length) {
-                    try {
-                        await this.itemAdded();
-                    } catch (err) {
-                        break;
-                    }
+                if (cursor.next >= this.head && !await this.waitForItem()) {
+                    break;
                 }
-                yield this.take(id);
+                yield this.take(cursor);
             }
         } finally {
             // this will always be ran when the iterator ends
-            this.consumerIndices.delete(id);
+            this.unsubscribe(cursor);
         }
     }
 
-    // add a new item and make it ready to be consumed
-    public add(item: T) {
-        if (this.buffered || this.consumerCount > 0 && !this.terminated) {
-            this.items.push(item);
-            this.itemConsumptionCounts.push(0);
-            this.unlock();
+    // like the iterator but yields everything that piled up since the last batch at once,
+    // at most maxCount items at a time
+    public async *batches(maxCount: number = Infinity): AsyncIterableIterator<T[]> {
+        if (this.terminated) {
+            return;
+        }
+
+        const cursor = this.subscribe();
+        try {
+            while (true) {
+                if (cursor.next >= this.head && !await this.waitForItem()) {
+                    break;
+                }
+                yield this.takeMany(cursor, maxCount);
+            }
+        } finally {
+            this.unsubscribe(cursor);
         }
     }
 
-    // returns the next item for the given consumer
-    protected take(consumerId: Symbol): T {
-        const index = this.consumerIndices.get(consumerId);
-
-        // select this consumers next item
-        const item = this.items[index];
-        // add 1 to the amount of times this item has been consumed
-        const consumptionCount = ++this.itemConsumptionCounts[index];
-
-        // move this consumers index to the next next item
-        this.consumerIndices.set(consumerId, index + 1);
-
-        // item has been consumed by all consumers and can be disposed
-        if (consumptionCount >= this.consumerCount) {
-            // remove item
-            this.items.shift();
-            this.itemConsumptionCounts.shift();
-            // move all consumers' indices back by one
-            for (const [k, i] of this.consumerIndices) {
-                this.consumerIndices.set(k, i - 1);
+    // add a new item and make it ready to be consumed,
+    // returns false if it was not kept
+    public add(item: T): boolean {
+        if (this.terminated || !this.buffered && this.cursors.size === 0) {
+            return false;
+        }
+        if (this.head - this.tail > this.mask) {
+            this.trim();
+            if (this.head - this.tail > this.mask) {
+                if (this.overflow === Overflow.Backpressure) {
+                    return false;
+                }
+                this.release(this.tail + 1);
+                this.dropped_++;
             }
         }
+        this.items[this.head & this.mask] = item;
+        this.head++;
+        this.wakeConsumers(true);
+        return true;
+    }
 
+    // like add but waits for the consumers to make room when the ring is full,
+    // resolves to false if the item could not be kept
+    public async put(item: T): Promise<boolean> {
+        while (!this.add(item)) {
+            if (this.terminated || !this.buffered && this.cursors.size === 0) {
+                return false;
+            }
+            if (!await this.waitForSpace()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // returns the next item for the given consumer
+    protected take(cursor: Cursor): T {
+        this.skipDropped(cursor);
+        const item = this.items[cursor.next & this.mask] as T;
+        cursor.next++;
+        this.consumed(cursor);
         return item;
     }
 
-    // call all of the stored resolve functions
-    private unlock() {
-        let lock: Function | undefined;
-        while (((lock = this.locks.pop()) !== undefined) && this.rejects.pop()) {
-            lock();
+    // returns every item the given consumer has not taken yet, up to maxCount
+    protected takeMany(cursor: Cursor, maxCount: number): T[] {
+        this.skipDropped(cursor);
+        const count = Math.min(maxCount, this.head - cursor.next);
+        const batch = new Array<T>(count);
+        for (let i = 0; i < count; i++) {
+            batch[i] = this.items[(cursor.next + i) & this.mask] as T;
+        }
+        cursor.next += count;
+        this.consumed(cursor);
+        return batch;
+    }
+
+    private subscribe(): Cursor {
+        // new consumers start at the oldest item some consumer has not taken yet
+        this.trim();
+        const cursor = {next: this.tail};
+        this.cursors.add(cursor);
+        return cursor;
+    }
+
+    private unsubscribe(cursor: Cursor) {
+        this.cursors.delete(cursor);
+        if (this.cursors.size === 0) {
+            this.release(cursor.next);
+        } else {
+            this.trim();
+        }
+        // the consumer may have been the slowest one holding up a full ring,
+        // an unbuffered stream without consumers refuses what producers are waiting to put
+        if (this.head - this.tail <= this.mask || this.cursors.size === 0) {
+            this.wakeProducers(true);
+        }
+    }
+
+    // the items a consumer missed were overwritten by add
+    private skipDropped(cursor: Cursor) {
+        if (cursor.next < this.tail) {
+            cursor.next = this.tail;
+        }
+    }
+
+    private consumed(cursor: Cursor) {
+        // a lone consumer frees its items right away, with more that waits for the ring to fill up
+        if (this.cursors.size === 1) {
+            this.release(cursor.next);
+        }
+        if (this.resolveSpaceFreed !== null) {
+            this.trim();
+            if (this.head - this.tail <= this.mask) {
+                this.wakeProducers(true);
+            }
+        }
+    }
+
+    // drops the items every consumer has taken
+    private trim() {
+        if (this.cursors.size === 0) {
+            return;
+        }
+        let slowest = this.head;
+        for (const cursor of this.cursors) {
+            slowest = Math.min(slowest, cursor.next);
+        }
+        this.release(slowest);
+    }
+
+    // forgets the items before the given sequence number
+    private release(next: number) {
+        while (this.tail < next) {
+            this.items[this.tail & this.mask] = undefined;
+            this.tail++;
+        }
+    }
+
+    private waitForItem(): Promise<boolean> {
+        if (this.terminated) {
+            return Promise.resolve(false);
+        }
+        if (this.itemAdded === null) {
+            this.itemAdded = new Promise<boolean>(resolve => this.resolveItemAdded = resolve);
+        }
+        return this.itemAdded;
+    }
+
+    private waitForSpace(): Promise<boolean> {
+        if (this.terminated) {
+            return Promise.resolve(false);
+        }
+        if (this.spaceFreed === null) {
+            this.spaceFreed = new Promise<boolean>(resolve => this.resolveSpaceFreed = resolve);
+        }
+        return this.spaceFreed;
+    }
+
+    private wakeConsumers(added: boolean) {
+        const resolve = this.resolveItemAdded;
+        if (resolve !== null) {
+            this.itemAdded = null;
+            this.resolveItemAdded = null;
+            resolve(added);
+        }
+    }
+
+    private wakeProducers(freed: boolean) {
+        const resolve = this.resolveSpaceFreed;
+        if (resolve !== null) {
+            this.spaceFreed = null;
+            this.resolveSpaceFreed = null;
+            resolve(freed);
         }
     }
 
     public get consumerCount() {
-        return this.consumerIndices.size;
+        return this.cursors.size;
     }
 
+    // the number of items kept, some of them may have been taken by every consumer already
     public get size() {
-        return this.items.length;
+        return this.head - this.tail;
     }
 
-    // returns a promise that will resolve when a new item is added
-    private itemAdded(): Promise<void> {
-        return new Promise((resolve, reject) => {
-            this.locks.push(resolve);
-            this.rejects.push(reject);
-        });
+    public get capacity() {
+        return this.mask + 1;
+    }
+
+    // how many items were overwritten before every consumer took them
+    public get dropped() {
+        return this.dropped_;
     }
 
     public terminate() {
         this.terminated = true;
-
-        let reject: Function | undefined;
-        while ((reject = this.rejects.pop()) !== undefined) {
-            reject();
-        }
+        this.wakeConsumers(false);
+        this.wakeProducers(false);
     }
 }
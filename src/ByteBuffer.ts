@@ -0,0 +1,146 @@
+const utf8Encoder = new TextEncoder();
+const utf8Decoder = new TextDecoder();
+
+// Growable little endian byte buffer.
+// Typed arrays are copied as raw bytes so they keep the platform byte order,
+// which is little endian everywhere this runs.
+export class ByteWriter {
+    private buffer: ArrayBuffer;
+    private bytes: Uint8Array;
+    private view: DataView;
+    private length_: number = 0;
+
+    constructor(initialCapacity: number = 1024) {
+        this.buffer = new ArrayBuffer(initialCapacity);
+        this.bytes = new Uint8Array(this.buffer);
+        this.view = new DataView(this.buffer);
+    }
+
+    public get length(): number {
+        return this.length_;
+    }
+
+    private reserve(size: number): number {
+        const offset = this.length_;
+        const needed = offset + size;
+        if (needed > this.buffer.byteLength) {
+            const buffer = new ArrayBuffer(Math.max(needed, this.buffer.byteLength * 2));
+            const bytes = new Uint8Array(buffer);
+            bytes.set(this.bytes.subarray(0, offset));
+            this.buffer = buffer;
+            this.bytes = bytes;
+            this.view = new DataView(buffer);
+        }
+        this.length_ = needed;
+        return offset;
+    }
+
+    public u8(value: number) {
+        this.view.setUint8(this.reserve(1), value);
+    }
+
+    public u16(value: number) {
+        this.view.setUint16(this.reserve(2), value, true);
+    }
+
+    public u32(value: number) {
+        this.view.setUint32(this.reserve(4), value, true);
+    }
+
+    public i32(value: number) {
+        this.view.setInt32(this.reserve(4), value, true);
+    }
+
+    public f64(value: number) {
+        this.view.setFloat64(this.reserve(8), value, true);
+    }
+
+    // overwrites a previously written u32, used for back-patching offsets
+    public setU32(offset: number, value: number) {
+        this.view.setUint32(offset, value, true);
+    }
+
+    // utf-8 with a u32 byte length in front
+    public string(value: string) {
+        const bytes = utf8Encoder.encode(value);
+        this.u32(bytes.length);
+        const offset = this.reserve(bytes.length);
+        this.bytes.set(bytes, offset);
+    }
+
+    public bytesFrom(array: Uint8Array | Int32Array | Uint32Array) {
+        const offset = this.reserve(array.byteLength);
+        this.bytes.set(new Uint8Array(array.buffer, array.byteOffset, array.byteLength), offset);
+    }
+
+    // a copy of everything written so far
+    public finish(): Uint8Array {
+        return this.bytes.slice(0, this.length_);
+    }
+}
+
+export class ByteReader {
+    private readonly view: DataView;
+    private offset_: number;
+
+    constructor(private readonly bytes: Uint8Array, offset: number = 0) {
+        this.view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+        this.offset_ = offset;
+    }
+
+    public get offset(): number {
+        return this.offset_;
+    }
+
+    public get remaining(): number {
+        return this.bytes.length - this.offset_;
+    }
+
+    public peekU8(): number {
+        return this.view.getUint8(this.offset_);
+    }
+
+    private advance(size: number): number {
+        const offset = this.offset_;
+        if (offset + size > this.bytes.length) {
+            throw new RangeError("Read past the end of ByteReader");
+        }
+        this.offset_ += size;
+        return offset;
+    }
+
+    public u8(): number {
+        return this.view.getUint8(this.advance(1));
+    }
+
+    public u16(): number {
+        return this.view.getUint16(this.advance(2), true);
+    }
+
+    public u32(): number {
+        return this.view.getUint32(this.advance(4), true);
+    }
+
+    public i32(): number {
+        return this.view.getInt32(this.advance(4), true);
+    }
+
+    public f64(): number {
+        return this.view.getFloat64(this.advance(8), true);
+    }
+
+    public string(): string {
+        return utf8Decoder.decode(this.bytesView(this.u32()));
+    }
+
+    // a view into the underlying bytes, copy it if it has to outlive them
+    public bytesView(length: number): Uint8Array {
+        const offset = this.advance(length);
+        return this.bytes.subarray(offset, offset + length);
+    }
+
+    public bytesInto(target: Uint8Array | Int32Array | Uint32Array) {
+        const source = this.bytesView(target.byteLength);
+        new Uint8Array(target.buffer, target.byteOffset, target.byteLength).set(source);
+    }
+}
@@ -0,0 +1,143 @@
+import { Grid } from "./Grid";
+
+export const chunkShift = 6;
+export const chunkSize = 1 << chunkShift;
+export const chunkArea = chunkSize * chunkSize;
+const chunkMask = chunkSize - 1;
+
+// a column of an Array2d or of any other column major buffer
+export interface CellColumn {
+    fill(value: number, start: number, end: number): unknown;
+    set(array: ArrayLike<number>, offset: number): void;
+}
+
+// Byte per cell grid split into square chunks.
+// A chunk whose cells all have the same value is stored as just that value,
+// so memory is proportional to the parts of the grid that actually vary.
+// Cells inside a chunk are column major like Array2d.
+export class ByteChunks extends Grid {
+    public readonly chunksWide: number;
+    public readonly chunksHigh: number;
+    private readonly chunks: Array<Uint8Array | undefined>;
+    // value of every cell of the chunks that are not allocated
+    private readonly uniform: Uint8Array;
+    private numAllocated_: number = 0;
+
+    constructor(width: number, height: number, private readonly initial: number) {
+        super(width, height);
+        this.chunksWide = Math.ceil(width / chunkSize);
+        this.chunksHigh = Math.ceil(height / chunkSize);
+        this.chunks = new Array(this.chunksWide * this.chunksHigh);
+        this.uniform = new Uint8Array(this.chunksWide * this.chunksHigh);
+        this.uniform.fill(initial);
+    }
+
+    public get numChunks(): number {
+        return this.uniform.length;
+    }
+
+    public get numAllocated(): number {
+        return this.numAllocated_;
+    }
+
+    public chunkIndex(x: number, y: number): number {
+        return (y >>> chunkShift) * this.chunksWide + (x >>> chunkShift);
+    }
+
+    // the cells of the chunk, undefined if it is uniform
+    public chunk(chunkIdx: number): Uint8Array | undefined {
+        return this.chunks[chunkIdx];
+    }
+
+    public uniformValue(chunkIdx: number): number {
+        return this.uniform[chunkIdx];
+    }
+
+    public get(x: number, y: number): number {
+        const chunkIdx = this.chunkIndex(x, y);
+        const chunk = this.chunks[chunkIdx];
+        if (chunk === undefined) {
+            return this.uniform[chunkIdx];
+        }
+        return chunk[((x & chunkMask) << chunkShift) | (y & chunkMask)];
+    }
+
+    public set(x: number, y: number, value: number) {
+        const chunkIdx = this.chunkIndex(x, y);
+        let chunk = this.chunks[chunkIdx];
+        if (chunk === undefined) {
+            if (this.uniform[chunkIdx] === value) { return; }
+            chunk = this.allocate(chunkIdx);
+        }
+        chunk[((x & chunkMask) << chunkShift) | (y & chunkMask)] = value;
+    }
+
+    private allocate(chunkIdx: number): Uint8Array {
+        const chunk = new Uint8Array(chunkArea);
+        chunk.fill(this.uniform[chunkIdx]);
+        this.chunks[chunkIdx] = chunk;
+        this.numAllocated_++;
+        return chunk;
+    }
+
+    public setChunk(chunkIdx: number, cells: Uint8Array) {
+        if (cells.length !== chunkArea) {
+            throw new Error("Invalid chunk size");
+        }
+        if (this.chunks[chunkIdx] === undefined) {
+            this.numAllocated_++;
+        }
+        this.chunks[chunkIdx] = cells;
+    }
+
+    public setUniform(chunkIdx: number, value: number) {
+        if (this.chunks[chunkIdx] !== undefined) {
+            this.chunks[chunkIdx] = undefined;
+            this.numAllocated_--;
+        }
+        this.uniform[chunkIdx] = value;
+    }
+
+    // releases the chunks that ended up with a single value
+    public compact() {
+        for (let i = 0; i < this.chunks.length; i++) {
+            const chunk = this.chunks[i];
+            if (chunk === undefined) { continue; }
+            const value = chunk[0];
+            if (chunk.every(cell => cell === value)) {
+                this.setUniform(i, value);
+            }
+        }
+    }
+
+    // sets every cell back to the initial value
+    // allocated chunks are kept for reuse
+    public reset() {
+        this.uniform.fill(this.initial);
+        for (const chunk of this.chunks) {
+            if (chunk !== undefined) {
+                chunk.fill(this.initial);
+            }
+        }
+    }
+
+    // copies the rectangle into columns, like those of an Array2d
+    public copyInto(columns: Array<CellColumn>, x0: number, y0: number, w: number, h: number) {
+        for (let x = x0; x < x0 + w; x++) {
+            const col = columns[x - x0];
+            let y = y0;
+            while (y < y0 + h) {
+                const chunkIdx = this.chunkIndex(x, y);
+                const end = Math.min((y | chunkMask) + 1, y0 + h);
+                const chunk = this.chunks[chunkIdx];
+                if (chunk === undefined) {
+                    col.fill(this.uniform[chunkIdx], y - y0, end - y0);
+                } else {
+                    const start = (x & chunkMask) << chunkShift;
+                    col.set(chunk.subarray(start + (y & chunkMask), start + ((end - 1) & chunkMask) + 1), y - y0);
+                }
+                y = end;
+            }
+        }
+    }
+}
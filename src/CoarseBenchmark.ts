@@ -0,0 +1,52 @@
+import { filterEntities } from "./components/Component";
+import { Controlled } from "./components/Controlled";
+import { Game } from "./Game";
+import { isNotNull } from "./utils";
+
+export interface CoarseBenchmarkResult {
+    readonly neighbours: string;
+    readonly rounds: number;
+    // actors on the three levels of the window when the game ended
+    readonly actors: number;
+    readonly msPerRound: number;
+}
+
+function countActors(game: Game): number {
+    let actors = 0;
+    for (const level of [game.level.generatedPreviousLevel, game.level, game.level.generatedNextLevel]) {
+        if (isNotNull(level)) {
+            actors += filterEntities(level.entities, Controlled.Component).length;
+        }
+    }
+    return actors;
+}
+
+// milliseconds per round of a headless game on the middle of a three level window,
+// with the levels next to it simulated at full fidelity and with the coarse tier
+export async function benchmarkCoarse(
+    rounds: number = 500,
+    monstersPerLevel: number = 30,
+    seed: number = 1
+): Promise<Array<CoarseBenchmarkResult>> {
+    const results: Array<CoarseBenchmarkResult> = [];
+    for (const fullWindow of [true, false]) {
+        const game = new Game({seed, headless: true, aiPlayer: true, maxRounds: rounds, startDepth: 1, fullWindow});
+        for (const level of [game.level.getOrGeneratePreviousLevel(), game.level.getOrGenerateNextLevel()]) {
+            if (isNotNull(level)) {
+                game.populate(level, monstersPerLevel);
+            }
+        }
+        const start = performance.now();
+        await game.run();
+        const elapsed = performance.now() - start;
+        results.push({
+            neighbours: fullWindow ? "full" : "coarse",
+            // the player may die before maxRounds
+            rounds: game.round,
+            actors: countActors(game),
+            msPerRound: elapsed / Math.max(game.round, 1)
+        });
+        game.dispose();
+    }
+    return results;
+}
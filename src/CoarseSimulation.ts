@@ -0,0 +1,46 @@
+import { ActionKind } from "./actions/Action";
+import { wanderCycle } from "./AIController";
+import { filterEntities } from "./components/Component";
+import { Controlled, energyGain, getActionCost } from "./components/Controlled";
+import { Location } from "./components/Location";
+import { DungeonLevel } from "./DungeonLevel";
+import { sortById } from "./Id";
+import { drunkWalk } from "./pathfinding";
+import { Random } from "./Random";
+
+// Cheap simulation tier for levels the player is not on.
+// Actors are advanced in bulk steps of many rounds using simple rules:
+// random walking at the pace AIController wanders at, without FOV or pathfinding and no logging.
+// Coarse actors never take the stairs, they stay on their level until the player comes close.
+export class CoarseSimulation {
+    // how many rounds are simulated at once
+    public static readonly stepRounds: number = 10;
+
+    constructor(private readonly rng: Random) {}
+
+    public advance(level: DungeonLevel, rounds: number) {
+        if (level.hibernating || rounds <= 0) { return; }
+        const actors = filterEntities(level.entities, Controlled.Component);
+        // keep the rng call order stable
+        sortById(actors);
+        for (const actor of actors) {
+            if (!actor.hasComponent(Location.Component)) { continue; }
+            const {controlled} = actor;
+            const moveCost = Math.max(getActionCost(actor, ActionKind.Move), 1);
+            const cycleCost = Math.max((wanderCycle - 1) * moveCost + getActionCost(actor, ActionKind.Rest), 1);
+            controlled.energy += rounds * energyGain;
+            // whole wander cycles, then the moves the rest of the energy is enough for
+            const cycles = Math.floor(controlled.energy / cycleCost);
+            controlled.energy -= cycles * cycleCost;
+            const extraMoves = Math.min(Math.floor(controlled.energy / moveCost), wanderCycle - 1);
+            controlled.energy -= extraMoves * moveCost;
+            const moves = cycles * (wanderCycle - 1) + extraMoves;
+            for (let i = 0; i < moves; i++) {
+                const {x, y} = actor.location;
+                const dir = drunkWalk(this.rng, level, x, y);
+                if (dir === null) { break; }
+                level.moveEntityWithin(actor, x + dir[0], y + dir[1]);
+            }
+        }
+    }
+}
@@ -9,3 +9,22 @@ export const White = rgb(255, 255, 255);
 export const Red   = rgb(255,   0,   0);
 export const Green = rgb(  0, 255,   0);
 export const Blue  = rgb(  0,   0, 255);
+
+const packedColors: Map<Color, number> = new Map();
+const rgbPattern = /^rgb\((\d+),(\d+),(\d+)\)$/;
+
+// packs a color made by rgb() into the 0xAABBGGRR layout of ImageData
+export function packColor(color: Color): number {
+    const cached = packedColors.get(color);
+    if (cached !== undefined) {
+        return cached;
+    }
+    const match = rgbPattern.exec(color);
+    if (match === null) {
+        throw new Error(`Can't pack color "${color}"`);
+    }
+    const [r, g, b] = [match[1], match[2], match[3]].map(Number);
+    const packed = ((0xff << 24) | (b << 16) | (g << 8) | r) >>> 0;
+    packedColors.set(color, packed);
+    return packed;
+}
@@ -0,0 +1,98 @@
+import { Color, packColor } from "./Color";
+import { RenderBackend, RenderBackendKind } from "./RenderBackend";
+import { SpriteManager } from "./SpriteManager";
+
+type CompositorPtr = number;
+
+interface CompositorModule extends EmscriptenModule {
+    _compositor_create(width: number, height: number): CompositorPtr;
+    _compositor_free(c: CompositorPtr): void;
+    _compositor_pixels(c: CompositorPtr): number;
+    _compositor_alloc_atlas(c: CompositorPtr, width: number, height: number): number;
+    _compositor_clear(c: CompositorPtr, x: number, y: number, w: number, h: number): void;
+    _compositor_fill(c: CompositorPtr, x: number, y: number, w: number, h: number, color: number, alpha: number): void;
+    _compositor_sprite(c: CompositorPtr, sx: number, sy: number, w: number, h: number, dx: number, dy: number, alpha: number): void;
+    _compositor_scroll(c: CompositorPtr, dx: number, dy: number): void;
+}
+
+declare const Module: CompositorModule;
+
+const NULL = 0;
+const OpaqueAlpha = 256;
+
+// Composites the whole view in wasm into one RGBA buffer
+// which is pushed to the canvas with a single putImageData.
+// Sprite pixels are decoded once and copied to the wasm heap.
+export class CompositorBackend implements RenderBackend {
+    public readonly kind = RenderBackendKind.Compositor;
+    public canvasCalls: number = 0;
+    private readonly ctx: CanvasRenderingContext2D;
+    private ptr: CompositorPtr = NULL;
+    private atlasLoaded: boolean = false;
+    private alpha: number = OpaqueAlpha;
+
+    constructor(
+        private readonly canvas: HTMLCanvasElement,
+        private readonly sprites: SpriteManager
+    ) {
+        const ctx = this.canvas.getContext("2d");
+        if (ctx === null) {
+            throw new Error("Failed to get CanvasRenderingContext2D");
+        }
+        this.ctx = ctx;
+        if ((this.ptr = Module._compositor_create(canvas.width, canvas.height)) === NULL) {
+            throw new Error("Failed to allocate compositor");
+        }
+    }
+
+    private loadAtlas(): boolean {
+        if (this.atlasLoaded) {
+            return true;
+        }
+        if (!this.sprites.loaded) {
+            return false;
+        }
+        const pixels = this.sprites.getSheetPixels();
+        const atlas = Module._compositor_alloc_atlas(this.ptr, pixels.width, pixels.height);
+        if (atlas === NULL) {
+            throw new Error("Failed to allocate sprite atlas");
+        }
+        Module.HEAPU8.set(pixels.data, atlas);
+        this.atlasLoaded = true;
+        return true;
+    }
+
+    public clear(x: number, y: number, w: number, h: number) {
+        Module._compositor_clear(this.ptr, x, y, w, h);
+    }
+
+    public fill(x: number, y: number, w: number, h: number, color: Color) {
+        Module._compositor_fill(this.ptr, x, y, w, h, packColor(color), this.alpha);
+    }
+
+    public sprite(id: SpriteId, x: number, y: number) {
+        if (!this.loadAtlas()) { return; }
+        const {x: sx, y: sy, w, h} = this.sprites.getSprite(id);
+        Module._compositor_sprite(this.ptr, sx, sy, w, h, x, y, this.alpha);
+    }
+
+    public setAlpha(alpha: number) {
+        this.alpha = Math.round(alpha * OpaqueAlpha);
+    }
+
+    public scroll(dx: number, dy: number) {
+        Module._compositor_scroll(this.ptr, dx, dy);
+    }
+
+    public present() {
+        const {width, height} = this.canvas;
+        const pixels = new Uint8ClampedArray(Module.HEAPU8.buffer, Module._compositor_pixels(this.ptr), width * height * 4);
+        this.ctx.putImageData(new ImageData(pixels, width, height), 0, 0);
+        this.canvasCalls++;
+    }
+
+    public dispose() {
+        Module._compositor_free(this.ptr);
+        this.ptr = NULL;
+    }
+}
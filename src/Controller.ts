@@ -1,12 +1,15 @@
 import { Action } from "./actions/Action";
 import { AIController } from "./AIController";
+import { ByteReader, ByteWriter } from "./ByteBuffer";
 import { Entity } from "./entities/Entity";
 import { Game } from "./Game";
+import { Id } from "./Id";
 import { KeyboardController } from "./KeyboardController";
 
 export enum ControllerKind {
     Keyboard,
-    AI
+    AI,
+    Replay
 }
 
 export abstract class IController {
@@ -18,6 +21,19 @@ export abstract class IController {
     ) {}
 
     public abstract async getAction(): Promise<Action>;
+
+    // called when the actor has been moved around by something else
+    // than its controller, e.g. the coarse simulation
+    // tslint:disable-next-line
+    public reset() {}
+
+    // what the next decisions depend on, kept in snapshots
+    // restore runs once every entity of the level exists and is placed
+    // tslint:disable-next-line
+    public save(_writer: ByteWriter) {}
+    // tslint:disable-next-line
+    public restore(_reader: ByteReader, _entities: Map<Id, Entity>) {}
+
     public abstract dispose(): void;
 }
 
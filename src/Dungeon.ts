@@ -0,0 +1,116 @@
+import { DungeonLevel } from "./DungeonLevel";
+import { Game } from "./Game";
+import { MapGenerator } from "./mapgen/MapGenerator";
+import { Snapshot } from "./Snapshot";
+import { isDefined } from "./utils";
+
+// Owns the levels of the dungeon.
+// Levels are generated when they are first needed and
+// hibernated when they fall out of the active window around the player.
+export class Dungeon {
+    // how many levels above and below the focused one are kept awake
+    private static readonly activeRadius: number = 1;
+    private readonly levels: Array<DungeonLevel | undefined> = [];
+    // its scratch is about 11 bytes per cell, only held while levels are being generated
+    private mapgen_: MapGenerator | null = null;
+    private focusing: boolean = false;
+
+    constructor(
+        public readonly game: Game,
+        public readonly depth: number,
+        public readonly floorWidth: number,
+        public readonly floorHeight: number,
+        // levels saved in the snapshot are restored instead of generated
+        private readonly snapshot: Snapshot | null = null
+    ) {}
+
+    public get mapgen(): MapGenerator {
+        if (this.mapgen_ === null) {
+            this.mapgen_ = new MapGenerator(this.floorWidth, this.floorHeight);
+        }
+        return this.mapgen_;
+    }
+
+    // whether the dungeon reaches down to depth
+    public hasDepth(depth: number): boolean {
+        return depth >= 0 && depth < this.depth;
+    }
+
+    // never generates, null if the level was not generated yet
+    public generatedLevel(depth: number): DungeonLevel | null {
+        const existing = this.levels[depth];
+        return isDefined(existing) ? existing : null;
+    }
+
+    // generates (or restores) the level if it was not yet
+    public level(depth: number): DungeonLevel | null {
+        if (!this.hasDepth(depth)) {
+            return null;
+        }
+        const existing = this.levels[depth];
+        if (isDefined(existing)) {
+            return existing;
+        }
+        const level = new DungeonLevel(this, depth, this.floorWidth, this.floorHeight);
+        this.levels[depth] = level;
+        if (this.snapshot !== null && this.snapshot.hasLevel(depth)) {
+            this.snapshot.restoreLevel(this.game, level);
+        } else {
+            level.generate();
+            if (!this.focusing) {
+                this.releaseMapgen();
+            }
+        }
+        return level;
+    }
+
+    public get generatedLevels(): Array<DungeonLevel> {
+        const result: Array<DungeonLevel> = [];
+        for (const level of this.levels) {
+            if (isDefined(level)) {
+                result.push(level);
+            }
+        }
+        return result;
+    }
+
+    // wakes up (and generates if needed) the levels around depth
+    // and hibernates all the others
+    public focus(depth: number, round: number) {
+        const lo = depth - Dungeon.activeRadius;
+        const hi = depth + Dungeon.activeRadius;
+        for (const level of this.generatedLevels) {
+            if (level.depth < lo || level.depth > hi) {
+                level.hibernate(round);
+            }
+        }
+        // the levels of the window share one generator
+        this.focusing = true;
+        try {
+            for (let d = lo; d <= hi; d++) {
+                const level = this.level(d);
+                if (level !== null) {
+                    level.wake(round);
+                }
+            }
+        } finally {
+            this.focusing = false;
+            this.releaseMapgen();
+        }
+    }
+
+    public dispose() {
+        for (const level of this.generatedLevels) {
+            level.dispose();
+        }
+        this.levels.length = 0;
+        this.releaseMapgen();
+    }
+
+    private releaseMapgen() {
+        if (this.mapgen_ !== null) {
+            this.mapgen_.dispose();
+            this.mapgen_ = null;
+        }
+    }
+}
@@ -1,55 +1,203 @@
-import { Array2d } from "./Array2d";
+import { Array2d, Array2dPool } from "./Array2d";
+import { ByteChunks } from "./Chunks";
 import { Location } from "./components/Location";
+import { Controlled } from "./components/Controlled";
 import { Physical } from "./components/Physical";
+import { Vision } from "./components/Vision";
+import { Dungeon } from "./Dungeon";
 import { Entity } from "./entities/Entity";
-import { getFieldOfView, lineOfSight, updateFieldOfView } from "./fov";
+import { lineOfSight, updateFieldOfView } from "./fov";
 import { Grid } from "./Grid";
 import { removeById } from "./Id";
-import { Terrain, TerrainKind } from "./Terrain";
+import { LevelPlan, planLevel } from "./mapgen/MapGenerator";
+import { decodeChunks, encodeChunks } from "./rle";
+import { Terrain, TerrainFlag, terrainFlags, TerrainKind } from "./Terrain";
+import { TileMemory } from "./TileMemory";
 import { isDefined } from "./utils";
 
+interface TerrainWindow {
+    readonly map: Array2d;
+    // position of the window in the level
+    readonly left: number;
+    readonly top: number;
+    readonly width: number;
+    readonly height: number;
+}
+
+// Terrain is kept in chunks, uniform ones take no space beyond their value,
+// and only the cells that hold entities are in the entity map.
+// The FOV kernels work on a window of the terrain copied around the viewer
+// so nothing has to be allocated for the whole level.
 export class DungeonLevel extends Grid {
-    private readonly terrainMap: Array2d;
-    private readonly entityMap: Array<Array<Entity & typeof Location.Component.prototype> | undefined>;
+    private terrainMap_: ByteChunks | null = null;
+    // run-length encoded terrain while hibernating
+    private hibernatedTerrain: Uint8Array | null = null;
+    private hibernatedAt: number = 0;
+    // scratch buffer in the wasm heap the window of terrain is copied to
+    private terrainWindow_: Array2d | null = null;
+    // wasm buffers used on this level, all freed when it hibernates
+    public readonly buffers: Array2dPool = new Array2dPool();
+    private readonly entityMap: Map<number, Array<Entity & typeof Location.Component.prototype>> = new Map();
     private readonly entities_: Array<Entity> = [];
-    public previousLevel: DungeonLevel | null = null;
-    public nextLevel: DungeonLevel | null = null;
+    // indices of cells whose contents changed since the last time they were drawn,
+    // only kept for the current level, the view repaints everything when the level changes
+    private readonly dirtyCells: Set<number> = new Set();
+    // what the player has seen of this level, kept even while hibernating
+    public readonly memory: TileMemory;
+    // what the terrain is generated from, also where the stairs are
+    public readonly plan: LevelPlan;
 
     constructor(
+        public readonly dungeon: Dungeon,
+        public readonly depth: number,
         width: number,
         height: number
     ) {
         super(width, height);
-        this.terrainMap = new Array2d(width, height);
-        for (let x = 0; x < width; x++) {
-            for (let y = 0; y < height; y++) {
-                const col = this.terrainMap.columns[x];
-                if (Math.random() < 0.05) {
-                    col[y] = TerrainKind.StoneWall;
-                } else {
-                    col[y] = TerrainKind.StoneFloor;
-                }
+        this.memory = new TileMemory(width, height);
+        this.plan = planLevel(dungeon.game.rng.seed, depth, dungeon.depth, width, height);
+    }
+
+    public generate() {
+        this.terrainMap_ = this.dungeon.mapgen.generate(this.plan);
+    }
+
+    // the levels above and below, generated if they were not yet
+    public getOrGeneratePreviousLevel(): DungeonLevel | null {
+        return this.dungeon.level(this.depth - 1);
+    }
+
+    public getOrGenerateNextLevel(): DungeonLevel | null {
+        return this.dungeon.level(this.depth + 1);
+    }
+
+    // the same for read-only callers, null if the level was not generated yet
+    public get generatedPreviousLevel(): DungeonLevel | null {
+        return this.dungeon.generatedLevel(this.depth - 1);
+    }
+
+    public get generatedNextLevel(): DungeonLevel | null {
+        return this.dungeon.generatedLevel(this.depth + 1);
+    }
+
+    private get terrainMap(): ByteChunks {
+        if (this.terrainMap_ === null) {
+            throw new Error("Trying to use terrain of a hibernating DungeonLevel");
+        }
+        return this.terrainMap_;
+    }
+
+    public get hibernating(): boolean {
+        return this.terrainMap_ === null;
+    }
+
+    // compresses terrain and releases all wasm and pathing buffers
+    // actors are frozen simply by not being scheduled
+    public hibernate(round: number) {
+        if (this.terrainMap_ === null) { return; }
+        this.hibernatedTerrain = encodeChunks(this.terrainMap_);
+        this.terrainMap_ = null;
+        this.releaseTerrainWindow();
+        this.hibernatedAt = round;
+        for (const entity of this.entities_) {
+            if (entity.hasComponent(Vision.Component)) {
+                entity.vision.releaseFov();
+            }
+            if (entity.hasComponent(Location.Component)) {
+                entity.location.releasePathmap();
             }
         }
-        this.terrainMap.columns[1][1] = TerrainKind.StoneFloor;
-        this.terrainMap.columns[7].fill(TerrainKind.StoneFloor);
-        this.terrainMap.columns[8].fill(TerrainKind.StoneFloor);
-        this.terrainMap.columns[9].fill(TerrainKind.StoneFloor);
-        this.terrainMap.columns[2][2] = TerrainKind.Downstairs;
-        this.terrainMap.columns[3][2] = TerrainKind.Upstairs;
-        this.entityMap = new Array(width * height);
+        this.buffers.freeAll();
+    }
+
+    public wake(round: number) {
+        if (this.terrainMap_ !== null || this.hibernatedTerrain === null) { return; }
+        const terrainMap = new ByteChunks(this.width, this.height, TerrainKind.StoneFloor);
+        decodeChunks(this.hibernatedTerrain, terrainMap);
+        this.terrainMap_ = terrainMap;
+        this.hibernatedTerrain = null;
+        // cheap catch-up instead of simulating the missed rounds
+        const elapsed = round - this.hibernatedAt;
+        for (const entity of this.entities_) {
+            if (entity.hasComponent(Controlled.Component)) {
+                entity.controlled.catchUp(elapsed);
+            }
+        }
+    }
+
+    // the round the level went to sleep on, null while awake
+    public get hibernatedSince(): number | null {
+        return this.terrainMap_ === null ? this.hibernatedAt : null;
+    }
+
+    public encodeTerrain(): Uint8Array {
+        if (this.hibernatedTerrain !== null) {
+            return this.hibernatedTerrain;
+        }
+        return encodeChunks(this.terrainMap);
+    }
+
+    // restores a saved level straight into hibernation
+    // the terrain is decoded once the level is woken up
+    public restoreTerrain(encoded: Uint8Array, hibernatedAt: number) {
+        this.terrainMap_ = null;
+        this.releaseTerrainWindow();
+        this.hibernatedTerrain = encoded;
+        this.hibernatedAt = hibernatedAt;
+    }
+
+    // releases everything, the level can not be used afterwards
+    public dispose() {
+        this.terrainMap_ = null;
+        this.hibernatedTerrain = null;
+        this.releaseTerrainWindow();
+        for (const entity of this.entities_) {
+            if (entity.hasComponent(Vision.Component)) {
+                entity.vision.releaseFov();
+            }
+            entity.dispose();
+        }
+        this.entities_.length = 0;
+        this.entityMap.clear();
+        this.buffers.freeAll();
+    }
+
+    private releaseTerrainWindow() {
+        if (this.terrainWindow_ !== null) {
+            this.terrainWindow_.dispose();
+            this.terrainWindow_ = null;
+        }
+    }
+
+    // copies the terrain of the rectangle clipped to the level into the scratch buffer
+    // returns the clipped rectangle, the buffer may be larger than it
+    private terrainWindow(x0: number, y0: number, x1: number, y1: number): TerrainWindow {
+        const left = Math.max(x0, 0);
+        const top = Math.max(y0, 0);
+        const width = Math.max(Math.min(x1, this.width - 1) - left + 1, 0);
+        const height = Math.max(Math.min(y1, this.height - 1) - top + 1, 0);
+        let map = this.terrainWindow_;
+        if (map === null || map.width < width || map.height < height) {
+            const mapWidth = map === null ? width : Math.max(map.width, width);
+            const mapHeight = map === null ? height : Math.max(map.height, height);
+            this.releaseTerrainWindow();
+            map = this.terrainWindow_ = this.buffers.acquire(mapWidth, mapHeight);
+        }
+        this.terrainMap.copyInto(map.columns, left, top, width, height);
+        return {map, left, top, width, height};
     }
 
     private putEntityWithin(entity: Entity & typeof Location.Component.prototype, x: number, y: number) {
         entity.location.x = x;
         entity.location.y = y;
         const idx = this.index(x, y);
-        const entities = this.entityMap[idx];
+        const entities = this.entityMap.get(idx);
         if (isDefined(entities)) {
             entities.push(entity);
         } else {
-            this.entityMap[idx] = [entity];
+            this.entityMap.set(idx, [entity]);
         }
+        this.markCellDirty(idx);
     }
 
     public putEntity(entity: Entity, x: number, y: number) {
@@ -63,11 +211,12 @@ export class DungeonLevel extends Grid {
         if (entity.hasComponent(Location.Component)) {
             const {x, y} = entity.location;
             const idx = this.index(x, y);
-            const entities = this.entityMap[idx];
+            const entities = this.entityMap.get(idx);
             if (isDefined(entities) && removeById(entities, entity.id)) {
                 if (entities.length === 0) {
-                    delete this.entityMap[idx];
+                    this.entityMap.delete(idx);
                 }
+                this.markCellDirty(idx);
                 return true;
             }
         }
@@ -90,8 +239,24 @@ export class DungeonLevel extends Grid {
         return false;
     }
 
+    private markCellDirty(idx: number) {
+        if (this.dungeon.game.level === this) {
+            this.dirtyCells.add(idx);
+        }
+    }
+
+    public markDirty(x: number, y: number) {
+        this.markCellDirty(this.index(x, y));
+    }
+
+    public takeDirtyCells(): Array<number> {
+        const cells = Array.from(this.dirtyCells);
+        this.dirtyCells.clear();
+        return cells;
+    }
+
     public entitiesAt(x: number, y: number): Array<Entity & typeof Location.Component.prototype> {
-        const entities = this.entityMap[this.index(x, y)];
+        const entities = this.entityMap.get(this.index(x, y));
         if (isDefined(entities)) {
             return entities.slice();
         }
@@ -102,27 +267,46 @@ export class DungeonLevel extends Grid {
         return this.entities_.slice();
     }
 
+    public terrainKindAt(x: number, y: number): TerrainKind {
+        return this.terrainMap.get(x, y) as TerrainKind;
+    }
+
     public terrainAt(x: number, y: number): Terrain {
-        const kind = this.terrainMap.columns[x][y] as TerrainKind;
-        return Terrain[kind];
+        return Terrain[this.terrainKindAt(x, y)];
     }
 
+    // copies the terrain kinds of the rectangle column by column, it has to be within the level
+    public copyTerrain(x0: number, y0: number, width: number, height: number, out: Uint8Array) {
+        const columns: Array<Uint8Array> = [];
+        for (let x = 0; x < width; x++) {
+            columns.push(out.subarray(x * height, (x + 1) * height));
+        }
+        this.terrainMap.copyInto(columns, x0, y0, width, height);
+    }
+
+    // the buffer comes from the pool of the level, dispose it to give it back
     public getFieldOfViewAt(x: number, y: number, r: number): Array2d {
-        return getFieldOfView(this.terrainMap, x, y, r);
+        const d = 2 * r + 1;
+        const fov = this.buffers.acquire(d, d);
+        this.updateFieldOfViewAt(fov, x, y, r);
+        return fov;
     }
 
     public updateFieldOfViewAt(fov: Array2d, x: number, y: number, r: number) {
-        updateFieldOfView(this.terrainMap, fov, x, y, r);
+        const {map, left, top, width, height} = this.terrainWindow(x - r, y - r, x + r, y + r);
+        updateFieldOfView(map, width, height, fov, x - left, y - top, r);
     }
 
     public lineOfSight(fromx: number, fromy: number, tox: number, toy: number): boolean {
-        return lineOfSight(this.terrainMap, fromx, fromy, tox, toy);
+        const {map, left, top, width, height} = this.terrainWindow(
+            Math.min(fromx, tox), Math.min(fromy, toy), Math.max(fromx, tox), Math.max(fromy, toy)
+        );
+        return lineOfSight(map, width, height, fromx - left, fromy - top, tox - left, toy - top);
     }
 
     public travelable(x: number, y: number) {
-        if (!Terrain[this.terrainMap.columns[x][y] as TerrainKind].blocksMovement) {
-            const idx = this.index(x, y);
-            const entities = this.entityMap[idx];
+        if ((terrainFlags[this.terrainMap.get(x, y)] & TerrainFlag.BlocksMovement) === 0) {
+            const entities = this.entityMap.get(this.index(x, y));
             if (isDefined(entities)) {
                 for (const entity of entities) {
                     if (entity.hasComponent(Physical.Component) && entity.physical.blocksMovement) {
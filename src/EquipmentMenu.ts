@@ -1,8 +1,9 @@
 import { Equipment, EquipmentSlot, equipmentSlotNames } from "./components/Equipment";
 import { Storage } from "./components/Storage";
+import { DeltaEncoder } from "./RenderDelta";
 import { StorageMenu } from "./StorageMenu";
 import { enumValues, zip } from "./utils";
-import { v } from "./vdom";
+import { v, VirtualNode } from "./vdom";
 
 export class EquipmentMenu extends StorageMenu {
     private static readonly equipmentClassName: string = "equipment";
@@ -13,13 +14,14 @@ export class EquipmentMenu extends StorageMenu {
 
     constructor(
         storage: Storage,
-        protected readonly equipment: Equipment
+        protected readonly equipment: Equipment,
+        output: DeltaEncoder
     ) {
-        super("Equipment", storage);
+        super("Equipment", storage, output);
     }
 
-    public display() {
-        super.display();
+    protected render(): VirtualNode<"div"> {
+        const container = super.render();
         const {
             equipmentClassName,
             slotClassName,
@@ -27,8 +29,6 @@ export class EquipmentMenu extends StorageMenu {
             emptySlotClassName,
             emptySlotText
         } = EquipmentMenu;
-        const container = this.container!;
-        const titleEl = container.firstChild!;
         const equipmentContainer = v("div");
         for (const [slot, slotName] of zip(enumValues(EquipmentSlot), equipmentSlotNames)) {
             const item = this.equipment.slots.get(slot);
@@ -45,6 +45,8 @@ export class EquipmentMenu extends StorageMenu {
             ]);
             equipmentContainer.children.push(row);
         }
-        equipmentContainer.insertAfter(titleEl);
+        // right after the title
+        container.children.splice(1, 0, equipmentContainer);
+        return container;
     }
 }
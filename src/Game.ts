@@ -1,35 +1,37 @@
-import { ActionKind } from "./actions/Action";
+import { Action, ActionKind } from "./actions/Action";
+import { AIController } from "./AIController";
+import { AIPlanner } from "./AIPlanner";
+import { CoarseSimulation } from "./CoarseSimulation";
 import { filterEntities } from "./components/Component";
 import { Controlled, energyTreshold } from "./components/Controlled";
 import { Damageable } from "./components/Damageable";
 import { Location } from "./components/Location";
-import { Renderable } from "./components/Renderable";
 import { Vision } from "./components/Vision";
+import { ControllerKind } from "./Controller";
 import { Bind } from "./decorators";
+import { Dungeon } from "./Dungeon";
 import { DungeonLevel } from "./DungeonLevel";
 import { Entity } from "./entities/Entity";
 import { Goblin } from "./entities/Goblin";
 import { Human } from "./entities/Human";
 import { Trinket } from "./entities/Trinket";
 import { EventEmitter } from "./EventEmitter";
-import { Visibility } from "./fov";
-import { Id, sortById } from "./Id";
-import { MapGenerator } from "./mapgen/MapGenerator";
-import { villageMap } from "./mapgen/villageMap";
+import { collectKernelStats } from "./fov";
+import { Point } from "./geometry";
+import { GameClient } from "./GameClient";
+import { Fnv1a } from "./hash";
+import { findById, findIndexById, Id, sortById } from "./Id";
 import { MessageLog } from "./MessageLog";
+import { Perception } from "./Perception";
+import { Profiler, ProfileZone } from "./Profiler";
 import { Random } from "./Random";
-import { SpriteManager } from "./SpriteManager";
+import { RandomBackendKind } from "./RandomBackend";
+import { RenderBackendKind } from "./RenderBackend";
+import { DeltaEncoder, FrameSink } from "./RenderDelta";
+import { Recorder, Replay, ReplayController } from "./Replay";
+import { GameState, Snapshot, writeSnapshot } from "./Snapshot";
 import { assertNotNull, isDefined, isNotNull } from "./utils";
-import { v } from "./vdom";
-
-const TilePixelSize = 32;
-// size in tiles, should be odd so that the camera can be centered properly
-const ViewWidth = 41;
-const ViewHeight = 25;
-const HalfViewW = (ViewWidth - 1) / 2;
-const HalfViewH = (ViewHeight - 1) / 2;
-const HpBarHeight = 3;
-const HpBarOffset = TilePixelSize - HpBarHeight;
+import { ViewDeltas } from "./ViewDeltas";
 
 type Actor = Entity & typeof Controlled.Component.prototype;
 type ActorDispenserResult = Actor | null;
@@ -37,11 +39,55 @@ class ActorDispenser implements IterableIterator<ActorDispenserResult> {
     private readonly actors: Array<Actor> = [];
     private cursor: number = 0;
     private lastId: Id | null = null;
+    private round_: number = 0;
+
+    // number of times every actor has had its turn
+    public get round(): number {
+        return this.round_;
+    }
+
+    // the actor whose turn it is or was last
+    public get current(): Id | null {
+        return this.lastId;
+    }
+
+    public restore(round: number, lastId: Id | null) {
+        this.round_ = round;
+        this.lastId = lastId;
+        this.rewind();
+    }
+
+    // makes the last dispensed actor come up again
+    // returns false if it is no longer around
+    public repeatLast(): boolean {
+        if (this.lastId === null) {
+            return false;
+        }
+        const idx = findIndexById(this.actors, this.lastId);
+        if (idx === null) {
+            return false;
+        }
+        this.cursor = idx;
+        if (idx === this.actors.length - 1) {
+            // dispensing it again wraps around again
+            this.round_--;
+        }
+        return true;
+    }
 
     public clear() {
         this.actors.length = 0;
     }
 
+    // the last dispensed actor and the ones after it in this round
+    public upcoming(): Array<Actor> {
+        if (this.lastId === null) {
+            return [];
+        }
+        const idx = findIndexById(this.actors, this.lastId);
+        return idx === null ? [] : this.actors.slice(idx);
+    }
+
     public add(actors: Array<Actor>) {
         Array.prototype.push.apply(this.actors, actors);
     }
@@ -73,6 +119,7 @@ class ActorDispenser implements IterableIterator<ActorDispenserResult> {
         const actor = this.actors[this.cursor];
         if (++this.cursor >= this.actors.length) {
             this.rewind();
+            this.round_++;
         }
         if (isDefined(actor)) {
             this.lastId = actor.id;
@@ -101,70 +148,148 @@ type GameEventTopicMap = {
     [GameEventTopic.Death]: Entity;
 };
 
+export interface GameOptions {
+    readonly seed?: number;
+    readonly rngBackend?: RandomBackendKind;
+    readonly renderBackend?: RenderBackendKind;
+    // no rendering, message log or keyboard
+    readonly headless?: boolean;
+    // where the frames of the game go instead of a GameClient on the page,
+    // e.g. to the main thread when the game runs in a worker
+    readonly frames?: FrameSink;
+    // record the actions of the keyboard controlled player
+    readonly record?: boolean;
+    // the player plays back a recording instead
+    readonly replay?: Replay;
+    // AI actors decide in this many workers ahead of their turns, 0 to decide on their turn
+    readonly aiWorkers?: number;
+    // the player is controlled by the AI too
+    readonly aiPlayer?: boolean;
+    // the game ends after this many rounds
+    readonly maxRounds?: number;
+    // the player starts on this level instead of the first one
+    readonly startDepth?: number;
+    // the levels next to the current one are simulated at full fidelity too,
+    // only meant for comparing against the coarse tier
+    readonly fullWindow?: boolean;
+}
+
 export class Game extends EventEmitter<GameEventTopicMap> {
     public readonly rng: Random;
     private static readonly defaultFloorWidth: number = 100;
     private static readonly defaultFloorHeight: number = 100;
-    private readonly memoryCanvas: HTMLCanvasElement = v("canvas").appendTo(document.body);
-    private readonly mainCanvas: HTMLCanvasElement = v("canvas").appendTo(document.body);
-    public mainCtx: CanvasRenderingContext2D;
-    private memoryCtx: CanvasRenderingContext2D;
-    private readonly levels: Array<DungeonLevel> = [];
+    private static readonly numFloors: number = 11;
+    private dungeon: Dungeon;
     private currentLevel: DungeonLevel;
     private readonly actors: ActorDispenser = new ActorDispenser();
+    private readonly coarse: CoarseSimulation;
+    private nextCoarseRound: number = CoarseSimulation.stepRounds;
+    // the level whose actors were last simulated at full fidelity
+    private fullLevel: DungeonLevel | null = null;
     private cameraX: number = 0;
     private cameraY: number = 0;
     private trackedEntity_: Entity | null;
-    private readonly sprites: SpriteManager<Spritesheet> = new SpriteManager("spritesheet.gif", "spritesheet.json");
+    private readonly frames: FrameSink | null;
+    // everything the game shows goes through here
+    public readonly output: DeltaEncoder;
+    private readonly view: ViewDeltas | null;
     private running: boolean = false;
-    public readonly logger: MessageLog = new MessageLog(this, document.body, 6);
+    private ended: boolean = false;
+    // applied before the next turn
+    private pendingSnapshot: Snapshot | null = null;
+    // the actor that comes up first after restoring already got its energy
+    private resumingTurn: boolean = false;
+    public readonly logger: MessageLog;
+    public readonly recorder: Recorder | null;
+    private readonly replay: Replay | null;
+    private readonly planner: AIPlanner | null;
+    private readonly maxRounds: number;
+    private readonly fullWindow: boolean;
+    public readonly perception: Perception = new Perception();
     
-    constructor(seed?: number) {
+    constructor(options: GameOptions = {}) {
         super();
-        this.rng = new Random(seed);
-        const mainCtx = this.mainCanvas.getContext("2d");
-        if (mainCtx === null) {
-            throw new Error("Failed to get CanvasRenderingContext2D");
-        }
-        this.mainCtx = mainCtx;
-
-        const memoryCtx = this.memoryCanvas.getContext("2d");
-        if (memoryCtx === null) {
-            throw new Error("Failed to get CanvasRenderingContext2D");
+        // ids are part of the game state so every game numbers its entities from zero
+        Entity.nextId = 0;
+        this.rng = new Random(options.seed, options.rngBackend);
+        const headless = options.headless === true;
+        if (headless) {
+            this.frames = null;
+        } else if (isDefined(options.frames)) {
+            this.frames = options.frames;
+        } else {
+            const renderBackend = isDefined(options.renderBackend) ? options.renderBackend : RenderBackendKind.Canvas;
+            this.frames = new GameClient(document.body, renderBackend);
         }
-        this.memoryCtx = memoryCtx;
-
-        this.mainCanvas.width = TilePixelSize * ViewWidth;
-        this.mainCanvas.height = TilePixelSize * ViewHeight;
-        this.memoryCanvas.width = TilePixelSize * Game.defaultFloorWidth;
-        this.memoryCanvas.height = TilePixelSize * Game.defaultFloorHeight;
-        this.memoryCanvas.style.opacity = "0.5";
-
-        this.currentLevel = this.appendFloor();
+        this.output = new DeltaEncoder(this.frames);
+        this.view = this.frames !== null ? new ViewDeltas(this.output) : null;
+        this.logger = new MessageLog(this, this.output);
+        const aiWorkers = isDefined(options.aiWorkers) ? options.aiWorkers : 0;
+        this.recorder = options.record === true ? new Recorder(this.rng.seed, this.rng.backendKind, aiWorkers > 0) : null;
+        this.replay = isDefined(options.replay) ? options.replay : null;
+        this.planner = aiWorkers > 0 ? new AIPlanner(aiWorkers, this.perception) : null;
+        this.maxRounds = isDefined(options.maxRounds) ? options.maxRounds : Infinity;
+        this.fullWindow = options.fullWindow === true;
+        this.coarse = new CoarseSimulation(this.rng);
+        this.dungeon = new Dungeon(this, Game.numFloors, Game.defaultFloorWidth, Game.defaultFloorHeight);
+        this.currentLevel = assertNotNull(this.dungeon.level(isDefined(options.startDepth) ? options.startDepth : 0));
         const player = new Human(this);
-        this.currentLevel.putEntity(player, 1, 1);
-        this.currentLevel.putEntity(new Trinket(this), 2, 4);
-        for (let i = 0; i < 10; i++) {
-            this.currentLevel.putEntity(new Goblin(this), 7, i * 2);
-            this.currentLevel.putEntity(new Goblin(this), 8, 5 + i * 2);
-            this.currentLevel.putEntity(new Goblin(this), 9, 10 + i * 2);
+        if (this.replay !== null) {
+            player.controlled.controller.dispose();
+            player.controlled.controller = new ReplayController(this, player, this.replay);
+        } else if (options.aiPlayer === true) {
+            player.controlled.controller.dispose();
+            player.controlled.controller = new AIController(this, player);
         }
+        const {entry} = this.currentLevel.plan;
+        this.currentLevel.putEntity(player, entry.x, entry.y);
+        this.currentLevel.putEntity(new Trinket(this), entry.x, entry.y);
+        this.populate(this.currentLevel, 30);
         this.trackedEntity_ = player;
         this.updateCamera();
-        for (let i = 0; i < 10; i++) {
-            this.appendFloor();
-        }
 
         this.addEventListener(GameEventTopic.Death, this.onEntityDeath);
-        const mapgen = new MapGenerator(this, 30, 30, 100, 100);
-        villageMap(mapgen);
-        mapgen.draw();
+    }
+
+    // spawns goblins away from the entry of the level
+    public populate(level: DungeonLevel, count: number) {
+        for (let i = 0; i < count; i++) {
+            const {x, y} = this.spawnPoint(level, level.plan.entry, 10);
+            level.putEntity(new Goblin(this), x, y);
+        }
+    }
+
+    // a random free cell at least minDistance steps away from the point
+    private spawnPoint(level: DungeonLevel, awayFrom: Point, minDistance: number): Point {
+        for (let tries = 0; tries < 10000; tries++) {
+            const x = this.rng.random2(level.width);
+            const y = this.rng.random2(level.height);
+            const far = Math.max(Math.abs(x - awayFrom.x), Math.abs(y - awayFrom.y)) >= minDistance;
+            if (far && level.travelable(x, y)) {
+                return {x, y};
+            }
+        }
+        throw new Error("No room to spawn on the level");
     }
 
     public get trackedEntity(): Entity | null {
         return this.trackedEntity_;
     }
 
+    public get round(): number {
+        return this.actors.round;
+    }
+
+    // the level of the tracked entity
+    public get level(): DungeonLevel {
+        return this.currentLevel;
+    }
+
+    // generates the level if it was not yet
+    public getOrGenerateLevel(depth: number): DungeonLevel | null {
+        return this.dungeon.level(depth);
+    }
+
     @Bind
     private onEntityDeath(entity: Entity) {
         this.syncActors();
@@ -174,112 +299,205 @@ export class Game extends EventEmitter<GameEventTopicMap> {
         }
     }
 
+    // a compact binary copy of the game that can be restored later
+    public save(): Uint8Array {
+        const state: GameState = {
+            seed: this.rng.seed,
+            rngState: this.rng.getState(),
+            nextEntityId: Entity.nextId,
+            round: this.actors.round,
+            turnOf: this.actors.current,
+            nextCoarseRound: this.nextCoarseRound,
+            depth: this.currentLevel.depth,
+            trackedId: isNotNull(this.trackedEntity_) ? this.trackedEntity_.id : null
+        };
+        return writeSnapshot(state, this.dungeon.depth, this.dungeon.generatedLevels);
+    }
+
+    // rolls the game back to a saved state before the next turn,
+    // right away once the game has ended so that it can be looked at
+    public restore(data: Uint8Array) {
+        const snapshot = new Snapshot(data);
+        if (this.ended) {
+            this.applySnapshot(snapshot);
+        } else {
+            this.pendingSnapshot = snapshot;
+        }
+    }
+
+    private applySnapshot(snapshot: Snapshot) {
+        const {state} = snapshot;
+        this.dungeon.dispose();
+        this.rng.setState(state.seed, state.rngState);
+        Entity.nextId = state.nextEntityId;
+        this.dungeon = new Dungeon(this, Game.numFloors, Game.defaultFloorWidth, Game.defaultFloorHeight, snapshot);
+        this.currentLevel = assertNotNull(this.dungeon.level(state.depth));
+        this.nextCoarseRound = state.nextCoarseRound;
+        // the controllers of the current level were saved mid-game, resetting them would change their decisions
+        this.fullLevel = this.currentLevel;
+        this.actors.restore(state.round, state.turnOf);
+        this.syncActors();
+        this.resumingTurn = this.actors.repeatLast();
+        this.trackedEntity_ = state.trackedId === null ? null : findById(this.currentLevel.entities, state.trackedId);
+        this.updateCamera();
+        if (this.view !== null) {
+            this.view.invalidate();
+        }
+    }
+
+    // hash of the simulated state, leaves out anything only used for drawing
+    public stateHash(): number {
+        const hash = new Fnv1a();
+        hash.u32(this.actors.round);
+        hash.words(this.rng.getState());
+        for (const level of this.dungeon.generatedLevels) {
+            hash.u32(level.depth);
+            for (const entity of level.entities) {
+                hash.u32(entity.id);
+                if (entity.hasComponent(Location.Component)) {
+                    hash.u32(entity.location.x);
+                    hash.u32(entity.location.y);
+                }
+                if (entity.hasComponent(Damageable.Component)) {
+                    hash.u32(entity.damageable.health | 0);
+                }
+                if (entity.hasComponent(Controlled.Component)) {
+                    hash.u32(entity.controlled.energy | 0);
+                }
+            }
+        }
+        return hash.value;
+    }
+
+    // ends the game before the next action is executed
+    public stop() {
+        this.running = false;
+    }
+
+    // frees the wasm memory of the game, it can not be used afterwards
+    public dispose() {
+        this.stop();
+        this.dungeon.dispose();
+        this.rng.dispose();
+        if (this.planner !== null) {
+            this.planner.dispose();
+        }
+    }
+
     private updateCamera() {
         if (isNotNull(this.trackedEntity_) && this.trackedEntity_.hasComponent(Location.Component)) {
             this.cameraX = this.trackedEntity_.location.x;
             this.cameraY = this.trackedEntity_.location.y;
-            this.memoryCanvas.style.left = `${(-this.cameraX + HalfViewW) * TilePixelSize}px`;
-            this.memoryCanvas.style.top = `${(-this.cameraY + HalfViewH) * TilePixelSize}px`;
-        }
-    }
-
-    private appendFloor(): DungeonLevel {
-        const newFloor = new DungeonLevel(Game.defaultFloorWidth, Game.defaultFloorHeight);
-        const head = this.levels[this.levels.length - 1];
-        if (isDefined(head)) {
-            head.nextLevel = newFloor;
-            newFloor.previousLevel = head;
-        } else {
-            newFloor.previousLevel = null;
         }
-        this.levels.push(newFloor);
-        return newFloor;
     }
 
     private syncActors() {
+        this.dungeon.focus(this.currentLevel.depth, this.actors.round);
+        this.perception.invalidate();
         this.actors.clear();
-        const prev = this.currentLevel.previousLevel;
-        const next = this.currentLevel.nextLevel;
-        if (isNotNull(prev)) {
-            this.actors.add(filterEntities(prev.entities, Controlled.Component));
+        const actors = filterEntities(this.currentLevel.entities, Controlled.Component);
+        if (this.fullLevel !== this.currentLevel) {
+            // promote actors that were coarsely simulated back to full fidelity
+            for (const actor of actors) {
+                actor.controlled.controller.reset();
+                if (actor.hasComponent(Location.Component)) {
+                    actor.location.invalidatePathmapCache();
+                }
+                if (actor.hasComponent(Vision.Component)) {
+                    actor.vision.invalidateFovCache();
+                }
+            }
+            this.fullLevel = this.currentLevel;
         }
-        if (isNotNull(next)) {
-            this.actors.add(filterEntities(next.entities, Controlled.Component));
+        this.actors.add(actors);
+        if (this.fullWindow) {
+            for (const level of [this.currentLevel.generatedPreviousLevel, this.currentLevel.generatedNextLevel]) {
+                if (isNotNull(level)) {
+                    this.actors.add(filterEntities(level.entities, Controlled.Component));
+                }
+            }
         }
-        this.actors.add(filterEntities(this.currentLevel.entities, Controlled.Component));
         this.actors.sync();
     }
-    
-    private drawView(ctx: CanvasRenderingContext2D) {
-        ctx.clearRect(0, 0, ctx.canvas.width, ctx.canvas.height);
-        const offsetX = this.cameraX - HalfViewW;
-        const offsetY = this.cameraY - HalfViewH;
-
-        const tracked = this.trackedEntity_;
-        if (tracked === null || !tracked.hasComponent(Vision.Component)) {
-            return;
-        }
-        const {fov, fovRadius} = tracked.vision;
-
-        for (let fx = 0, x = this.cameraX - fovRadius; fx < fov.width; fx++, x++) {
-            const col = fov.columns[fx];
-            for (let fy = 0, y = this.cameraY - fovRadius; fy < fov.height; fy++, y++) {
-                const vis = col[fy] as Visibility;
-                if (vis === Visibility.Visible) {
-                    const level = this.currentLevel;
-                    if (level.withinBounds(x, y)) {
-                        const xpx = (x - offsetX) * TilePixelSize;
-                        const ypx = (y - offsetY) * TilePixelSize;
-                        const terrain = level.terrainAt(x, y);
-                        const terrainColor = terrain.bgColor;
-                        if (isNotNull(terrainColor)) {
-                            ctx.fillStyle = terrainColor;
-                            ctx.fillRect(xpx, ypx, TilePixelSize, TilePixelSize);
-                        }
-                        const terrainSprite = terrain.sprite;
-                        if (isNotNull(terrainSprite)) {
-                            this.sprites.draw(ctx, terrainSprite, xpx, ypx);
-                        }
-
-                        const entities = level.entitiesAt(x, y);
-                        for (const entity of entities) {
-                            if (entity.hasComponent(Renderable.Component)) {
-                                this.sprites.draw(ctx, entity.renderable.sprite, xpx, ypx);
-                                if (entity.hasComponent(Damageable.Component)) {
-                                    const hpPercent = Math.max(entity.damageable.health / entity.damageable.maxHealth, 0);
-                                    const barWidth = Math.floor(TilePixelSize * hpPercent);
-                                    ctx.fillStyle = "green";
-                                    ctx.fillRect(xpx, ypx + HpBarOffset, barWidth, HpBarHeight);
-                                    ctx.fillStyle = "red";
-                                    ctx.fillRect(xpx + barWidth, ypx + HpBarOffset, TilePixelSize - barWidth, HpBarHeight);
-                                }
-                            }
-                        }
-                    }
-                }
+
+    // adjacent levels are only simulated coarsely
+    private advanceCoarseLevels() {
+        if (this.fullWindow) { return; }
+        const rounds = CoarseSimulation.stepRounds;
+        while (this.actors.round >= this.nextCoarseRound) {
+            // focus keeps the levels next to the current one generated
+            const prev = this.currentLevel.generatedPreviousLevel;
+            const next = this.currentLevel.generatedNextLevel;
+            if (isNotNull(prev)) {
+                this.coarse.advance(prev, rounds);
+            }
+            if (isNotNull(next)) {
+                this.coarse.advance(next, rounds);
             }
+            this.nextCoarseRound += rounds;
         }
     }
-
+    
     public draw() {
-        this.drawView(this.mainCtx);
-        this.memoryCtx.drawImage(this.mainCanvas,
-            (this.cameraX - HalfViewW) * TilePixelSize,
-            (this.cameraY - HalfViewH) * TilePixelSize);
+        if (this.view !== null) {
+            this.view.render(this.currentLevel, this.trackedEntity_, this.cameraX, this.cameraY);
+        }
+        this.flush();
+    }
+
+    // sends the messages and menus so far without looking at the view
+    public flush() {
+        this.logger.flush();
+        this.output.flush();
+    }
+
+    private afterAction(actor: Actor, action: Action) {
+        const kind = actor.controlled.controller.kind;
+        if (this.recorder !== null && kind === ControllerKind.Keyboard) {
+            this.recorder.record(this, action);
+        } else if (this.replay !== null && kind === ControllerKind.Replay && !this.replay.verify(this)) {
+            console.error("Replay diverged from the recording");
+            this.stop();
+        }
     }
 
     public async run() {
         this.running = true;
         this.logger.logGlobal("Welcome! Press ? for help.");
-        await this.sprites.load();
+        if (this.frames !== null) {
+            await this.frames.ready();
+        }
+        if (this.planner !== null) {
+            await this.planner.start();
+        }
         this.syncActors();
         top:
         for (const actor_ of this.actors) {
+            if (isNotNull(this.pendingSnapshot)) {
+                this.applySnapshot(this.pendingSnapshot);
+                this.pendingSnapshot = null;
+                continue;
+            }
+            if (this.actors.round >= this.maxRounds) { break; }
             const actor = assertNotNull(actor_);
-            actor.controlled.gainEnergy();
+            this.advanceCoarseLevels();
+            if (this.resumingTurn) {
+                // the snapshot was taken after this actor gained its energy
+                this.resumingTurn = false;
+            } else {
+                actor.controlled.gainEnergy();
+            }
+            if (this.planner !== null && this.planner.needsPlan(actor)) {
+                await this.planner.plan(this.currentLevel, actor, this.actors.upcoming());
+            }
             while (actor.controlled.energy >= energyTreshold) {
+                Profiler.begin(ProfileZone.GetAction);
                 const action = await actor.controlled.controller.getAction();
+                Profiler.end(ProfileZone.GetAction);
+                if (!this.running) { break top; }
+                Profiler.begin(ProfileZone.Execute);
                 actor.controlled.energy -= action.execute(this, actor);
+                Profiler.end(ProfileZone.Execute);
                 let location: Location | null = null;
                 if (actor.hasComponent(Location.Component)) {
                     actor.location.invalidatePathmapCache();
@@ -291,7 +509,6 @@ export class Game extends EventEmitter<GameEventTopicMap> {
                 if (actor === this.trackedEntity_) {
                     switch (action.kind) {
                         case ActionKind.ClimbStairs:
-                            this.memoryCtx.clearRect(0, 0, this.memoryCanvas.width, this.memoryCanvas.height);
                             this.currentLevel = assertNotNull(location).dungeonLevel;
                         case ActionKind.Move:
                             this.updateCamera();
@@ -303,9 +520,28 @@ export class Game extends EventEmitter<GameEventTopicMap> {
                         this.syncActors();
                         break;
                 }
+                this.afterAction(actor, action);
+                if (actor === this.trackedEntity_ && actor.controlled.controller.kind !== ControllerKind.Keyboard) {
+                    // the keyboard draws before it waits for a key, the others are watched as they play
+                    this.draw();
+                    if (this.frames !== null) {
+                        await this.frames.ready();
+                    }
+                }
+                if (actor === this.trackedEntity_ && Profiler.enabled) {
+                    collectKernelStats();
+                    Profiler.endTurn();
+                }
                 if (!this.running) { break top; }
+                if (isNotNull(this.pendingSnapshot)) { continue top; }
             }
         }
-        this.logger.logGlobal("You lose.");
+        if (this.trackedEntity_ === null) {
+            this.logger.logGlobal("You lose.");
+        }
+        this.ended = true;
+        this.logger.flush();
+        this.output.gameOver();
+        this.output.flush();
     }
 }
@@ -0,0 +1,91 @@
+import { Visibility } from "./fov";
+import { Id } from "./Id";
+import { MessageLogView } from "./MessageLogView";
+import { RenderBackendKind } from "./RenderBackend";
+import { decodeFrame, DeltaHandler, FrameSink } from "./RenderDelta";
+import { SpriteManager } from "./SpriteManager";
+import { deserializeNode, SerializedNode } from "./vdom";
+import { ViewRenderer } from "./ViewRenderer";
+
+// The part of the game that lives in the DOM: the view, the message log and the open menu.
+// Shows the frames the game sends, from the same thread or from a worker through RemoteGame.
+export class GameClient implements FrameSink, DeltaHandler {
+    private readonly sprites: SpriteManager;
+    public readonly renderer: ViewRenderer;
+    public readonly log: MessageLogView;
+    private menuElement: HTMLElement | null = null;
+    private finished_: boolean = false;
+    private loaded: Promise<void> | null = null;
+
+    constructor(private readonly parent: HTMLElement, renderBackend: RenderBackendKind = RenderBackendKind.Canvas) {
+        this.sprites = new SpriteManager("spritesheet.gif", "spritesheet.atlas");
+        this.renderer = new ViewRenderer(this.sprites, parent, renderBackend);
+        this.log = new MessageLogView(parent, 6);
+    }
+
+    // true once the game has sent its last frame
+    public get finished(): boolean {
+        return this.finished_;
+    }
+
+    // the game asks again after every turn it is watched, the sprites are only loaded once
+    public ready(): Promise<void> {
+        if (this.loaded === null) {
+            this.loaded = this.sprites.load();
+        }
+        return this.loaded;
+    }
+
+    // applies the frame without drawing, several frames can be drawn at once with present
+    public apply(frame: Uint8Array) {
+        decodeFrame(frame, this);
+    }
+
+    public present() {
+        this.renderer.present();
+        this.log.flush();
+    }
+
+    public push(frame: Uint8Array) {
+        this.apply(frame);
+        this.present();
+    }
+
+    public view(cameraX: number, cameraY: number, repaint: boolean) {
+        this.renderer.view(cameraX, cameraY, repaint);
+    }
+
+    public cell(x: number, y: number, visibility: Visibility, terrain: number, object: SpriteId | null) {
+        this.renderer.cell(x, y, visibility, terrain, object);
+    }
+
+    public entityMove(id: Id, sprite: SpriteId, x: number, y: number) {
+        this.renderer.entityMove(id, sprite, x, y);
+    }
+
+    public entityHealth(id: Id, fraction: number) {
+        this.renderer.entityHealth(id, fraction);
+    }
+
+    public entityRemove(id: Id) {
+        this.renderer.entityRemove(id);
+    }
+
+    public message(text: string, count: number) {
+        this.log.add(text, count);
+    }
+
+    public menu(node: SerializedNode | null) {
+        if (this.menuElement !== null) {
+            this.menuElement.remove();
+            this.menuElement = null;
+        }
+        if (node !== null) {
+            this.menuElement = deserializeNode(node).appendTo(this.parent);
+        }
+    }
+
+    public gameOver() {
+        this.finished_ = true;
+    }
+}
@@ -0,0 +1,97 @@
+import { Game } from "./Game";
+import { Keyboard, KeyPress } from "./Keyboard";
+import { KeyboardController } from "./KeyboardController";
+import { RemoteGameInit, RemoteGameMessage } from "./RemoteGame";
+import { RenderChannelWriter } from "./RenderChannel";
+import { FrameSink } from "./RenderDelta";
+
+// how the game worker talks to the main thread, the worker scope or a worker_threads port
+export interface GamePort {
+    postMessage(message: RemoteGameMessage, transfer?: Array<ArrayBuffer>): void;
+}
+
+export interface ServedGame {
+    // where the key presses forwarded by the main thread go
+    readonly keyboard: Keyboard;
+    // resolves once the game has ended and was disposed
+    readonly finished: Promise<void>;
+}
+
+// writes the frames to the shared ring,
+// frames that don't fit wait in order until the main thread made room
+class ChannelSink implements FrameSink {
+    private readonly writer: RenderChannelWriter;
+    private readonly backlog: Array<Uint8Array> = [];
+    private drained: Promise<void> = Promise.resolve();
+
+    constructor(channel: SharedArrayBuffer) {
+        this.writer = new RenderChannelWriter(channel);
+    }
+
+    // the game waits here so the backlog stays small
+    public ready(): Promise<void> {
+        return this.drained;
+    }
+
+    public push(frame: Uint8Array) {
+        if (this.backlog.length === 0 && this.writer.tryWrite(frame)) { return; }
+        this.backlog.push(frame);
+        if (this.backlog.length === 1) {
+            this.drained = this.drain();
+        }
+    }
+
+    private async drain() {
+        while (this.backlog.length > 0) {
+            if (this.writer.tryWrite(this.backlog[0])) {
+                this.backlog.shift();
+            } else {
+                await this.writer.waitForRoom();
+            }
+        }
+    }
+}
+
+class PostSink implements FrameSink {
+    constructor(private readonly port: GamePort) {}
+
+    public ready(): Promise<void> {
+        return Promise.resolve();
+    }
+
+    public push(frame: Uint8Array) {
+        this.port.postMessage({frame}, [frame.buffer as ArrayBuffer]);
+    }
+}
+
+// Runs the game of a RemoteGame in this worker, the wasm runtime has to be up already.
+// Also used by scripts/split.js to run the game under node.
+export function serveGame(init: RemoteGameInit, port: GamePort): ServedGame {
+    const keyboard = new Keyboard(null);
+    KeyboardController.useKeyboard(keyboard);
+    const frames = init.channel !== null ? new ChannelSink(init.channel) : new PostSink(port);
+    const game = new Game({
+        seed: init.seed,
+        aiWorkers: init.aiWorkers,
+        aiPlayer: init.aiPlayer,
+        maxRounds: init.maxRounds,
+        frames
+    });
+    const finished = game.run()
+        .catch(err => port.postMessage({error: err.stack || String(err)}))
+        // the last frames may still wait for room in the channel
+        .then(() => frames.ready())
+        .then(() => game.dispose());
+    return {keyboard, finished};
+}
+
+// called by game-worker.js with the init message and the key presses that came in while loading
+export function startGameWorker(init: RemoteGameInit, queued: Array<KeyPress>) {
+    const scope = self as unknown as Worker;
+    const {keyboard, finished} = serveGame(init, scope);
+    scope.onmessage = (e: MessageEvent) => keyboard.press(e.data as KeyPress);
+    for (const keyPress of queued) {
+        keyboard.press(keyPress);
+    }
+    finished.then(() => close());
+}
@@ -1,5 +1,7 @@
+import { KeyPress } from "./Keyboard";
 import { BaseMenu, IMenu, MenuKind } from "./Menu";
-import { v } from "./vdom";
+import { DeltaEncoder } from "./RenderDelta";
+import { v, VirtualNode } from "./vdom";
 
 export class HelpMenu extends BaseMenu implements IMenu {
     protected static readonly containerClassName: string = "help-menu";
@@ -44,20 +46,19 @@ w : Equip or unequip items
 
     public readonly kind = MenuKind.NonInteractive;
 
-    constructor() {
-        super("Help");
+    constructor(output: DeltaEncoder) {
+        super("Help", output);
     }
 
     // tslint:disable-next-line
-    public handleKeypress(_keyPress: KeyboardEvent): null {
+    public handleKeypress(_keyPress: KeyPress): null {
         return null;
     }
 
-    public display() {
-        super.display();
+    protected render(): VirtualNode<"div"> {
         const container = this.createContainer();
         container.attrs.classList.add(HelpMenu.containerClassName);
         container.children.push(v("div", HelpMenu.helpText));
-        this.container = container.appendTo(document.body);
+        return container;
     }
 }
@@ -1,19 +1,36 @@
 import { AsyncStream } from "./AsyncStream";
 import { Bind } from "./decorators";
 
+// the parts of a KeyboardEvent the controls look at,
+// key presses forwarded from the main thread to the game worker have only these
+export interface KeyPress {
+    readonly code: string;
+    readonly key: string;
+}
+
 export class Keyboard {
-    public readonly keyPresses: AsyncStream<KeyboardEvent> = new AsyncStream(false);
+    // a held key repeating faster than the turns go drops its oldest presses
+    public readonly keyPresses: AsyncStream<KeyPress> = new AsyncStream(false, 64);
 
-    constructor(private source: GlobalEventHandlers = window) {
-        this.source.addEventListener("keyup", this.onKeyUp);
+    // without a source the key presses are fed in with press
+    constructor(private source: GlobalEventHandlers | null = window) {
+        if (this.source !== null) {
+            this.source.addEventListener("keyup", this.onKeyUp);
+        }
     }
 
     @Bind
     private onKeyUp(e: KeyboardEvent) {
-        this.keyPresses.add(e);
+        this.press(e);
+    }
+
+    public press(keyPress: KeyPress) {
+        this.keyPresses.add(keyPress);
     }
 
     public dispose() {
-        this.source.removeEventListener("keyup", this.onKeyUp);
+        if (this.source !== null) {
+            this.source.removeEventListener("keyup", this.onKeyUp);
+        }
     }
 }
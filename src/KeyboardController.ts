@@ -10,13 +10,12 @@ import { Location } from "./components/Location";
 import { Physical } from "./components/Physical";
 import { Storage } from "./components/Storage";
 import { ControllerKind, IController } from "./Controller";
-import { DungeonLevel } from "./DungeonLevel";
 import { Entity } from "./entities/Entity";
 import { EquipmentMenu } from "./EquipmentMenu";
 import { Game } from "./Game";
 import { E, N, NE, NW, S, SE, SW, W } from "./geometry";
 import { HelpMenu } from "./HelpMenu";
-import { Keyboard } from "./Keyboard";
+import { Keyboard, KeyPress } from "./Keyboard";
 import { IMenu, MenuKind } from "./Menu";
 import { StorageMenu } from "./StorageMenu";
 import { StrictMap } from "./StrictMap";
@@ -45,7 +44,8 @@ enum MenuMode {
 
 export class KeyboardController extends IController {
     public readonly kind = ControllerKind.Keyboard;
-    private static readonly keyboard: Keyboard = new Keyboard();
+    // created on first use so that headless games never touch the window
+    private static keyboard_: Keyboard | null = null;
     private static readonly gameControls: StrictMap<string, Action> = new StrictMap([
         ["Numpad1", ActionFactory.createMoveAction(...SW)],
         ["Numpad2", ActionFactory.createMoveAction(...S)],
@@ -86,6 +86,18 @@ export class KeyboardController extends IController {
         super(game, actor);
     }
 
+    // the game worker feeds in the key presses forwarded by the main thread
+    public static useKeyboard(keyboard: Keyboard) {
+        KeyboardController.keyboard_ = keyboard;
+    }
+
+    private static get keyboard(): Keyboard {
+        if (KeyboardController.keyboard_ === null) {
+            KeyboardController.keyboard_ = new Keyboard();
+        }
+        return KeyboardController.keyboard_;
+    }
+
     private transformMoveAction(move: MoveAction): Action | null {
         if (!this.actor.hasComponent(Location.Component)) {
             return null;
@@ -133,13 +145,9 @@ export class KeyboardController extends IController {
                 this.game.logger.logGlobal("There's nothing to climb here.");
                 return null;
             }
-            let destinationLevel: DungeonLevel | null = null;
-            if (terrain.climbDirection === ClimbDirection.Up) {
-                destinationLevel = level.previousLevel;
-            } else if (terrain.climbDirection === ClimbDirection.Down) {
-                destinationLevel = level.nextLevel;
-            }
-            if (destinationLevel === null) {
+            // the action generates the level when it is taken
+            const destinationDepth = level.depth + (terrain.climbDirection === ClimbDirection.Up ? -1 : 1);
+            if (!level.dungeon.hasDepth(destinationDepth)) {
                 this.game.logger.logGlobal(`The ${terrain.name} appears to be blocked by something.`);
                 return null;
             }
@@ -193,7 +201,7 @@ export class KeyboardController extends IController {
     private openInventory(title: string): StorageMenu | null {
         if (this.actor.hasComponent(Storage.Component)) {
             this.controlsMode = ControlsMode.UI;
-            const inventory = this.menu = new StorageMenu(title, this.actor.storage);
+            const inventory = this.menu = new StorageMenu(title, this.actor.storage, this.game.output);
             inventory.display();
             return inventory;
         }
@@ -203,7 +211,7 @@ export class KeyboardController extends IController {
     private openEquipmentMenu(): EquipmentMenu | null {
         if (this.actor.hasComponents(Equipment.Component, Storage.Component)) {
             this.controlsMode = ControlsMode.UI;
-            const menu = this.menu = new EquipmentMenu(this.actor.storage, this.actor.equipment);
+            const menu = this.menu = new EquipmentMenu(this.actor.storage, this.actor.equipment, this.game.output);
             menu.display();
             return menu;
         }
@@ -213,11 +221,11 @@ export class KeyboardController extends IController {
     private openHelp() {
         this.menuMode = MenuMode.None;
         this.controlsMode = ControlsMode.UI;
-        this.menu = new HelpMenu();
+        this.menu = new HelpMenu(this.game.output);
         this.menu.display();
     }
 
-    private handleGameModeKeyPress(keyPress: KeyboardEvent): Action | null {
+    private handleGameModeKeyPress(keyPress: KeyPress): Action | null {
         if (KeyboardController.gameControls.has(keyPress.code)) {
             return this.transformAction(KeyboardController.gameControls.get(keyPress.code));
         } else {
@@ -248,7 +256,7 @@ export class KeyboardController extends IController {
         return null;
     }
 
-    private handleMenuKeyPress(keyPress: KeyboardEvent): Action | null {
+    private handleMenuKeyPress(keyPress: KeyPress): Action | null {
         if (this.menu === null) { return null; }
         switch (this.menu.kind) {
         case MenuKind.Storage:
@@ -277,7 +285,7 @@ export class KeyboardController extends IController {
         return null;
     }
 
-    private handleUIModeKeyPress(keyPress: KeyboardEvent): Action | null {
+    private handleUIModeKeyPress(keyPress: KeyPress): Action | null {
         if (KeyboardController.uiControls.has(keyPress.code)) {
             switch (KeyboardController.uiControls.get(keyPress.code)) {
             case UIAction.CloseMenu:
@@ -305,6 +313,8 @@ export class KeyboardController extends IController {
             if (isNotNull(action)) {
                 return action;
             }
+            // show the feedback of keys that did not end the turn
+            this.game.flush();
         }
         throw new Error("Keyboard broke");
     }
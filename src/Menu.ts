@@ -1,7 +1,8 @@
 import { HelpMenu } from "./HelpMenu";
+import { KeyPress } from "./Keyboard";
+import { DeltaEncoder } from "./RenderDelta";
 import { StorageMenu } from "./StorageMenu";
-import { assertNotNull } from "./utils";
-import { v, VirtualNode } from "./vdom";
+import { serializeNode, v, VirtualNode } from "./vdom";
 
 export enum MenuKind {
     NonInteractive,
@@ -13,18 +14,19 @@ export type Menu = StorageMenu | HelpMenu;
 export interface IMenu {
     readonly kind: MenuKind;
     display(): void;
-    handleKeypress(keyPress: KeyboardEvent): any;
+    handleKeypress(keyPress: KeyPress): any;
     close(): void;
 }
 
+// Menus are built as virtual nodes and sent to the view like everything else the game shows.
 export abstract class BaseMenu {
     protected static readonly containerClassName: string = "menu";
     protected static readonly titleClassName: string = "menu-title";
     protected displayed: boolean = false;
-    protected container: HTMLDivElement | null = null;
 
     constructor (
-        public readonly title: string
+        public readonly title: string,
+        private readonly output: DeltaEncoder
     ) {}
 
     protected createContainer(): VirtualNode<"div"> {
@@ -33,6 +35,9 @@ export abstract class BaseMenu {
         ]);
     }
 
+    // the whole menu, called once when it is displayed
+    protected abstract render(): VirtualNode<"div">;
+
     protected static *itemIdentifiers(): IterableIterator<string> {
         const A = 65;
         const Z = 90;
@@ -49,12 +54,12 @@ export abstract class BaseMenu {
     public display() {
         if (this.displayed) { return; }
         this.displayed = true;
+        this.output.menu(serializeNode(this.render()));
     }
 
     public close() {
         if (!this.displayed) { return; }
         this.displayed = false;
-        document.body.removeChild(assertNotNull(this.container));
-        this.container = null;
+        this.output.menu(null);
     }
 }
@@ -80,8 +80,8 @@ export class MersenneTwister{
   private UPPER_MASK = 0x80000000; /* most significant w-r bits */
   private LOWER_MASK = 0x7fffffff; /* least significant r bits */
   
-  private mt = new Array(this.N); /* the array for the state vector */
-  private mti = this.N + 1;  /* mti==N+1 means mt[N] is not initialized */
+  protected mt = new Array(this.N); /* the array for the state vector */
+  protected mti = this.N + 1;  /* mti==N+1 means mt[N] is not initialized */
   
   constructor(seed?:number|Array<number>) {
     if (seed == undefined) {
@@ -1,95 +1,90 @@
 import { Location } from "./components/Location";
 import { Vision } from "./components/Vision";
 import { Game } from "./Game";
-import { assertNotNull, CssValue, isNotNull, parseCssValue } from "./utils";
-import { v, VirtualNode } from "./vdom";
+import { Profiler, ProfileZone } from "./Profiler";
+import { DeltaEncoder } from "./RenderDelta";
+import { isNotNull } from "./utils";
 
-export class MessageLog {
-    private static readonly containerClassName: string = "message-log";
-    private static readonly messageClassName: string = "message";
-    public readonly container: HTMLElement;
-    private readonly messages: Array<string> = [];
-    private readonly lineHeight: CssValue;
-    private numLines_: number;
+const numberPattern = /\d+/g;
 
-    constructor(private readonly game: Game, parent: HTMLElement, numLines: number) {
-        this.container = v("div", {class: MessageLog.containerClassName}).appendTo(parent);
-        const containerLineHeight = parseCssValue(this.container.style.lineHeight);
-        if (containerLineHeight) {
-            this.lineHeight = containerLineHeight;
-        } else {
-            this.lineHeight = assertNotNull(parseCssValue(getComputedStyle(parent).lineHeight));
-        }
-        this.numLines_ = numLines;
-        this.updateHeight();
-    }
+// a message waiting for the end of the turn together with the repeats merged into it
+interface PendingMessage {
+    // the text around its numbers, messages that only differ in their numbers share it
+    readonly parts: Array<string>;
+    readonly key: string;
+    // the smallest and largest value of every number in the text
+    readonly low: Array<number>;
+    readonly high: Array<number>;
+    count: number;
+}
 
-    private static createMessage(text: string): VirtualNode<"div"> {
-        return v("div", {class: MessageLog.messageClassName}, text);
-    }
+// Messages are collected during a turn and sent to the view in one go when the log is flushed.
+// Without a view messages are simply dropped.
+export class MessageLog {
+    private readonly pending: Array<PendingMessage> = [];
 
-    private getCurrentMessages(): Array<string> {
-        return this.messages.slice(-this.numLines_);
-    }
-
-    private log(text: string) {
-        this.messages.push(text);
-        const msg = MessageLog.createMessage(text);
-        const first = this.container.firstChild;
-        if (this.messages.length > this.numLines_ && isNotNull(first)) {
-            this.container.removeChild(first);
-        }
-        msg.appendTo(this.container);
-    }
+    constructor(private readonly game: Game, private readonly output: DeltaEncoder) {}
 
     public logGlobal(text: string) {
-        this.log(text);
+        if (!this.output.enabled) { return; }
+        this.add(text);
     }
 
+    // only kept if the tracked entity sees where it happened when it is logged
     public logLocal(eventLoc: Location, text: string) {
-        if (
-            isNotNull(this.game.trackedEntity) &&
-            (eventLoc.owner === this.game.trackedEntity || (
-                this.game.trackedEntity.hasComponent(Location.Component) &&
-                this.game.trackedEntity.location.dungeonLevel === eventLoc.dungeonLevel &&
-                this.game.trackedEntity.hasComponent(Vision.Component) &&
-                this.game.trackedEntity.vision.canSee(eventLoc.x, eventLoc.y)
-            ))
-        ) { 
-            this.log(text);
+        if (!this.output.enabled) { return; }
+        if (eventLoc.owner === this.game.trackedEntity || this.isVisible(eventLoc)) {
+            this.add(text);
         }
     }
 
-    private updateHeight() {
-        this.container.style.height = `${this.lineHeight.value * this.numLines_}${this.lineHeight.unit}`;
+    private isVisible(eventLoc: Location): boolean {
+        const tracked = this.game.trackedEntity;
+        if (isNotNull(tracked) && tracked.hasComponents(Location.Component, Vision.Component)) {
+            return tracked.location.dungeonLevel === eventLoc.dungeonLevel && tracked.vision.canSee(eventLoc.x, eventLoc.y);
+        }
+        return false;
     }
 
-    private redraw() {
-        this.updateHeight();
-        const range = document.createRange();
-        const first = this.container.firstChild;
-        const last = this.container.lastChild;
-        if (isNotNull(first) && isNotNull(last)) {
-            range.setStartBefore(first);
-            range.setEndAfter(last);
-            range.deleteContents();
-        }
-        const newContents = document.createDocumentFragment();
-        for (const text of this.getCurrentMessages()) {
-            const msg = MessageLog.createMessage(text);
-            msg.appendTo(newContents);
+    // repeats of a message are merged into the previous one even if their numbers differ,
+    // "for 2 damage" and "for 3 damage" become "for 2-3 damage" twice
+    private add(text: string) {
+        const parts = text.split(numberPattern);
+        const key = parts.join("\0");
+        const numbers = (text.match(numberPattern) || []).map(Number);
+        const last = this.pending[this.pending.length - 1];
+        if (last !== undefined && last.key === key) {
+            numbers.forEach((value, i) => {
+                last.low[i] = Math.min(last.low[i], value);
+                last.high[i] = Math.max(last.high[i], value);
+            });
+            last.count++;
+        } else {
+            this.pending.push({parts, key, low: numbers, high: numbers.slice(), count: 1});
         }
-        this.container.appendChild(newContents);
     }
 
-    public get numLines(): number {
-        return this.numLines_;
+    private static text(message: PendingMessage): string {
+        const {parts, low, high} = message;
+        let text = parts[0];
+        for (let i = 0; i < low.length; i++) {
+            text += (low[i] === high[i] ? `${low[i]}` : `${low[i]}-${high[i]}`) + parts[i + 1];
+        }
+        return text;
     }
-    
-    public set numLines(value: number) {
-        if (value !== this.numLines_) {
-            this.numLines_ = value;
-            this.redraw();
+
+    // sends the messages of the turn
+    public flush() {
+        if (this.pending.length === 0) { return; }
+        if (!this.output.enabled) {
+            this.pending.length = 0;
+            return;
+        }
+        Profiler.begin(ProfileZone.MessageLog);
+        for (const message of this.pending) {
+            this.output.message(MessageLog.text(message), message.count);
         }
+        this.pending.length = 0;
+        Profiler.end(ProfileZone.MessageLog);
     }
 }
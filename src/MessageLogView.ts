@@ -0,0 +1,102 @@
+import { Profiler, ProfileZone } from "./Profiler";
+import { RingBuffer } from "./RingBuffer";
+import { assertNotNull, CssValue, isNotNull, parseCssValue } from "./utils";
+import { v, VirtualNode } from "./vdom";
+
+interface Message {
+    readonly text: string;
+    count: number;
+}
+
+// Shows the newest lines of the message log.
+// Messages sent by MessageLog are collected and written to the DOM in one go on flush.
+export class MessageLogView {
+    private static readonly containerClassName: string = "message-log";
+    private static readonly messageClassName: string = "message";
+    private static readonly historySize: number = 200;
+    public readonly container: HTMLElement;
+    private readonly messages: RingBuffer<Message> = new RingBuffer(MessageLogView.historySize);
+    private readonly added: Array<Message> = [];
+    private readonly lineHeight: CssValue;
+    private numLines_: number;
+
+    constructor(parent: HTMLElement, numLines: number) {
+        this.numLines_ = numLines;
+        this.container = v("div", {class: MessageLogView.containerClassName}).appendTo(parent);
+        const containerLineHeight = parseCssValue(this.container.style.lineHeight);
+        if (containerLineHeight) {
+            this.lineHeight = containerLineHeight;
+        } else {
+            this.lineHeight = assertNotNull(parseCssValue(getComputedStyle(parent).lineHeight));
+        }
+        this.updateHeight();
+    }
+
+    private static createMessage(message: Message): VirtualNode<"div"> {
+        const text = message.count > 1 ? `${message.text} x${message.count}` : message.text;
+        return v("div", {class: MessageLogView.messageClassName}, text);
+    }
+
+    public add(text: string, count: number) {
+        // frames that are shown together coalesce their repeats too
+        const prev = this.added[this.added.length - 1];
+        if (prev !== undefined && prev.text === text) {
+            prev.count += count;
+        } else {
+            this.added.push({text, count});
+        }
+    }
+
+    public flush() {
+        if (this.added.length === 0) { return; }
+        Profiler.begin(ProfileZone.MessageLog);
+        const container = this.container;
+        for (const message of this.added) {
+            this.messages.push(message);
+        }
+        const newContents = document.createDocumentFragment();
+        for (const message of this.added.slice(-this.numLines_)) {
+            MessageLogView.createMessage(message).appendTo(newContents);
+        }
+        this.added.length = 0;
+        let excess = container.childElementCount + newContents.childElementCount - this.numLines_;
+        while (excess-- > 0 && isNotNull(container.firstChild)) {
+            container.removeChild(container.firstChild);
+        }
+        container.appendChild(newContents);
+        Profiler.end(ProfileZone.MessageLog);
+    }
+
+    private updateHeight() {
+        this.container.style.height = `${this.lineHeight.value * this.numLines_}${this.lineHeight.unit}`;
+    }
+
+    private redraw() {
+        const container = this.container;
+        this.updateHeight();
+        const range = document.createRange();
+        const first = container.firstChild;
+        const last = container.lastChild;
+        if (isNotNull(first) && isNotNull(last)) {
+            range.setStartBefore(first);
+            range.setEndAfter(last);
+            range.deleteContents();
+        }
+        const newContents = document.createDocumentFragment();
+        for (const message of this.messages.last(this.numLines_)) {
+            MessageLogView.createMessage(message).appendTo(newContents);
+        }
+        container.appendChild(newContents);
+    }
+
+    public get numLines(): number {
+        return this.numLines_;
+    }
+
+    public set numLines(value: number) {
+        if (value !== this.numLines_) {
+            this.numLines_ = value;
+            this.redraw();
+        }
+    }
+}
@@ -0,0 +1,102 @@
+import { Array2d } from "./Array2d";
+import { Location } from "./components/Location";
+import { Vision } from "./components/Vision";
+import { DungeonLevel } from "./DungeonLevel";
+import { Entity } from "./entities/Entity";
+import { Human } from "./entities/Human";
+import { seesObserver, Visibility } from "./fov";
+import { chebyshevDistance } from "./geometry";
+
+export type Seer = Entity & typeof Location.Component.prototype & typeof Vision.Component.prototype;
+
+function visibleIn(fov: Array2d, r: number, cx: number, cy: number, x: number, y: number): boolean {
+    return fov.columns[x - cx + r][y - cy + r] === Visibility.Visible;
+}
+
+// Who sees whom, derived from the FOVs of the player side alone.
+// Digital FOV is symmetric, a cell within range of both ends is seen from an observer
+// exactly when the observer is seen from it, so a monster within its own radius
+// of an observer sees the observer when the FOV of the observer contains the monster.
+// Monsters only compute an FOV of their own when they need to know the terrain.
+// scripts/perception.js checks both queries against an FOV per monster.
+export class Perception {
+    // the observers of every level, rebuilt after the actors change
+    private readonly observers_: Map<DungeonLevel, Array<Seer>> = new Map();
+
+    public invalidate() {
+        this.observers_.clear();
+    }
+
+    // the humans on the level, their FOVs are the ones everything else is derived from
+    public observers(level: DungeonLevel): Array<Seer> {
+        let observers = this.observers_.get(level);
+        if (observers === undefined) {
+            observers = [];
+            for (const entity of level.entities) {
+                if (entity instanceof Human && entity.hasComponents(Location.Component, Vision.Component)) {
+                    observers.push(entity);
+                }
+            }
+            this.observers_.set(level, observers);
+        }
+        return observers;
+    }
+
+    // the observers on the level of the seer that it can see
+    public observersSeenBy(seer: Seer): Array<Seer> {
+        const {dungeonLevel: level, x, y} = seer.location;
+        const radius = seer.vision.fovRadius;
+        const seen: Array<Seer> = [];
+        for (const observer of this.observers(level)) {
+            const {x: ox, y: oy} = observer.location;
+            const sees = observer !== seer && seesObserver(
+                x, y, radius, ox, oy, observer.vision.fovRadius,
+                () => observer.vision.fov, () => level.lineOfSight(x, y, ox, oy)
+            );
+            if (sees) {
+                seen.push(observer);
+            }
+        }
+        return seen;
+    }
+
+    // everything but the observers that sees the cell, at most one FOV is computed for it
+    public seersOf(level: DungeonLevel, x: number, y: number): Array<Seer> {
+        const observers = this.observers(level);
+        const candidates: Array<Seer> = [];
+        let reach = 0;
+        for (const entity of level.entities) {
+            if (entity instanceof Human || !entity.hasComponents(Location.Component, Vision.Component)) { continue; }
+            const radius = entity.vision.fovRadius;
+            if (chebyshevDistance(x, y, entity.location.x, entity.location.y) <= radius) {
+                candidates.push(entity);
+                reach = Math.max(reach, radius);
+            }
+        }
+        if (candidates.length === 0) { return []; }
+
+        // an observer standing on the cell already has its FOV
+        let fov: Array2d;
+        let r: number;
+        let owned = false;
+        const observer = observers.find(o => o.location.x === x && o.location.y === y);
+        if (observer !== undefined) {
+            fov = observer.vision.fov;
+            r = observer.vision.fovRadius;
+        } else {
+            fov = level.getFieldOfViewAt(x, y, reach);
+            r = reach;
+            owned = true;
+        }
+        const seers = candidates.filter(seer => {
+            const {x: sx, y: sy} = seer.location;
+            return chebyshevDistance(x, y, sx, sy) <= r ?
+                visibleIn(fov, r, x, y, sx, sy) :
+                level.lineOfSight(sx, sy, x, y);
+        });
+        if (owned) {
+            fov.dispose();
+        }
+        return seers;
+    }
+}
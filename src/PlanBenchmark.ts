@@ -0,0 +1,58 @@
+import { filterEntities } from "./components/Component";
+import { Controlled } from "./components/Controlled";
+import { Game } from "./Game";
+import { Profiler, ProfileZone } from "./Profiler";
+
+export interface PlanBenchmarkResult {
+    readonly workers: number;
+    readonly turns: number;
+    // actors on the level when the game ended
+    readonly actors: number;
+    // from the end of one player turn to the end of the next, a round of every actor
+    readonly msPerTurn: number;
+    // of which waiting for the workers
+    readonly planMsPerTurn: number;
+}
+
+// milliseconds per player turn of a headless game on a crowded level,
+// with the AI deciding on the main thread and ahead of its turns in workers
+export async function benchmarkPlanner(
+    rounds: number = 300,
+    monsters: number = 150,
+    seed: number = 1
+): Promise<Array<PlanBenchmarkResult>> {
+    const cores = navigator.hardwareConcurrency || 4;
+    const results: Array<PlanBenchmarkResult> = [];
+    for (const workers of [0, 1, cores]) {
+        const game = new Game({seed, headless: true, aiPlayer: true, maxRounds: rounds, aiWorkers: workers});
+        game.populate(game.level, monsters);
+        let first = true;
+        let turns = 0;
+        let turnMs = 0;
+        let planMs = 0;
+        Profiler.enable(profile => {
+            // the first turn waits for the workers to load
+            if (first) {
+                first = false;
+            } else {
+                turns++;
+                turnMs += profile.zones[ProfileZone.Turn];
+                planMs += profile.zones[ProfileZone.Plan];
+            }
+        });
+        try {
+            await game.run();
+        } finally {
+            Profiler.disable();
+        }
+        results.push({
+            workers,
+            turns,
+            actors: filterEntities(game.level.entities, Controlled.Component).length,
+            msPerTurn: turnMs / Math.max(turns, 1),
+            planMsPerTurn: planMs / Math.max(turns, 1)
+        });
+        game.dispose();
+    }
+    return results;
+}
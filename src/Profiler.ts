@@ -0,0 +1,170 @@
+import { enumSize } from "./utils";
+
+export enum ProfileZone {
+    // from the end of one player turn to the end of the next
+    Turn,
+    GetAction,
+    Execute,
+    Fov,
+    Pathmap,
+    AStar,
+    Draw,
+    MessageLog,
+    // waiting for the AI workers
+    Plan,
+    // generating new levels
+    Mapgen
+}
+
+export enum ProfileCounter {
+    FovCalls,
+    LosCalls,
+    CellsExpanded,
+    PathCalls,
+    Allocations,
+    CanvasCalls,
+    // reported by the C kernel itself
+    KernelFovCalls,
+    KernelLosCalls,
+    KernelCellsVisited,
+    // only counted by the wasm-check build
+    KernelFovMismatches
+}
+
+export interface TurnProfile {
+    readonly turn: number;
+    // milliseconds spent in each zone
+    readonly zones: Float64Array;
+    readonly counters: Float64Array;
+}
+
+const numZones = enumSize(ProfileZone);
+const numCounters = enumSize(ProfileCounter);
+// trace events kept before the oldest ones are overwritten
+const maxEvents = 1 << 16;
+const maxTurns = 1 << 12;
+const microsecondsPerMs = 1000;
+
+// Scoped timers and counters around the hot paths.
+// Disabled by default, when disabled every call returns right away.
+export class Profiler {
+    private static enabled_: boolean = false;
+    private static readonly openedAt: Float64Array = new Float64Array(numZones);
+    private static readonly depth: Uint16Array = new Uint16Array(numZones);
+    private static readonly turnZones: Float64Array = new Float64Array(numZones);
+    private static readonly turnCounters: Float64Array = new Float64Array(numCounters);
+    private static turnStart: number = 0;
+    private static turn: number = 0;
+    // ring of completed zones for the trace
+    private static readonly eventZone: Uint8Array = new Uint8Array(maxEvents);
+    private static readonly eventStart: Float64Array = new Float64Array(maxEvents);
+    private static readonly eventDuration: Float64Array = new Float64Array(maxEvents);
+    private static numEvents: number = 0;
+    // ring of per turn counter totals for the trace
+    private static readonly turnEnd: Float64Array = new Float64Array(maxTurns);
+    private static readonly turnCounterHistory: Float64Array = new Float64Array(maxTurns * numCounters);
+    private static onTurnEnd: ((profile: TurnProfile) => void) | null = null;
+
+    public static get enabled(): boolean {
+        return Profiler.enabled_;
+    }
+
+    public static enable(onTurnEnd: ((profile: TurnProfile) => void) | null = null) {
+        Profiler.enabled_ = true;
+        Profiler.onTurnEnd = onTurnEnd;
+        Profiler.turnStart = performance.now();
+    }
+
+    public static disable() {
+        Profiler.enabled_ = false;
+        Profiler.depth.fill(0);
+    }
+
+    public static begin(zone: ProfileZone) {
+        if (!Profiler.enabled_) { return; }
+        // only the outermost of nested entries is timed
+        if (Profiler.depth[zone]++ === 0) {
+            Profiler.openedAt[zone] = performance.now();
+        }
+    }
+
+    public static end(zone: ProfileZone) {
+        if (!Profiler.enabled_ || Profiler.depth[zone] === 0) { return; }
+        if (--Profiler.depth[zone] === 0) {
+            const start = Profiler.openedAt[zone];
+            const duration = performance.now() - start;
+            Profiler.turnZones[zone] += duration;
+            Profiler.recordEvent(zone, start, duration);
+        }
+    }
+
+    public static count(counter: ProfileCounter, amount: number = 1) {
+        if (!Profiler.enabled_) { return; }
+        Profiler.turnCounters[counter] += amount;
+    }
+
+    private static recordEvent(zone: ProfileZone, start: number, duration: number) {
+        const i = Profiler.numEvents++ % maxEvents;
+        Profiler.eventZone[i] = zone;
+        Profiler.eventStart[i] = start;
+        Profiler.eventDuration[i] = duration;
+    }
+
+    // closes the current turn and starts a new one
+    public static endTurn() {
+        if (!Profiler.enabled_) { return; }
+        const now = performance.now();
+        const duration = now - Profiler.turnStart;
+        Profiler.turnZones[ProfileZone.Turn] = duration;
+        Profiler.recordEvent(ProfileZone.Turn, Profiler.turnStart, duration);
+        Profiler.turnStart = now;
+
+        const slot = Profiler.turn % maxTurns;
+        Profiler.turnEnd[slot] = now;
+        Profiler.turnCounterHistory.set(Profiler.turnCounters, slot * numCounters);
+        const profile: TurnProfile = {
+            turn: Profiler.turn++,
+            zones: Profiler.turnZones.slice(),
+            counters: Profiler.turnCounters.slice()
+        };
+        Profiler.turnZones.fill(0);
+        Profiler.turnCounters.fill(0);
+        if (Profiler.onTurnEnd !== null) {
+            Profiler.onTurnEnd(profile);
+        }
+    }
+
+    // everything still in the rings as Chrome trace event JSON
+    public static exportTrace(): string {
+        const traceEvents: Array<object> = [];
+        const firstEvent = Math.max(Profiler.numEvents - maxEvents, 0);
+        for (let n = firstEvent; n < Profiler.numEvents; n++) {
+            const i = n % maxEvents;
+            traceEvents.push({
+                name: ProfileZone[Profiler.eventZone[i]],
+                cat: "punycrawl",
+                ph: "X",
+                ts: Profiler.eventStart[i] * microsecondsPerMs,
+                dur: Profiler.eventDuration[i] * microsecondsPerMs,
+                pid: 1,
+                tid: 1
+            });
+        }
+        const firstTurn = Math.max(Profiler.turn - maxTurns, 0);
+        for (let n = firstTurn; n < Profiler.turn; n++) {
+            const slot = n % maxTurns;
+            const args: {[name: string]: number} = {};
+            for (let c = 0; c < numCounters; c++) {
+                args[ProfileCounter[c]] = Profiler.turnCounterHistory[slot * numCounters + c];
+            }
+            traceEvents.push({
+                name: "Counters",
+                ph: "C",
+                ts: Profiler.turnEnd[slot] * microsecondsPerMs,
+                pid: 1,
+                args
+            });
+        }
+        return JSON.stringify({traceEvents, displayTimeUnit: "ms"});
+    }
+}
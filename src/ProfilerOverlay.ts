@@ -0,0 +1,27 @@
+import { ProfileCounter, ProfileZone, TurnProfile } from "./Profiler";
+import { v } from "./vdom";
+
+// Summary of the last turn in the corner of the screen.
+export class ProfilerOverlay {
+    private static readonly containerClassName: string = "profiler-overlay";
+    private readonly container: HTMLElement;
+
+    constructor(parent: HTMLElement) {
+        this.container = v("pre", {class: ProfilerOverlay.containerClassName}).appendTo(parent);
+    }
+
+    public update(profile: TurnProfile) {
+        const lines = [`Turn ${profile.turn}`];
+        for (let zone = 0; zone < profile.zones.length; zone++) {
+            lines.push(`${ProfileZone[zone]}: ${profile.zones[zone].toFixed(2)} ms`);
+        }
+        for (let counter = 0; counter < profile.counters.length; counter++) {
+            lines.push(`${ProfileCounter[counter]}: ${profile.counters[counter]}`);
+        }
+        this.container.textContent = lines.join("\n");
+    }
+
+    public dispose() {
+        this.container.remove();
+    }
+}
@@ -1,10 +1,25 @@
-import { MersenneTwister } from "./MersenneTwister";
+import { createRandomBackend, RandomBackend, RandomBackendKind } from "./RandomBackend";
 
-export class Random extends MersenneTwister {
+const twoPow32 = 0x100000000;
+// products below 2^53 are exact as doubles
+const exactProductLimit = 0x200000;
+
+// high 32 bits of the 64-bit product of two uint32
+function mulHigh32(a: number, b: number): number {
+    if (b <= exactProductLimit) {
+        return Math.floor(a * b / twoPow32);
+    }
+    const hi = (a >>> 16) * b;
+    const lo = (a & 0xffff) * b;
+    return Math.floor(hi / 0x10000) + Math.floor(((hi % 0x10000) * 0x10000 + lo) / twoPow32);
+}
+
+export class Random {
+    private backend: RandomBackend;
     private _seed: number;
 
-    constructor(seed: number = Date.now()) {
-        super(seed);
+    constructor(seed: number = Date.now(), backend: RandomBackendKind = RandomBackendKind.Xoshiro256) {
+        this.backend = createRandomBackend(backend, seed);
         this._seed = seed;
     }
 
@@ -12,15 +27,58 @@ export class Random extends MersenneTwister {
         return this._seed;
     }
 
+    public get backendKind(): RandomBackendKind {
+        return this.backend.kind;
+    }
+
+    // the backend kind followed by the state of the backend
+    public getState(): Uint32Array {
+        const backendState = this.backend.getState();
+        const state = new Uint32Array(backendState.length + 1);
+        state[0] = this.backend.kind;
+        state.set(backendState, 1);
+        return state;
+    }
+
+    public setState(seed: number, state: Uint32Array) {
+        const kind: RandomBackendKind = state[0];
+        if (kind !== this.backend.kind) {
+            this.backend.dispose();
+            this.backend = createRandomBackend(kind, seed);
+        }
+        this.backend.setState(state.subarray(1));
+        this._seed = seed;
+    }
+
+    public uint32(): number {
+        return this.backend.nextUint32();
+    }
+
+    // in range [0, 1)
+    public random(): number {
+        return this.backend.nextUint32() / twoPow32;
+    }
+
     public coinflip(): boolean {
-        return this.genrand_int32() % 2 === 0;
+        return this.backend.nextUint32() < 0x80000000;
     }
 
+    // unbiased integer in range [0, max) using Lemire's multiply and reject method
     public random2(max: number) {
         if (max <= 1) {
             return 0;
         }
-        return this.genrand_int32() % max;
+        const range = max >>> 0;
+        let x = this.backend.nextUint32();
+        let low = Math.imul(x, range) >>> 0;
+        if (low < range) {
+            const threshold = (twoPow32 - range) % range;
+            while (low < threshold) {
+                x = this.backend.nextUint32();
+                low = Math.imul(x, range) >>> 0;
+            }
+        }
+        return mulHigh32(x, range);
     }
 
     public randomRange(low: number, hi: number): number {
@@ -31,8 +89,21 @@ export class Random extends MersenneTwister {
     public diceRoll(num: number, size: number): number {
         let result = 0;
         if (num > 0 && size > 0) {
-            for (let i = 0; i < num; i++) {
-                result += this.random2(size);
+            // as many dice as fit in 32 bits are read out of a single draw
+            let remaining = num;
+            while (remaining > 0) {
+                let outcomes = size;
+                let dice = 1;
+                while (dice < remaining && outcomes * size < twoPow32) {
+                    outcomes *= size;
+                    dice++;
+                }
+                let roll = this.random2(outcomes);
+                for (let i = 0; i < dice; i++) {
+                    result += roll % size;
+                    roll = Math.floor(roll / size);
+                }
+                remaining -= dice;
             }
         }
         return result;
@@ -46,4 +117,8 @@ export class Random extends MersenneTwister {
         }
         return this.random2(den) < num;
     }
+
+    public dispose() {
+        this.backend.dispose();
+    }
 }
@@ -0,0 +1,149 @@
+import { MersenneTwister } from "./MersenneTwister";
+
+interface RngModule extends EmscriptenModule {
+    _rng_create(kind: number, seedLo: number, seedHi: number, poolSize: number): number;
+    _rng_free(rng: number): void;
+    _rng_pool(rng: number): number;
+    _rng_state(rng: number): number;
+    _rng_fill(rng: number): void;
+}
+
+declare const Module: RngModule;
+
+const NULL = 0;
+const sizeofUint32 = Uint32Array.BYTES_PER_ELEMENT;
+const twoPow32 = 0x100000000;
+// numbers generated by one call into wasm
+const poolSize = 1024;
+// 4 * uint64
+const wasmStateWords = 8;
+
+export enum RandomBackendKind {
+    MersenneTwister,
+    Xoshiro256,
+    Pcg32
+}
+
+// source of uniformly distributed 32-bit integers
+export interface RandomBackend {
+    readonly kind: RandomBackendKind;
+    nextUint32(): number;
+    getState(): Uint32Array;
+    setState(state: Uint32Array): void;
+    dispose(): void;
+}
+
+export class MersenneTwisterBackend extends MersenneTwister implements RandomBackend {
+    public readonly kind = RandomBackendKind.MersenneTwister;
+
+    public nextUint32(): number {
+        return this.genrand_int32();
+    }
+
+    // the state vector followed by the index into it
+    public getState(): Uint32Array {
+        const state = new Uint32Array(this.mt.length + 1);
+        for (let i = 0; i < this.mt.length; i++) {
+            state[i] = this.mt[i];
+        }
+        state[this.mt.length] = this.mti;
+        return state;
+    }
+
+    public setState(state: Uint32Array) {
+        if (state.length !== this.mt.length + 1) {
+            throw new Error("Invalid MersenneTwister state size");
+        }
+        for (let i = 0; i < this.mt.length; i++) {
+            this.mt[i] = state[i];
+        }
+        this.mti = state[this.mt.length];
+    }
+
+    // tslint:disable-next-line
+    public dispose() {}
+}
+
+// Generator running in wasm that fills a pool of numbers at a time.
+// The pool is copied out of the heap so it stays valid if the heap grows.
+export class PooledWasmBackend implements RandomBackend {
+    private ptr: number;
+    private readonly pool: Uint32Array = new Uint32Array(poolSize);
+    private index: number = poolSize;
+    // the generator state the current pool was generated from
+    private readonly poolOrigin: Uint32Array = new Uint32Array(wasmStateWords);
+
+    constructor(
+        public readonly kind: RandomBackendKind.Xoshiro256 | RandomBackendKind.Pcg32,
+        seed: number
+    ) {
+        const wasmKind = kind === RandomBackendKind.Xoshiro256 ? 0 : 1;
+        const seedLo = seed >>> 0;
+        const seedHi = Math.floor(seed / twoPow32) >>> 0;
+        if ((this.ptr = Module._rng_create(wasmKind, seedLo, seedHi, poolSize)) === NULL) {
+            throw new Error("Failed to create random number generator");
+        }
+    }
+
+    public nextUint32(): number {
+        if (this.index >= poolSize) {
+            this.refill();
+        }
+        return this.pool[this.index++];
+    }
+
+    private stateView(): Uint32Array {
+        const offset = Module._rng_state(this.ptr) / sizeofUint32;
+        return Module.HEAPU32.subarray(offset, offset + wasmStateWords);
+    }
+
+    private refill() {
+        this.poolOrigin.set(this.stateView());
+        Module._rng_fill(this.ptr);
+        const offset = Module._rng_pool(this.ptr) / sizeofUint32;
+        this.pool.set(Module.HEAPU32.subarray(offset, offset + poolSize));
+        this.index = 0;
+    }
+
+    // the state the current pool came from followed by the position in the pool
+    public getState(): Uint32Array {
+        const state = new Uint32Array(wasmStateWords + 1);
+        if (this.index >= poolSize) {
+            state.set(this.stateView());
+        } else {
+            state.set(this.poolOrigin);
+        }
+        state[wasmStateWords] = this.index;
+        return state;
+    }
+
+    public setState(state: Uint32Array) {
+        if (state.length !== wasmStateWords + 1) {
+            throw new Error("Invalid generator state size");
+        }
+        this.stateView().set(state.subarray(0, wasmStateWords));
+        const index = state[wasmStateWords];
+        if (index >= poolSize) {
+            this.index = poolSize;
+        } else {
+            this.refill();
+            this.index = index;
+        }
+    }
+
+    public dispose() {
+        Module._rng_free(this.ptr);
+        this.ptr = NULL;
+    }
+}
+
+export function createRandomBackend(kind: RandomBackendKind, seed: number): RandomBackend {
+    switch (kind) {
+        case RandomBackendKind.MersenneTwister:
+            return new MersenneTwisterBackend(seed);
+        case RandomBackendKind.Xoshiro256:
+        case RandomBackendKind.Pcg32:
+            return new PooledWasmBackend(kind, seed);
+    }
+    throw new Error(`Unknown random backend ${kind}`);
+}
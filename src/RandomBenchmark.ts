@@ -0,0 +1,40 @@
+import { Random } from "./Random";
+import { RandomBackendKind } from "./RandomBackend";
+
+export interface RandomBenchmarkResult {
+    readonly backend: string;
+    readonly uint32PerMs: number;
+    readonly random2PerMs: number;
+    readonly diceRollPerMs: number;
+}
+
+function measure(iterations: number, fn: () => number): number {
+    // the sink keeps the loop from being optimized away
+    let sink = 0;
+    const start = performance.now();
+    for (let i = 0; i < iterations; i++) {
+        sink += fn();
+    }
+    const elapsed = performance.now() - start;
+    if (sink === -1) {
+        console.log(sink);
+    }
+    return Math.round(iterations / Math.max(elapsed, 1e-3));
+}
+
+// calls per millisecond of the hot Random methods for every backend
+export function benchmarkRandom(iterations: number = 5000000, seed: number = 1): Array<RandomBenchmarkResult> {
+    const results: Array<RandomBenchmarkResult> = [];
+    const kinds = [RandomBackendKind.MersenneTwister, RandomBackendKind.Xoshiro256, RandomBackendKind.Pcg32];
+    for (const kind of kinds) {
+        const rng = new Random(seed, kind);
+        results.push({
+            backend: RandomBackendKind[kind],
+            uint32PerMs: measure(iterations, () => rng.uint32()),
+            random2PerMs: measure(iterations, () => rng.random2(100)),
+            diceRollPerMs: measure(iterations, () => rng.diceRoll(3, 6))
+        });
+        rng.dispose();
+    }
+    return results;
+}
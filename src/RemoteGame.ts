@@ -0,0 +1,139 @@
+import { Bind } from "./decorators";
+import { GameClient } from "./GameClient";
+import { Keyboard } from "./Keyboard";
+import { createRenderChannel, RenderChannelReader } from "./RenderChannel";
+import { assertNotNull, isDefined } from "./utils";
+
+// set by wasm-loader.js, the worker loads the same build as the page
+declare const wasmBuild: string;
+
+// how often the channel is read while the page is hidden and gets no animation frames
+const hiddenReadMs = 100;
+
+export interface RemoteGameOptions {
+    readonly seed?: number;
+    readonly aiWorkers?: number;
+    readonly aiPlayer?: boolean;
+    readonly maxRounds?: number;
+}
+
+// the first message to the game worker, the ones after it are key presses
+export interface RemoteGameInit extends RemoteGameOptions {
+    readonly wasmBuild: string;
+    // without a shared channel the frames are posted one by one
+    readonly channel: SharedArrayBuffer | null;
+}
+
+// what the game worker posts to the main thread
+export interface RemoteGameMessage {
+    readonly frame?: Uint8Array;
+    readonly error?: string;
+}
+
+// Runs the game in a worker so that a slow turn never blocks input or drawing.
+// The main thread forwards key presses to the worker and draws the frames it sends.
+// Frames come through a shared RenderChannel read once per animation frame,
+// or as messages when the page is not cross-origin isolated and has no SharedArrayBuffer.
+// A hidden page still reads the channel on a timer so the game worker never waits for it to be shown.
+export class RemoteGame {
+    private readonly worker: Worker;
+    private readonly keyboard: Keyboard = new Keyboard();
+    private readonly channel: SharedArrayBuffer | null;
+    private readonly reader: RenderChannelReader | null;
+    private hiddenTimer: number | null = null;
+    // frames were applied while hidden and are drawn with the next animation frame
+    private unpresented: boolean = false;
+
+    constructor(private readonly client: GameClient, private readonly options: RemoteGameOptions = {}) {
+        this.channel = typeof SharedArrayBuffer === "function" ? createRenderChannel() : null;
+        this.reader = this.channel !== null ? new RenderChannelReader(this.channel) : null;
+        this.worker = new Worker("game-worker.js");
+        this.worker.onmessage = this.onMessage;
+    }
+
+    public async run() {
+        await this.client.ready();
+        const init: RemoteGameInit = {...this.options, wasmBuild, channel: this.channel};
+        this.worker.postMessage(init);
+        if (this.reader !== null) {
+            requestAnimationFrame(this.onAnimationFrame);
+            document.addEventListener("visibilitychange", this.onVisibilityChange);
+            this.onVisibilityChange();
+        }
+        for await (const keyPress of this.keyboard.keyPresses) {
+            this.worker.postMessage({code: keyPress.code, key: keyPress.key});
+        }
+    }
+
+    private finish() {
+        this.keyboard.dispose();
+        this.keyboard.keyPresses.terminate();
+        if (this.reader !== null) {
+            document.removeEventListener("visibilitychange", this.onVisibilityChange);
+            this.stopHiddenReads();
+        }
+    }
+
+    // applies every frame in the channel, true if there was any
+    private applyFrames(): boolean {
+        const reader = assertNotNull(this.reader);
+        let frame: Uint8Array | null;
+        let applied = false;
+        while ((frame = reader.read()) !== null) {
+            this.client.apply(frame);
+            applied = true;
+        }
+        return applied;
+    }
+
+    private stopHiddenReads() {
+        if (this.hiddenTimer !== null) {
+            clearInterval(this.hiddenTimer);
+            this.hiddenTimer = null;
+        }
+    }
+
+    @Bind
+    private onVisibilityChange() {
+        if (document.hidden && this.hiddenTimer === null) {
+            this.hiddenTimer = window.setInterval(this.onHiddenRead, hiddenReadMs);
+        } else if (!document.hidden) {
+            this.stopHiddenReads();
+        }
+    }
+
+    @Bind
+    private onHiddenRead() {
+        if (this.applyFrames()) {
+            this.unpresented = true;
+        }
+    }
+
+    // draws every frame that arrived since the last animation frame at once
+    @Bind
+    private onAnimationFrame() {
+        if (this.applyFrames() || this.unpresented) {
+            this.unpresented = false;
+            this.client.present();
+        }
+        if (this.client.finished) {
+            this.finish();
+        } else {
+            requestAnimationFrame(this.onAnimationFrame);
+        }
+    }
+
+    @Bind
+    private onMessage(e: MessageEvent) {
+        const message = e.data as RemoteGameMessage;
+        if (isDefined(message.error)) {
+            console.error(message.error);
+            this.finish();
+        } else if (isDefined(message.frame)) {
+            this.client.push(message.frame);
+            if (this.client.finished) {
+                this.finish();
+            }
+        }
+    }
+}
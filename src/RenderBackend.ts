@@ -0,0 +1,72 @@
+import { Color } from "./Color";
+import { SpriteManager } from "./SpriteManager";
+
+export enum RenderBackendKind {
+    Canvas,
+    Compositor
+}
+
+// Primitive drawing operations of the view.
+// All coordinates are in pixels.
+export interface RenderBackend {
+    readonly kind: RenderBackendKind;
+    // number of calls made to the canvas since the counter was reset
+    canvasCalls: number;
+    clear(x: number, y: number, w: number, h: number): void;
+    fill(x: number, y: number, w: number, h: number, color: Color): void;
+    sprite(id: SpriteId, x: number, y: number): void;
+    // applies to subsequent fills and sprites
+    setAlpha(alpha: number): void;
+    // moves the current image by (dx, dy), the exposed area is cleared
+    scroll(dx: number, dy: number): void;
+    present(): void;
+}
+
+export class CanvasBackend implements RenderBackend {
+    public readonly kind = RenderBackendKind.Canvas;
+    public canvasCalls: number = 0;
+    private readonly ctx: CanvasRenderingContext2D;
+
+    constructor(
+        private readonly canvas: HTMLCanvasElement,
+        private readonly sprites: SpriteManager
+    ) {
+        const ctx = this.canvas.getContext("2d");
+        if (ctx === null) {
+            throw new Error("Failed to get CanvasRenderingContext2D");
+        }
+        this.ctx = ctx;
+    }
+
+    public clear(x: number, y: number, w: number, h: number) {
+        this.ctx.clearRect(x, y, w, h);
+        this.canvasCalls++;
+    }
+
+    public fill(x: number, y: number, w: number, h: number, color: Color) {
+        this.ctx.fillStyle = color;
+        this.ctx.fillRect(x, y, w, h);
+        this.canvasCalls++;
+    }
+
+    public sprite(id: SpriteId, x: number, y: number) {
+        this.sprites.draw(this.ctx, id, x, y);
+        this.canvasCalls++;
+    }
+
+    public setAlpha(alpha: number) {
+        this.ctx.globalAlpha = alpha;
+    }
+
+    public scroll(dx: number, dy: number) {
+        const ctx = this.ctx;
+        ctx.globalCompositeOperation = "copy";
+        ctx.drawImage(this.canvas, dx, dy);
+        ctx.globalCompositeOperation = "source-over";
+        this.canvasCalls++;
+    }
+
+    // draws immediately
+    // tslint:disable-next-line
+    public present() {}
+}
@@ -0,0 +1,123 @@
+// Single producer single consumer ring of frames in a SharedArrayBuffer.
+// The game worker writes, the main thread reads, neither takes a lock:
+// the writer publishes a frame by storing the new head after copying it in
+// and the reader frees it by storing the new tail after copying it out.
+// Frames are prefixed with their length and may wrap around the end of the ring.
+
+const enum Header {
+    // bytes ever written and read, they wrap around at 2^32
+    Head,
+    Tail,
+    NUM_FIELDS
+}
+
+const headerBytes = Header.NUM_FIELDS * Int32Array.BYTES_PER_ELEMENT;
+const lengthBytes = Uint32Array.BYTES_PER_ELEMENT;
+// how long a full writer waits before looking at the tail again
+const writerWaitMs = 50;
+
+// not in the TypeScript lib yet, and missing in some browsers
+interface WaitAsyncResult {
+    readonly async: boolean;
+    readonly value: Promise<string> | string;
+}
+const atomics = Atomics as typeof Atomics & {
+    waitAsync?(array: Int32Array, index: number, value: number, timeout?: number): WaitAsyncResult;
+};
+
+export function createRenderChannel(capacity: number = 1 << 20): SharedArrayBuffer {
+    if (capacity <= 0 || (capacity & (capacity - 1)) !== 0) {
+        throw new Error("RenderChannel capacity must be a power of two");
+    }
+    return new SharedArrayBuffer(headerBytes + capacity);
+}
+
+abstract class RenderChannelEnd {
+    protected readonly header: Int32Array;
+    protected readonly data: Uint8Array;
+    protected readonly mask: number;
+
+    constructor(buffer: SharedArrayBuffer) {
+        this.header = new Int32Array(buffer, 0, Header.NUM_FIELDS);
+        this.data = new Uint8Array(buffer, headerBytes);
+        this.mask = this.data.length - 1;
+    }
+
+    public get capacity(): number {
+        return this.data.length;
+    }
+
+    // bytes written but not read yet
+    public get used(): number {
+        return (Atomics.load(this.header, Header.Head) - Atomics.load(this.header, Header.Tail)) >>> 0;
+    }
+}
+
+export class RenderChannelWriter extends RenderChannelEnd {
+    private readonly lengthPrefix: Uint8Array = new Uint8Array(lengthBytes);
+    private readonly lengthView: DataView = new DataView(this.lengthPrefix.buffer);
+
+    private copyIn(position: number, bytes: Uint8Array) {
+        const start = position & this.mask;
+        const first = Math.min(bytes.length, this.data.length - start);
+        this.data.set(bytes.subarray(0, first), start);
+        if (first < bytes.length) {
+            this.data.set(bytes.subarray(first), 0);
+        }
+    }
+
+    // false if the reader has not made room for the frame yet
+    public tryWrite(frame: Uint8Array): boolean {
+        const size = lengthBytes + frame.length;
+        if (size > this.data.length) {
+            throw new Error("Frame does not fit in the RenderChannel");
+        }
+        const head = Atomics.load(this.header, Header.Head);
+        if (this.capacity - this.used < size) {
+            return false;
+        }
+        this.lengthView.setUint32(0, frame.length, true);
+        this.copyIn(head, this.lengthPrefix);
+        this.copyIn(head + lengthBytes, frame);
+        Atomics.store(this.header, Header.Head, (head + size) | 0);
+        Atomics.notify(this.header, Header.Head, 1);
+        return true;
+    }
+
+    // resolves once the reader moved the tail or after writerWaitMs,
+    // never blocks so the writer's thread keeps handling its messages
+    public waitForRoom(): Promise<void> {
+        if (typeof atomics.waitAsync !== "function") {
+            return new Promise(resolve => setTimeout(resolve, writerWaitMs));
+        }
+        const result = atomics.waitAsync(this.header, Header.Tail, Atomics.load(this.header, Header.Tail), writerWaitMs);
+        return result.async ? (result.value as Promise<string>).then(() => undefined) : Promise.resolve();
+    }
+}
+
+export class RenderChannelReader extends RenderChannelEnd {
+    private copyOut(position: number, target: Uint8Array) {
+        const start = position & this.mask;
+        const first = Math.min(target.length, this.data.length - start);
+        target.set(this.data.subarray(start, start + first));
+        if (first < target.length) {
+            target.set(this.data.subarray(0, target.length - first), first);
+        }
+    }
+
+    // a copy of the oldest unread frame, null if there is none
+    public read(): Uint8Array | null {
+        if (this.used === 0) {
+            return null;
+        }
+        const tail = Atomics.load(this.header, Header.Tail);
+        const prefix = new Uint8Array(lengthBytes);
+        this.copyOut(tail, prefix);
+        const length = new DataView(prefix.buffer).getUint32(0, true);
+        const frame = new Uint8Array(length);
+        this.copyOut(tail + lengthBytes, frame);
+        Atomics.store(this.header, Header.Tail, (tail + lengthBytes + length) | 0);
+        Atomics.notify(this.header, Header.Tail, 1);
+        return frame;
+    }
+}
@@ -0,0 +1,176 @@
+import { ByteReader, ByteWriter } from "./ByteBuffer";
+import { Visibility } from "./fov";
+import { Id } from "./Id";
+import { SerializedNode } from "./vdom";
+
+// Everything the game shows is sent as a stream of frames of these records,
+// so the view can be drawn on another thread than the one running the game.
+export enum DeltaKind {
+    // starts the frame, moves the camera
+    View,
+    Cell,
+    EntityMove,
+    EntityHealth,
+    EntityRemove,
+    Message,
+    Menu,
+    GameOver
+}
+
+const enum ViewFlags {
+    // forget everything sent so far, every cell and entity in view is sent again
+    Repaint = 1
+}
+
+// terrain of a cell that has not been seen or is outside the level
+export const Unexplored = 0xff;
+const NoSprite = 0xffff;
+
+export interface DeltaHandler {
+    view(cameraX: number, cameraY: number, repaint: boolean): void;
+    // terrain and visibility of a cell, out of sight cells come with what is remembered of them
+    cell(x: number, y: number, visibility: Visibility, terrain: number, object: SpriteId | null): void;
+    // a visible entity appeared or moved
+    entityMove(id: Id, sprite: SpriteId, x: number, y: number): void;
+    entityHealth(id: Id, fraction: number): void;
+    // out of sight, gone from the level or destroyed
+    entityRemove(id: Id): void;
+    message(text: string, count: number): void;
+    // null closes the menu
+    menu(node: SerializedNode | null): void;
+    gameOver(): void;
+}
+
+// where the frames go, the view on the same thread or a channel to another one
+export interface FrameSink {
+    // resolves once frames can be shown, e.g. after the sprites loaded
+    // or once the frames pushed so far were handed on
+    ready(): Promise<void>;
+    push(frame: Uint8Array): void;
+}
+
+// Collects the records of a frame until it is flushed to the sink.
+// Without a sink nothing is shown, writers can check enabled to skip the work.
+export class DeltaEncoder {
+    private writer: ByteWriter = new ByteWriter();
+
+    constructor(private readonly sink: FrameSink | null) {}
+
+    public get enabled(): boolean {
+        return this.sink !== null;
+    }
+
+    public view(cameraX: number, cameraY: number, repaint: boolean) {
+        this.writer.u8(DeltaKind.View);
+        this.writer.i32(cameraX);
+        this.writer.i32(cameraY);
+        this.writer.u8(repaint ? ViewFlags.Repaint : 0);
+    }
+
+    public cell(x: number, y: number, visibility: Visibility, terrain: number, object: SpriteId | null) {
+        this.writer.u8(DeltaKind.Cell);
+        // cells outside the level can be in view
+        this.writer.i32(x);
+        this.writer.i32(y);
+        this.writer.u8(visibility);
+        this.writer.u8(terrain);
+        this.writer.u16(object === null ? NoSprite : object);
+    }
+
+    public entityMove(id: Id, sprite: SpriteId, x: number, y: number) {
+        this.writer.u8(DeltaKind.EntityMove);
+        this.writer.u32(id);
+        this.writer.u16(sprite);
+        this.writer.u16(x);
+        this.writer.u16(y);
+    }
+
+    public entityHealth(id: Id, fraction: number) {
+        this.writer.u8(DeltaKind.EntityHealth);
+        this.writer.u32(id);
+        this.writer.f64(fraction);
+    }
+
+    public entityRemove(id: Id) {
+        this.writer.u8(DeltaKind.EntityRemove);
+        this.writer.u32(id);
+    }
+
+    public message(text: string, count: number) {
+        this.writer.u8(DeltaKind.Message);
+        this.writer.u16(count);
+        this.writer.string(text);
+    }
+
+    public menu(node: SerializedNode | null) {
+        this.writer.u8(DeltaKind.Menu);
+        this.writer.string(node === null ? "" : JSON.stringify(node));
+    }
+
+    public gameOver() {
+        this.writer.u8(DeltaKind.GameOver);
+    }
+
+    // sends what was written since the last flush as one frame
+    public flush() {
+        if (this.writer.length === 0) { return; }
+        if (this.sink !== null) {
+            this.sink.push(this.writer.finish());
+        }
+        this.writer = new ByteWriter();
+    }
+}
+
+export function decodeFrame(frame: Uint8Array, handler: DeltaHandler) {
+    const reader = new ByteReader(frame);
+    while (reader.remaining > 0) {
+        const kind = reader.u8() as DeltaKind;
+        switch (kind) {
+        case DeltaKind.View: {
+            const cameraX = reader.i32();
+            const cameraY = reader.i32();
+            handler.view(cameraX, cameraY, (reader.u8() & ViewFlags.Repaint) !== 0);
+            break;
+        }
+        case DeltaKind.Cell: {
+            const x = reader.i32();
+            const y = reader.i32();
+            const visibility = reader.u8() as Visibility;
+            const terrain = reader.u8();
+            const object = reader.u16();
+            handler.cell(x, y, visibility, terrain, object === NoSprite ? null : object as SpriteId);
+            break;
+        }
+        case DeltaKind.EntityMove: {
+            const id = reader.u32();
+            const sprite = reader.u16() as SpriteId;
+            const x = reader.u16();
+            handler.entityMove(id, sprite, x, reader.u16());
+            break;
+        }
+        case DeltaKind.EntityHealth: {
+            const id = reader.u32();
+            handler.entityHealth(id, reader.f64());
+            break;
+        }
+        case DeltaKind.EntityRemove:
+            handler.entityRemove(reader.u32());
+            break;
+        case DeltaKind.Message: {
+            const count = reader.u16();
+            handler.message(reader.string(), count);
+            break;
+        }
+        case DeltaKind.Menu: {
+            const json = reader.string();
+            handler.menu(json === "" ? null : JSON.parse(json) as SerializedNode);
+            break;
+        }
+        case DeltaKind.GameOver:
+            handler.gameOver();
+            break;
+        default:
+            throw new Error(`Unknown render delta ${kind}`);
+        }
+    }
+}
@@ -0,0 +1,236 @@
+import { Action, ActionKind } from "./actions/Action";
+import { ActionFactory } from "./actions/ActionFactory";
+import { ByteReader, ByteWriter } from "./ByteBuffer";
+import { ControllerKind, IController } from "./Controller";
+import { Entity } from "./entities/Entity";
+import { Game } from "./Game";
+import { RandomBackendKind } from "./RandomBackend";
+
+/*
+Recording of the actions of a keyboard controlled player.
+
+header
+    u8[4]   magic "PUNR"
+    u16     version
+    f64     seed
+    u8      random backend kind
+    u8      1 if the AI decided ahead of its turns in workers, see AIPlanner
+entries, each starting with a u8 tag
+    action  u8 kind followed by its arguments
+    hash    u32 hash of the game state right after the previous action
+*/
+
+const magic = [0x50, 0x55, 0x4e, 0x52];
+const version = 3;
+// player actions between two state hashes
+const hashInterval = 32;
+const noTarget = -1;
+
+const enum Entry {
+    Action,
+    Hash
+}
+
+function writeAction(writer: ByteWriter, action: Action) {
+    writer.u8(action.kind);
+    switch (action.kind) {
+        case ActionKind.Move:
+        case ActionKind.Attack:
+            writer.u8(action.dx + 1);
+            writer.u8(action.dy + 1);
+            break;
+        case ActionKind.ClimbStairs:
+            writer.u8(action.direction);
+            break;
+        case ActionKind.Pickup:
+            writer.i32(action.targetId === null ? noTarget : action.targetId);
+            break;
+        case ActionKind.Drop:
+        case ActionKind.Equip:
+        case ActionKind.Unequip:
+            writer.i32(action.targetId);
+            break;
+    }
+}
+
+function readAction(reader: ByteReader): Action {
+    const kind: ActionKind = reader.u8();
+    switch (kind) {
+        case ActionKind.Move: {
+            const dx = reader.u8() - 1;
+            return ActionFactory.createMoveAction(dx, reader.u8() - 1);
+        }
+        case ActionKind.Attack: {
+            const dx = reader.u8() - 1;
+            return ActionFactory.createAttackAction(dx, reader.u8() - 1);
+        }
+        case ActionKind.ClimbStairs: {
+            const climb = ActionFactory.createClimbStairsAction();
+            climb.direction = reader.u8();
+            return climb;
+        }
+        case ActionKind.Rest:
+            return ActionFactory.createRestAction();
+        case ActionKind.Pickup: {
+            const pickup = ActionFactory.createPickupAction();
+            const targetId = reader.i32();
+            pickup.targetId = targetId === noTarget ? null : targetId;
+            return pickup;
+        }
+        case ActionKind.Drop:
+            return ActionFactory.createDropAction(reader.i32());
+        case ActionKind.Equip:
+            return ActionFactory.createEquipAction(reader.i32());
+        case ActionKind.Unequip:
+            return ActionFactory.createUnequipAction(reader.i32());
+    }
+    throw new Error(`Unknown action kind ${kind} in recording`);
+}
+
+export class Recorder {
+    private readonly writer: ByteWriter = new ByteWriter();
+    private numActions: number = 0;
+
+    constructor(seed: number, rngBackend: RandomBackendKind, planned: boolean) {
+        for (const byte of magic) {
+            this.writer.u8(byte);
+        }
+        this.writer.u16(version);
+        this.writer.f64(seed);
+        this.writer.u8(rngBackend);
+        this.writer.u8(planned ? 1 : 0);
+    }
+
+    public get actions(): number {
+        return this.numActions;
+    }
+
+    // called after the action has been executed
+    public record(game: Game, action: Action) {
+        this.writer.u8(Entry.Action);
+        writeAction(this.writer, action);
+        if (++this.numActions % hashInterval === 0) {
+            this.writer.u8(Entry.Hash);
+            this.writer.u32(game.stateHash());
+        }
+    }
+
+    // the recording so far, recording can go on afterwards
+    public finish(): Uint8Array {
+        return this.writer.finish();
+    }
+}
+
+export interface ReplayReport {
+    readonly actions: number;
+    readonly checkpoints: number;
+    // number of replayed actions when the state first differed from the recording
+    readonly divergedAt: number | null;
+    readonly finalHash: number;
+    readonly milliseconds: number;
+}
+
+export class Replay {
+    public readonly seed: number;
+    public readonly rngBackend: RandomBackendKind;
+    // intents made ahead of the turns can differ from what an actor decides on its turn
+    public readonly planned: boolean;
+    private readonly reader: ByteReader;
+    private numActions: number = 0;
+    private checkpoints: number = 0;
+    private divergedAt: number | null = null;
+
+    constructor(data: Uint8Array) {
+        this.reader = new ByteReader(data);
+        for (const byte of magic) {
+            if (this.reader.u8() !== byte) {
+                throw new Error("Not a recording");
+            }
+        }
+        const dataVersion = this.reader.u16();
+        if (dataVersion !== version) {
+            throw new Error(`Unsupported recording version ${dataVersion}`);
+        }
+        this.seed = this.reader.f64();
+        this.rngBackend = this.reader.u8();
+        this.planned = this.reader.u8() !== 0;
+    }
+
+    // the next recorded action or null at the end of the recording
+    public nextAction(): Action | null {
+        if (this.reader.remaining === 0) {
+            return null;
+        }
+        if (this.reader.u8() !== Entry.Action) {
+            throw new Error("Corrupt recording");
+        }
+        this.numActions++;
+        return readAction(this.reader);
+    }
+
+    // called after the replayed action has been executed
+    // returns false if the game no longer matches the recording
+    public verify(game: Game): boolean {
+        if (this.reader.remaining === 0 || this.reader.peekU8() !== Entry.Hash) {
+            return true;
+        }
+        this.reader.u8();
+        const expected = this.reader.u32();
+        this.checkpoints++;
+        if (game.stateHash() !== expected) {
+            if (this.divergedAt === null) {
+                this.divergedAt = this.numActions;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    public report(game: Game, milliseconds: number): ReplayReport {
+        return {
+            actions: this.numActions,
+            checkpoints: this.checkpoints,
+            divergedAt: this.divergedAt,
+            finalHash: game.stateHash(),
+            milliseconds
+        };
+    }
+}
+
+export class ReplayController extends IController {
+    public readonly kind = ControllerKind.Replay;
+
+    constructor(
+        game: Game,
+        actor: Entity,
+        private readonly replay: Replay
+    ) {
+        super(game, actor);
+    }
+
+    public async getAction(): Promise<Action> {
+        const action = this.replay.nextAction();
+        if (action === null) {
+            // the game ends before this is executed
+            this.game.stop();
+            return ActionFactory.createRestAction();
+        }
+        return action;
+    }
+
+    // tslint:disable-next-line
+    public dispose() {}
+}
+
+// fast-forwards a recording as fast as possible without rendering
+export async function runReplay(data: Uint8Array): Promise<ReplayReport> {
+    const replay = new Replay(data);
+    // the intents do not depend on how many workers share the actors, one is enough
+    const aiWorkers = replay.planned ? 1 : 0;
+    const game = new Game({seed: replay.seed, rngBackend: replay.rngBackend, headless: true, replay, aiWorkers});
+    const start = performance.now();
+    await game.run();
+    const report = replay.report(game, performance.now() - start);
+    game.dispose();
+    return report;
+}
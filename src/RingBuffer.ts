@@ -0,0 +1,52 @@
+// Fixed capacity buffer that overwrites its oldest items when full.
+export class RingBuffer<T> {
+    private readonly items: Array<T | undefined>;
+    private start: number = 0;
+    private length_: number = 0;
+
+    constructor(public readonly capacity: number) {
+        if (capacity < 1) {
+            throw new Error("RingBuffer capacity must be positive");
+        }
+        this.items = new Array(capacity);
+    }
+
+    public get length(): number {
+        return this.length_;
+    }
+
+    public push(item: T) {
+        const end = (this.start + this.length_) % this.capacity;
+        this.items[end] = item;
+        if (this.length_ < this.capacity) {
+            this.length_++;
+        } else {
+            this.start = (this.start + 1) % this.capacity;
+        }
+    }
+
+    // 0 is the oldest item
+    public get(i: number): T {
+        if (i < 0 || i >= this.length_) {
+            throw new RangeError("RingBuffer index out of range");
+        }
+        return this.items[(this.start + i) % this.capacity] as T;
+    }
+
+    public clear() {
+        this.items.fill(undefined);
+        this.start = 0;
+        this.length_ = 0;
+    }
+
+    // the newest n items from oldest to newest
+    public *last(n: number): IterableIterator<T> {
+        for (let i = Math.max(this.length_ - n, 0); i < this.length_; i++) {
+            yield this.get(i);
+        }
+    }
+
+    public [Symbol.iterator](): IterableIterator<T> {
+        return this.last(this.length_);
+    }
+}
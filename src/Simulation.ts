@@ -0,0 +1,51 @@
+import { collectKernelStats } from "./fov";
+import { Game, GameEventTopic } from "./Game";
+import { ProfileCounter, Profiler, ProfileZone } from "./Profiler";
+import { GameOutcome, GameResult, TurnHistogram } from "./SimulationStats";
+
+// Plays one headless game where the AI controls every actor, the player included.
+// Used by scripts/simulate.js, one game at a time per worker since the profiler is global.
+export async function simulateGame(seed: number, maxRounds: number): Promise<GameResult> {
+    const histogram = new TurnHistogram();
+    let playerTurns = 0;
+    let fovCalls = 0;
+    let pathCalls = 0;
+    let cellsExpanded = 0;
+    collectKernelStats();
+    Profiler.enable(profile => {
+        playerTurns++;
+        histogram.add(profile.zones[ProfileZone.Turn]);
+        fovCalls += profile.counters[ProfileCounter.FovCalls];
+        pathCalls += profile.counters[ProfileCounter.PathCalls];
+        cellsExpanded += profile.counters[ProfileCounter.CellsExpanded];
+    });
+
+    const game = new Game({seed, headless: true, aiPlayer: true, maxRounds});
+    let kills = 0;
+    game.addEventListener(GameEventTopic.Death, entity => {
+        if (entity !== game.trackedEntity) {
+            kills++;
+        }
+    });
+    const start = performance.now();
+    try {
+        await game.run();
+    } finally {
+        Profiler.disable();
+    }
+    const ms = performance.now() - start;
+    const result: GameResult = {
+        seed,
+        outcome: game.trackedEntity === null ? GameOutcome.Died : GameOutcome.Survived,
+        rounds: game.round,
+        playerTurns,
+        kills,
+        ms,
+        fovCalls,
+        pathCalls,
+        cellsExpanded,
+        turnCosts: histogram.counts
+    };
+    game.dispose();
+    return result;
+}
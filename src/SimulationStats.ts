@@ -0,0 +1,160 @@
+import { Random } from "./Random";
+import { RandomBackendKind } from "./RandomBackend";
+
+// Statistics of batch simulated games.
+// Kept apart from Game so that the runner can aggregate without loading wasm.
+
+export enum GameOutcome {
+    // the player died
+    Died,
+    // the round limit was reached
+    Survived
+}
+
+export interface GameSummary {
+    readonly seed: number;
+    readonly outcome: GameOutcome;
+    readonly rounds: number;
+    readonly playerTurns: number;
+    readonly kills: number;
+    readonly ms: number;
+    readonly fovCalls: number;
+    readonly pathCalls: number;
+    readonly cellsExpanded: number;
+}
+
+export interface GameResult extends GameSummary {
+    // bucket counts of the time each player turn took, see TurnHistogram
+    readonly turnCosts: Array<number>;
+}
+
+// smallest turn time that gets its own bucket, and the growth of each bucket after it
+const histogramBase = 0.001;
+const histogramGrowth = 1.1;
+const numBuckets = 200;
+
+// Log scale histogram, quantiles are accurate to one bucket (10%).
+export class TurnHistogram {
+    public readonly counts: Array<number>;
+    private total_: number = 0;
+
+    constructor(counts: Array<number> | null = null) {
+        this.counts = counts === null ? new Array(numBuckets).fill(0) : counts.slice();
+        for (const count of this.counts) {
+            this.total_ += count;
+        }
+    }
+
+    public get total(): number {
+        return this.total_;
+    }
+
+    public add(ms: number) {
+        const bucket = ms <= histogramBase ? 0 :
+            Math.min(Math.ceil(Math.log(ms / histogramBase) / Math.log(histogramGrowth)), numBuckets - 1);
+        this.counts[bucket]++;
+        this.total_++;
+    }
+
+    public merge(counts: Array<number>) {
+        for (let i = 0; i < numBuckets; i++) {
+            this.counts[i] += counts[i];
+            this.total_ += counts[i];
+        }
+    }
+
+    // upper bound of the bucket holding the quantile, in ms
+    public quantile(q: number): number {
+        if (this.total_ === 0) { return 0; }
+        const rank = Math.ceil(q * this.total_);
+        let seen = 0;
+        for (let i = 0; i < numBuckets; i++) {
+            seen += this.counts[i];
+            if (seen >= rank) {
+                return histogramBase * Math.pow(histogramGrowth, i);
+            }
+        }
+        return histogramBase * Math.pow(histogramGrowth, numBuckets - 1);
+    }
+}
+
+export interface SimulationReport {
+    readonly games: number;
+    readonly workers: number;
+    readonly wallMs: number;
+    readonly outcomes: {[outcome: string]: number};
+    readonly rounds: {readonly mean: number, readonly max: number};
+    readonly kills: {readonly mean: number};
+    readonly playerTurns: number;
+    readonly turnsPerSecond: number;
+    readonly turnCostMs: {readonly p50: number, readonly p99: number};
+    readonly perTurn: {readonly fovCalls: number, readonly pathCalls: number, readonly cellsExpanded: number};
+    readonly results: Array<GameSummary>;
+}
+
+// seeds of the games of a batch, the same master seed gives the same batch
+export function batchSeeds(masterSeed: number, count: number): Array<number> {
+    const rng = new Random(masterSeed, RandomBackendKind.MersenneTwister);
+    const seeds: Array<number> = [];
+    for (let i = 0; i < count; i++) {
+        seeds.push(rng.uint32());
+    }
+    rng.dispose();
+    return seeds;
+}
+
+export function summarize(results: Array<GameResult>, workers: number, wallMs: number): SimulationReport {
+    const histogram = new TurnHistogram();
+    const outcomes: {[outcome: string]: number} = {};
+    let rounds = 0;
+    let maxRounds = 0;
+    let kills = 0;
+    let turns = 0;
+    let gameMs = 0;
+    let fovCalls = 0;
+    let pathCalls = 0;
+    let cellsExpanded = 0;
+    for (const result of results) {
+        histogram.merge(result.turnCosts);
+        const outcome = GameOutcome[result.outcome];
+        outcomes[outcome] = (outcomes[outcome] || 0) + 1;
+        rounds += result.rounds;
+        maxRounds = Math.max(maxRounds, result.rounds);
+        kills += result.kills;
+        turns += result.playerTurns;
+        gameMs += result.ms;
+        fovCalls += result.fovCalls;
+        pathCalls += result.pathCalls;
+        cellsExpanded += result.cellsExpanded;
+    }
+    const games = Math.max(results.length, 1);
+    const perTurn = Math.max(turns, 1);
+    return {
+        games: results.length,
+        workers,
+        wallMs,
+        outcomes,
+        rounds: {mean: rounds / games, max: maxRounds},
+        kills: {mean: kills / games},
+        playerTurns: turns,
+        // per core, the wall clock rate is roughly this times the number of workers
+        turnsPerSecond: gameMs > 0 ? turns / (gameMs / 1000) : 0,
+        turnCostMs: {p50: histogram.quantile(0.5), p99: histogram.quantile(0.99)},
+        perTurn: {
+            fovCalls: fovCalls / perTurn,
+            pathCalls: pathCalls / perTurn,
+            cellsExpanded: cellsExpanded / perTurn
+        },
+        results: results.map(result => ({
+            seed: result.seed,
+            outcome: result.outcome,
+            rounds: result.rounds,
+            playerTurns: result.playerTurns,
+            kills: result.kills,
+            ms: result.ms,
+            fovCalls: result.fovCalls,
+            pathCalls: result.pathCalls,
+            cellsExpanded: result.cellsExpanded
+        }))
+    };
+}
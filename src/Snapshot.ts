@@ -0,0 +1,376 @@
+import { AIController } from "./AIController";
+import { ByteReader, ByteWriter } from "./ByteBuffer";
+import { Attributes } from "./components/Attributes";
+import { Controlled } from "./components/Controlled";
+import { Damageable } from "./components/Damageable";
+import { Equipable } from "./components/Equipable";
+import { Equipment } from "./components/Equipment";
+import { Location } from "./components/Location";
+import { Storage } from "./components/Storage";
+import { ControllerKind } from "./Controller";
+import { DungeonLevel } from "./DungeonLevel";
+import { Entity } from "./entities/Entity";
+import { Goblin } from "./entities/Goblin";
+import { Human } from "./entities/Human";
+import { Trinket } from "./entities/Trinket";
+import { Game } from "./Game";
+import { Id } from "./Id";
+import { TileMemory } from "./TileMemory";
+import { assertDefined, isDefined } from "./utils";
+
+/*
+Binary snapshot of a game.
+
+header
+    u8[4]   magic "PUNY"
+    u16     version
+    u16     number of levels
+    u32[2]  offset and length of the section of each level, 0 if never generated
+game
+    f64     rng seed, u16 rng state length, u32[] rng state starting with the backend kind
+    u32     next entity id
+    u32     round, i32 id of the actor whose turn it is or -1
+    u32     next coarse simulation round
+    u16     current depth, i32 tracked entity id or -1
+level
+    u32     round it went to sleep on
+    u32     terrain length, u8[] run-length encoded terrain
+    u32     number of remembered chunks, then (u32 chunk index, u32[] explored bits, u8[] remembered cells)
+            a remembered cell is the terrain kind in the low nibble and sprite id + 1 in the high nibble
+    u32     number of entities, then the entities sorted by id
+            actors store their energy, controller kind and the state their controller saves
+    u32     number of placed entities, then (id, x, y) in placement order
+
+Levels are only decoded when the dungeon first asks for them.
+*/
+
+const magic = [0x50, 0x55, 0x4e, 0x59];
+const version = 1;
+const noId = -1;
+
+type EntityConstructor = new (game: Game) => Entity;
+// the index is the kind stored in the snapshot
+const entityKinds: Array<EntityConstructor> = [Human, Goblin, Trinket];
+// entities that are created by their owner, like default weapons
+const ownedKind = 0xff;
+
+const enum SavedComponent {
+    Controlled = 1 << 0,
+    Damageable = 1 << 1,
+    Attributes = 1 << 2,
+    Storage = 1 << 3,
+    Equipment = 1 << 4
+}
+
+export interface GameState {
+    readonly seed: number;
+    readonly rngState: Uint32Array;
+    readonly nextEntityId: Id;
+    readonly round: number;
+    readonly turnOf: Id | null;
+    readonly nextCoarseRound: number;
+    readonly depth: number;
+    readonly trackedId: Id | null;
+}
+
+function entityKind(entity: Entity): number {
+    const kind = entityKinds.indexOf(entity.constructor as EntityConstructor);
+    return kind < 0 ? ownedKind : kind;
+}
+
+// the entities that the given one carries
+function* ownedEntities(entity: Entity): IterableIterator<Entity> {
+    if (entity.hasComponent(Storage.Component)) {
+        yield* entity.storage;
+    }
+    if (entity.hasComponent(Equipment.Component)) {
+        yield* entity.equipment.slots.values();
+    }
+}
+
+function collectEntities(entity: Entity, found: Map<Id, Entity>) {
+    if (found.has(entity.id)) { return; }
+    found.set(entity.id, entity);
+    for (const owned of ownedEntities(entity)) {
+        collectEntities(owned, found);
+    }
+}
+
+function writeEntity(writer: ByteWriter, entity: Entity) {
+    writer.u32(entity.id);
+    writer.u8(entityKind(entity));
+    let mask = 0;
+    if (entity.hasComponent(Controlled.Component)) { mask |= SavedComponent.Controlled; }
+    if (entity.hasComponent(Damageable.Component)) { mask |= SavedComponent.Damageable; }
+    if (entity.hasComponent(Attributes.Component)) { mask |= SavedComponent.Attributes; }
+    if (entity.hasComponent(Storage.Component)) { mask |= SavedComponent.Storage; }
+    if (entity.hasComponent(Equipment.Component)) { mask |= SavedComponent.Equipment; }
+    writer.u8(mask);
+    if (entity.hasComponent(Controlled.Component)) {
+        const {energy, controller} = entity.controlled;
+        writer.f64(energy);
+        writer.u8(controller.kind);
+        // the length lets the controller read its state once the whole level is back
+        const lengthOffset = writer.length;
+        writer.u32(0);
+        controller.save(writer);
+        writer.setU32(lengthOffset, writer.length - lengthOffset - 4);
+    }
+    if (entity.hasComponent(Damageable.Component)) {
+        writer.f64(entity.damageable.health);
+    }
+    if (entity.hasComponent(Attributes.Component)) {
+        writer.bytesFrom(entity.attributes.values);
+    }
+    if (entity.hasComponent(Storage.Component)) {
+        writer.u16(entity.storage.size);
+        for (const item of entity.storage) {
+            writer.u32(item.id);
+        }
+    }
+    if (entity.hasComponent(Equipment.Component)) {
+        writer.u8(entity.equipment.slots.size);
+        for (const item of entity.equipment.slots.values()) {
+            writer.u32(item.id);
+        }
+    }
+}
+
+function writeMemory(writer: ByteWriter, memory: TileMemory) {
+    let numChunks = 0;
+    for (let i = 0; i < memory.numChunks; i++) {
+        if (isDefined(memory.chunk(i))) { numChunks++; }
+    }
+    writer.u32(numChunks);
+    for (let i = 0; i < memory.numChunks; i++) {
+        const chunk = memory.chunk(i);
+        if (!isDefined(chunk)) { continue; }
+        writer.u32(i);
+        writer.bytesFrom(chunk.explored);
+        writer.bytesFrom(chunk.snapshot);
+    }
+}
+
+function writeLevel(writer: ByteWriter, level: DungeonLevel, round: number) {
+    const hibernatedSince = level.hibernatedSince;
+    writer.u32(hibernatedSince === null ? round : hibernatedSince);
+    const terrain = level.encodeTerrain();
+    writer.u32(terrain.length);
+    writer.bytesFrom(terrain);
+    writeMemory(writer, level.memory);
+
+    const placed = level.entities;
+    const found: Map<Id, Entity> = new Map();
+    for (const entity of placed) {
+        collectEntities(entity, found);
+    }
+    const ids = Array.from(found.keys()).sort((a, b) => a - b);
+    writer.u32(ids.length);
+    for (const id of ids) {
+        writeEntity(writer, assertDefined(found.get(id)));
+    }
+    writer.u32(placed.length);
+    for (const entity of placed) {
+        const {x, y} = entity.assertHasComponent(Location.Component).location;
+        writer.u32(entity.id);
+        writer.u16(x);
+        writer.u16(y);
+    }
+}
+
+export function writeSnapshot(state: GameState, numLevels: number, levels: Array<DungeonLevel>): Uint8Array {
+    const writer = new ByteWriter(64 * 1024);
+    for (const byte of magic) {
+        writer.u8(byte);
+    }
+    writer.u16(version);
+    writer.u16(numLevels);
+    const tableOffset = writer.length;
+    for (let i = 0; i < numLevels * 2; i++) {
+        writer.u32(0);
+    }
+
+    writer.f64(state.seed);
+    writer.u16(state.rngState.length);
+    writer.bytesFrom(state.rngState);
+    writer.u32(state.nextEntityId);
+    writer.u32(state.round);
+    writer.i32(state.turnOf === null ? noId : state.turnOf);
+    writer.u32(state.nextCoarseRound);
+    writer.u16(state.depth);
+    writer.i32(state.trackedId === null ? noId : state.trackedId);
+
+    for (const level of levels) {
+        const start = writer.length;
+        writeLevel(writer, level, state.round);
+        writer.setU32(tableOffset + level.depth * 8, start);
+        writer.setU32(tableOffset + level.depth * 8 + 4, writer.length - start);
+    }
+    return writer.finish();
+}
+
+// references between entities are resolved after all of them exist
+interface EntityLinks {
+    readonly entity: Entity;
+    readonly stored: Array<Id>;
+    readonly equipped: Array<Id>;
+    readonly controllerKind: ControllerKind | null;
+    // where the saved controller state starts
+    readonly controllerOffset: number;
+}
+
+export class Snapshot {
+    public readonly state: GameState;
+    private readonly sections: Uint32Array;
+
+    // the data is kept as is and must not be modified afterwards
+    constructor(private readonly data: Uint8Array) {
+        const reader = new ByteReader(data);
+        for (const byte of magic) {
+            if (reader.u8() !== byte) {
+                throw new Error("Not a snapshot");
+            }
+        }
+        const dataVersion = reader.u16();
+        if (dataVersion !== version) {
+            throw new Error(`Unsupported snapshot version ${dataVersion}`);
+        }
+        const numLevels = reader.u16();
+        this.sections = new Uint32Array(numLevels * 2);
+        reader.bytesInto(this.sections);
+
+        const seed = reader.f64();
+        const rngState = new Uint32Array(reader.u16());
+        reader.bytesInto(rngState);
+        const nextEntityId = reader.u32();
+        const round = reader.u32();
+        const turnOf = reader.i32();
+        const nextCoarseRound = reader.u32();
+        const depth = reader.u16();
+        const trackedId = reader.i32();
+        this.state = {
+            seed, rngState, nextEntityId, round, nextCoarseRound, depth,
+            turnOf: turnOf === noId ? null : turnOf,
+            trackedId: trackedId === noId ? null : trackedId
+        };
+    }
+
+    public get byteLength(): number {
+        return this.data.byteLength;
+    }
+
+    public hasLevel(depth: number): boolean {
+        return depth * 2 < this.sections.length && this.sections[depth * 2 + 1] > 0;
+    }
+
+    // fills a freshly constructed level from its section
+    public restoreLevel(game: Game, level: DungeonLevel) {
+        if (!this.hasLevel(level.depth)) {
+            throw new Error(`Snapshot has no level ${level.depth}`);
+        }
+        const reader = new ByteReader(this.data, this.sections[level.depth * 2]);
+        const hibernatedAt = reader.u32();
+        const terrainLength = reader.u32();
+        // copied so that the hibernated level does not keep the whole snapshot alive
+        level.restoreTerrain(reader.bytesView(terrainLength).slice(), hibernatedAt);
+        const numMemoryChunks = reader.u32();
+        for (let i = 0; i < numMemoryChunks; i++) {
+            const chunkIdx = reader.u32();
+            const chunk = TileMemory.createChunk();
+            reader.bytesInto(chunk.explored);
+            reader.bytesInto(chunk.snapshot);
+            TileMemory.checkChunk(chunk);
+            level.memory.setChunk(chunkIdx, chunk);
+        }
+
+        const idCounter = Entity.nextId;
+        const restored: Map<Id, Entity> = new Map();
+        const links: Array<EntityLinks> = [];
+        const numEntities = reader.u32();
+        for (let i = 0; i < numEntities; i++) {
+            links.push(this.readEntity(game, reader, restored));
+        }
+        Entity.nextId = idCounter;
+
+        for (const {entity, stored, equipped} of links) {
+            if (entity.hasComponent(Storage.Component)) {
+                for (const id of stored) {
+                    entity.storage.add(assertDefined(restored.get(id)));
+                }
+            }
+            if (entity.hasComponent(Equipment.Component)) {
+                entity.equipment.slots.clear();
+                for (const id of equipped) {
+                    const item = assertDefined(restored.get(id));
+                    entity.equipment.equip(item.assertHasComponent(Equipable.Component));
+                }
+            }
+        }
+
+        const numPlaced = reader.u32();
+        for (let i = 0; i < numPlaced; i++) {
+            const entity = assertDefined(restored.get(reader.u32()));
+            const x = reader.u16();
+            const y = reader.u16();
+            level.putEntity(entity, x, y);
+        }
+
+        for (const {entity, controllerKind, controllerOffset} of links) {
+            if (controllerKind === null || !entity.hasComponent(Controlled.Component)) { continue; }
+            const {controlled} = entity;
+            // the player of a game played by the AI is created with a keyboard
+            if (controllerKind === ControllerKind.AI && controlled.controller.kind !== ControllerKind.AI) {
+                controlled.controller.dispose();
+                controlled.controller = new AIController(game, entity);
+            }
+            controlled.controller.restore(new ByteReader(this.data, controllerOffset), restored);
+        }
+    }
+
+    private readEntity(game: Game, reader: ByteReader, restored: Map<Id, Entity>): EntityLinks {
+        const id = reader.u32();
+        const kind = reader.u8();
+        let entity = restored.get(id);
+        if (!isDefined(entity)) {
+            if (kind === ownedKind || kind >= entityKinds.length) {
+                throw new Error(`Snapshot entity ${id} has no owner to create it`);
+            }
+            // constructors hand out ids in the same order as when the entity was first created
+            // so anything it creates for itself gets its old id back too
+            Entity.nextId = id;
+            entity = new entityKinds[kind](game);
+            collectEntities(entity, restored);
+        }
+        const mask = reader.u8();
+        const stored: Array<Id> = [];
+        const equipped: Array<Id> = [];
+        let controllerKind: ControllerKind | null = null;
+        let controllerOffset = 0;
+        if (mask & SavedComponent.Controlled) {
+            entity.assertHasComponent(Controlled.Component).controlled.energy = reader.f64();
+            controllerKind = reader.u8() as ControllerKind;
+            const length = reader.u32();
+            controllerOffset = reader.offset;
+            reader.bytesView(length);
+        }
+        if (mask & SavedComponent.Damageable) {
+            entity.assertHasComponent(Damageable.Component).damageable.health = reader.f64();
+        }
+        if (mask & SavedComponent.Attributes) {
+            reader.bytesInto(entity.assertHasComponent(Attributes.Component).attributes.values);
+        }
+        if (mask & SavedComponent.Storage) {
+            const size = reader.u16();
+            for (let i = 0; i < size; i++) {
+                stored.push(reader.u32());
+            }
+        }
+        if (mask & SavedComponent.Equipment) {
+            const size = reader.u8();
+            for (let i = 0; i < size; i++) {
+                equipped.push(reader.u32());
+            }
+        }
+        return {entity, stored, equipped, controllerKind, controllerOffset};
+    }
+}
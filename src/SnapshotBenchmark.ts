@@ -0,0 +1,75 @@
+import { DungeonLevel } from "./DungeonLevel";
+import { Game } from "./Game";
+
+export interface SnapshotBenchmarkResult {
+    readonly levels: number;
+    readonly entities: number;
+    readonly bytes: number;
+    readonly saveMs: number;
+    // the current level and the ones next to it, what a rollback pays before the next turn
+    readonly restoreMs: number;
+    // decoding the rest of the levels as well
+    readonly restoreAllMs: number;
+    // the hashed game state is the same after restoring
+    readonly identical: boolean;
+}
+
+// generates every level of the dungeon
+function allLevels(game: Game): Array<DungeonLevel> {
+    const levels: Array<DungeonLevel> = [];
+    let level: DungeonLevel | null;
+    for (let depth = 0; (level = game.getOrGenerateLevel(depth)) !== null; depth++) {
+        levels.push(level);
+    }
+    return levels;
+}
+
+// milliseconds to save and restore a headless game with every level generated and populated
+export async function benchmarkSnapshot(
+    rounds: number = 200,
+    repeats: number = 20,
+    seed: number = 1
+): Promise<SnapshotBenchmarkResult> {
+    const game = new Game({seed, headless: true, aiPlayer: true, maxRounds: rounds});
+    for (const level of allLevels(game)) {
+        if (level !== game.level) {
+            game.populate(level, 30);
+        }
+    }
+    await game.run();
+    const hash = game.stateHash();
+
+    let data = game.save();
+    let start = performance.now();
+    for (let i = 0; i < repeats; i++) {
+        data = game.save();
+    }
+    const saveMs = (performance.now() - start) / repeats;
+
+    let restoreMs = 0;
+    let restoreAllMs = 0;
+    let levels: Array<DungeonLevel> = [];
+    for (let i = 0; i < repeats; i++) {
+        start = performance.now();
+        game.restore(data);
+        const restored = performance.now();
+        levels = allLevels(game);
+        restoreMs += restored - start;
+        restoreAllMs += performance.now() - start;
+    }
+    let entities = 0;
+    for (const level of levels) {
+        entities += level.entities.length;
+    }
+    const result = {
+        levels: levels.length,
+        entities,
+        bytes: data.byteLength,
+        saveMs,
+        restoreMs: restoreMs / repeats,
+        restoreAllMs: restoreAllMs / repeats,
+        identical: game.stateHash() === hash
+    };
+    game.dispose();
+    return result;
+}
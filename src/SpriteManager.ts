@@ -1,17 +1,20 @@
 import { assertNotNull } from "./utils";
 
-interface SpritesheetMetadata {
-    [key: string]: Sprite;
-}
+// number of atlas fields per sprite: x, y, w, h
+const AtlasStride = 4;
 
-export class SpriteManager<T extends SpritesheetMetadata> {
+export class SpriteManager {
     private loaded_: boolean = false;
-    private metadata: T | null = null;
+    // packed x, y, w, h of each sprite indexed by SpriteId
+    private atlas: Int32Array | null = null;
+    // one pre-sliced bitmap per sprite if the browser supports them
+    private bitmaps: Array<ImageBitmap> | null = null;
     private readonly canvas: HTMLCanvasElement;
 
     constructor(
         private readonly sheetPath: string,
-        private readonly metaPath: string
+        private readonly atlasPath: string,
+        private readonly useBitmaps: boolean = typeof createImageBitmap === "function"
     ) {
         this.canvas = document.createElement("canvas");
     }
@@ -20,11 +23,15 @@ export class SpriteManager<T extends SpritesheetMetadata> {
         return this.loaded_;
     }
 
+    public get numSprites(): number {
+        return this.atlas === null ? 0 : this.atlas.length / AtlasStride;
+    }
+
     public load(): Promise<any> {
-        const metaLoad = fetch(this.metaPath)
-            .then(res => res.json())
-            .then(meta => {
-                this.metadata = meta as T;
+        const atlasLoad = fetch(this.atlasPath)
+            .then(res => res.arrayBuffer())
+            .then(buf => {
+                this.atlas = new Int32Array(buf);
             });
         const sheetLoad = new Promise((resolve, reject) => {
             const img = new Image();
@@ -39,22 +46,62 @@ export class SpriteManager<T extends SpritesheetMetadata> {
             };
             img.src = this.sheetPath;
         });
-        return Promise.all([metaLoad, sheetLoad]).then(() => {
+        return Promise.all([atlasLoad, sheetLoad]).then(() => {
+            if (this.useBitmaps) {
+                return this.sliceBitmaps();
+            }
+            return undefined;
+        }).then(() => {
             this.loaded_ = true;
         });
     }
 
-    public draw<S extends keyof T>(ctx: CanvasRenderingContext2D, spriteName: S, targetX: number, targetY: number) {
-        if (this.metadata === null) {
+    private sliceBitmaps(): Promise<void> {
+        const atlas = assertNotNull(this.atlas);
+        const slices: Array<Promise<ImageBitmap>> = [];
+        for (let i = 0; i < atlas.length; i += AtlasStride) {
+            slices.push(createImageBitmap(this.canvas, atlas[i], atlas[i + 1], atlas[i + 2], atlas[i + 3]));
+        }
+        return Promise.all(slices).then(bitmaps => {
+            this.bitmaps = bitmaps;
+        });
+    }
+
+    public getSprite(id: SpriteId): Sprite {
+        if (this.atlas === null) {
+            throw new Error("Sprite atlas has not been loaded");
+        }
+        const i = id * AtlasStride;
+        const atlas = this.atlas;
+        return {x: atlas[i], y: atlas[i + 1], w: atlas[i + 2], h: atlas[i + 3]};
+    }
+
+    // the decoded pixels of the whole sheet
+    public getSheetPixels(): ImageData {
+        if (!this.loaded) {
+            throw new Error("Spritesheet has not been loaded");
+        }
+        const ctx = assertNotNull(this.canvas.getContext("2d"));
+        return ctx.getImageData(0, 0, this.canvas.width, this.canvas.height);
+    }
+
+    public draw(ctx: CanvasRenderingContext2D, id: SpriteId, targetX: number, targetY: number) {
+        if (this.bitmaps !== null) {
+            ctx.drawImage(this.bitmaps[id], targetX, targetY);
+            return;
+        }
+        const atlas = this.atlas;
+        if (atlas === null) {
             if (this.loaded) {
-                throw new Error("Sprite metadata was null even after it was loaded");
+                throw new Error("Sprite atlas was null even after it was loaded");
             } else {
                 console.warn("Drawing sprite before it has loaded");
             }
             return;
         }
-        const sprite = this.metadata[spriteName];
-        const {x, y, w, h} = sprite;
-        ctx.drawImage(this.canvas, x, y, w, h, targetX, targetY, w, h);
+        const i = id * AtlasStride;
+        const w = atlas[i + 2];
+        const h = atlas[i + 3];
+        ctx.drawImage(this.canvas, atlas[i], atlas[i + 1], w, h, targetX, targetY, w, h);
     }
 }
@@ -2,9 +2,11 @@ import { Equipable } from "./components/Equipable";
 import { Equipment } from "./components/Equipment";
 import { Storage } from "./components/Storage";
 import { Entity } from "./entities/Entity";
+import { KeyPress } from "./Keyboard";
 import { BaseMenu, IMenu, MenuKind } from "./Menu";
+import { DeltaEncoder } from "./RenderDelta";
 import { isDefined, zip } from "./utils";
-import { v } from "./vdom";
+import { v, VirtualNode } from "./vdom";
 
 export class StorageMenu extends BaseMenu implements IMenu {
     protected static readonly containerClassName: string = "storage-menu";
@@ -13,12 +15,13 @@ export class StorageMenu extends BaseMenu implements IMenu {
 
     constructor(
         title: string,
-        public readonly storage: Storage
+        public readonly storage: Storage,
+        output: DeltaEncoder
     ) {
-        super(title);
+        super(title, output);
     }
 
-    public handleKeypress(keyPress: KeyboardEvent): Entity | null {
+    public handleKeypress(keyPress: KeyPress): Entity | null {
         const item = this.items.get(keyPress.key);
         if (isDefined(item)) {
             return item;
@@ -26,8 +29,7 @@ export class StorageMenu extends BaseMenu implements IMenu {
         return null;
     }
 
-    public display() {
-        super.display();
+    protected render(): VirtualNode<"div"> {
         const owner = this.storage.owner;
         const container = this.createContainer();
         container.attrs.classList.add(StorageMenu.containerClassName);
@@ -47,6 +49,6 @@ export class StorageMenu extends BaseMenu implements IMenu {
                 container.children.push(v("div", `[${id}] - ${entity.name}`));
             }
         }
-        this.container = container.appendTo(document.body);
+        return container;
     }
 }
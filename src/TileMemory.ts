@@ -0,0 +1,109 @@
+import { chunkArea, chunkShift, chunkSize } from "./Chunks";
+import { Grid } from "./Grid";
+import { TerrainKind } from "./Terrain";
+import { enumSize } from "./utils";
+
+const bitsPerWord = 32;
+const terrainMask = 0x0f;
+const objectShift = 4;
+// object nibble stores sprite id + 1, 0 means nothing
+const maxObjectId = (1 << (8 - objectShift)) - 2;
+const chunkMask = chunkSize - 1;
+
+const numTerrainKinds = enumSize(TerrainKind);
+
+// a kind or sprite that doesn't fit its nibble would be remembered as another one
+if (numTerrainKinds > terrainMask + 1) {
+    throw new Error(`${numTerrainKinds} terrain kinds don't fit the TileMemory terrain nibble`);
+}
+if (SpriteId.NUM_SPRITES - 1 > maxObjectId) {
+    throw new Error(`${SpriteId.NUM_SPRITES} sprites don't fit the TileMemory object nibble`);
+}
+
+export interface MemoryChunk {
+    readonly explored: Uint32Array;
+    readonly snapshot: Uint8Array;
+}
+
+// What has been seen of a level.
+// Uses one bit per cell to mark explored cells and one byte per cell
+// for the last seen terrain (low nibble) and object sprite (high nibble).
+// Stored in chunks that are allocated when something in them is first seen.
+export class TileMemory extends Grid {
+    public readonly chunksWide: number;
+    private readonly chunks: Array<MemoryChunk | undefined>;
+
+    constructor(width: number, height: number) {
+        super(width, height);
+        this.chunksWide = Math.ceil(width / chunkSize);
+        this.chunks = new Array(this.chunksWide * Math.ceil(height / chunkSize));
+    }
+
+    public static createChunk(): MemoryChunk {
+        return {
+            explored: new Uint32Array(chunkArea / bitsPerWord),
+            snapshot: new Uint8Array(chunkArea)
+        };
+    }
+
+    // throws if a chunk read from elsewhere remembers a kind or sprite that doesn't exist
+    public static checkChunk(chunk: MemoryChunk) {
+        for (const cell of chunk.snapshot) {
+            if ((cell & terrainMask) >= numTerrainKinds || (cell >>> objectShift) > SpriteId.NUM_SPRITES) {
+                throw new Error(`Invalid remembered cell ${cell}`);
+            }
+        }
+    }
+
+    public get numChunks(): number {
+        return this.chunks.length;
+    }
+
+    // undefined if nothing in the chunk has been seen
+    public chunk(chunkIdx: number): MemoryChunk | undefined {
+        return this.chunks[chunkIdx];
+    }
+
+    public setChunk(chunkIdx: number, chunk: MemoryChunk) {
+        if (chunkIdx >= this.chunks.length) {
+            throw new RangeError("Invalid TileMemory chunk index");
+        }
+        this.chunks[chunkIdx] = chunk;
+    }
+
+    private chunkAt(x: number, y: number): MemoryChunk | undefined {
+        return this.chunks[(y >>> chunkShift) * this.chunksWide + (x >>> chunkShift)];
+    }
+
+    public remember(x: number, y: number, terrain: TerrainKind, object: SpriteId | null) {
+        const chunkIdx = (y >>> chunkShift) * this.chunksWide + (x >>> chunkShift);
+        let chunk = this.chunks[chunkIdx];
+        if (chunk === undefined) {
+            chunk = this.chunks[chunkIdx] = TileMemory.createChunk();
+        }
+        const idx = ((x & chunkMask) << chunkShift) | (y & chunkMask);
+        chunk.explored[idx >>> 5] |= 1 << (idx & 31);
+        const objectBits = object === null ? 0 : object + 1;
+        chunk.snapshot[idx] = terrain | (objectBits << objectShift);
+    }
+
+    public isExplored(x: number, y: number): boolean {
+        const chunk = this.chunkAt(x, y);
+        if (chunk === undefined) { return false; }
+        const idx = ((x & chunkMask) << chunkShift) | (y & chunkMask);
+        return (chunk.explored[idx >>> 5] & (1 << (idx & 31))) !== 0;
+    }
+
+    public terrainAt(x: number, y: number): TerrainKind {
+        const chunk = this.chunkAt(x, y);
+        if (chunk === undefined) { return 0; }
+        return chunk.snapshot[((x & chunkMask) << chunkShift) | (y & chunkMask)] & terrainMask;
+    }
+
+    public objectAt(x: number, y: number): SpriteId | null {
+        const chunk = this.chunkAt(x, y);
+        if (chunk === undefined) { return null; }
+        const objectBits = chunk.snapshot[((x & chunkMask) << chunkShift) | (y & chunkMask)] >>> objectShift;
+        return objectBits === 0 ? null : objectBits - 1;
+    }
+}
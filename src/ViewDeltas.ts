@@ -0,0 +1,223 @@
+import { Array2d } from "./Array2d";
+import { Controlled } from "./components/Controlled";
+import { Damageable } from "./components/Damageable";
+import { Location } from "./components/Location";
+import { Renderable } from "./components/Renderable";
+import { Vision } from "./components/Vision";
+import { DungeonLevel } from "./DungeonLevel";
+import { Entity } from "./entities/Entity";
+import { Visibility } from "./fov";
+import { Id } from "./Id";
+import { Profiler, ProfileZone } from "./Profiler";
+import { DeltaEncoder, Unexplored } from "./RenderDelta";
+import { isNotNull } from "./utils";
+import { HalfViewH, HalfViewW, ViewHeight, ViewWidth } from "./ViewRenderer";
+
+// nothing has been sent for the view cell
+const Unsent = -1;
+
+// visibility, terrain and object of a cell in one number so a change is one comparison
+function packCell(visibility: Visibility, terrain: number, object: SpriteId | null): number {
+    return visibility | terrain << 8 | (object === null ? 0 : object + 1) << 16;
+}
+
+interface SentEntity {
+    x: number;
+    y: number;
+    sprite: SpriteId;
+    health: number | null;
+}
+
+// The game side of the view.
+// Turns what the viewer sees around the camera into render deltas, only looking at
+// cells that the level marked dirty, whose visibility changed or that came into view.
+// Cells are sent when what is drawn of them changed, visible entities when they appear,
+// move or get hurt, and entities that went out of sight are removed.
+// What is seen is remembered in the TileMemory of the level, which is game state.
+export class ViewDeltas {
+    private level: DungeonLevel | null = null;
+    private cameraX: number = 0;
+    private cameraY: number = 0;
+    // visibility of each view cell in the previous frame
+    private readonly visibility: Uint8Array = new Uint8Array(ViewWidth * ViewHeight);
+    private readonly dirty: Uint8Array = new Uint8Array(ViewWidth * ViewHeight);
+    // the packed cell last sent for each view cell
+    private readonly sent: Int32Array = new Int32Array(ViewWidth * ViewHeight).fill(Unsent);
+    private readonly entities: Map<Id, SentEntity> = new Map();
+    private repaint: boolean = true;
+
+    constructor(private readonly output: DeltaEncoder) {}
+
+    public invalidate() {
+        this.repaint = true;
+    }
+
+    private inView(vx: number, vy: number): boolean {
+        return vx >= 0 && vx < ViewWidth && vy >= 0 && vy < ViewHeight;
+    }
+
+    // shifts what was sent along with the camera, the cells that came into view are sent anew
+    private scroll(dx: number, dy: number) {
+        const visibility = new Uint8Array(this.visibility.length);
+        const sent = new Int32Array(this.sent.length);
+        for (let vy = 0; vy < ViewHeight; vy++) {
+            const oy = vy + dy;
+            for (let vx = 0; vx < ViewWidth; vx++) {
+                const ox = vx + dx;
+                const idx = vy * ViewWidth + vx;
+                if (this.inView(ox, oy)) {
+                    visibility[idx] = this.visibility[oy * ViewWidth + ox];
+                    sent[idx] = this.sent[oy * ViewWidth + ox];
+                } else {
+                    visibility[idx] = Visibility.NotVisible;
+                    sent[idx] = Unsent;
+                    this.dirty[idx] = 1;
+                }
+            }
+        }
+        this.visibility.set(visibility);
+        this.sent.set(sent);
+    }
+
+    private updateVisibility(viewer: Entity | null) {
+        const offsetX = this.cameraX - HalfViewW;
+        const offsetY = this.cameraY - HalfViewH;
+        let fov: Array2d | null = null;
+        let fovX = 0;
+        let fovY = 0;
+        if (isNotNull(viewer) && viewer.hasComponents(Vision.Component, Location.Component)) {
+            fov = viewer.vision.fov;
+            fovX = viewer.location.x - viewer.vision.fovRadius;
+            fovY = viewer.location.y - viewer.vision.fovRadius;
+        }
+        for (let vy = 0; vy < ViewHeight; vy++) {
+            for (let vx = 0; vx < ViewWidth; vx++) {
+                let vis = Visibility.NotVisible;
+                if (isNotNull(fov)) {
+                    const fx = vx + offsetX - fovX;
+                    const fy = vy + offsetY - fovY;
+                    if (fx >= 0 && fx < fov.width && fy >= 0 && fy < fov.height) {
+                        vis = fov.columns[fx][fy] as Visibility;
+                    }
+                }
+                const idx = vy * ViewWidth + vx;
+                if (this.visibility[idx] !== vis) {
+                    this.visibility[idx] = vis;
+                    this.dirty[idx] = 1;
+                }
+            }
+        }
+    }
+
+    private collectLevelChanges(level: DungeonLevel) {
+        const offsetX = this.cameraX - HalfViewW;
+        const offsetY = this.cameraY - HalfViewH;
+        for (const idx of level.takeDirtyCells()) {
+            const vx = idx % level.width - offsetX;
+            const vy = Math.floor(idx / level.width) - offsetY;
+            if (this.inView(vx, vy)) {
+                this.dirty[vy * ViewWidth + vx] = 1;
+            }
+        }
+    }
+
+    // sends the cell if it changed and collects the entities on it when it is visible
+    private updateCell(level: DungeonLevel, vx: number, vy: number, seen: Map<Id, SentEntity>) {
+        const idx = vy * ViewWidth + vx;
+        const x = vx + this.cameraX - HalfViewW;
+        const y = vy + this.cameraY - HalfViewH;
+        let visibility = this.visibility[idx] as Visibility;
+        let terrain: number = Unexplored;
+        // only out of sight cells carry an object, on visible ones the entities are drawn
+        let object: SpriteId | null = null;
+        if (!level.withinBounds(x, y)) {
+            visibility = Visibility.NotVisible;
+        } else if (visibility !== Visibility.Visible) {
+            const memory = level.memory;
+            if (memory.isExplored(x, y)) {
+                terrain = memory.terrainAt(x, y);
+                object = memory.objectAt(x, y);
+            }
+        } else {
+            terrain = level.terrainKindAt(x, y);
+            // actors move around so only remember objects
+            let remembered: SpriteId | null = null;
+            for (const entity of level.entitiesAt(x, y)) {
+                if (!entity.hasComponent(Renderable.Component)) { continue; }
+                const sprite = entity.renderable.sprite;
+                if (!entity.hasComponent(Controlled.Component)) {
+                    remembered = sprite;
+                }
+                const health = entity.hasComponent(Damageable.Component) ?
+                    Math.max(entity.damageable.health / entity.damageable.maxHealth, 0) : null;
+                seen.set(entity.id, {x, y, sprite, health});
+            }
+            level.memory.remember(x, y, terrain, remembered);
+        }
+        const cell = packCell(visibility, terrain, object);
+        if (this.sent[idx] !== cell) {
+            this.sent[idx] = cell;
+            this.output.cell(x, y, visibility, terrain, object);
+        }
+    }
+
+    // entities that are no longer where they were sent and were not seen elsewhere are gone
+    private updateEntities(seen: Map<Id, SentEntity>) {
+        const offsetX = this.cameraX - HalfViewW;
+        const offsetY = this.cameraY - HalfViewH;
+        for (const [id, entity] of this.entities) {
+            if (seen.has(id)) { continue; }
+            const vx = entity.x - offsetX;
+            const vy = entity.y - offsetY;
+            if (!this.inView(vx, vy) || this.dirty[vy * ViewWidth + vx] !== 0) {
+                this.entities.delete(id);
+                this.output.entityRemove(id);
+            }
+        }
+        for (const [id, entity] of seen) {
+            const prev = this.entities.get(id);
+            if (prev === undefined || prev.x !== entity.x || prev.y !== entity.y || prev.sprite !== entity.sprite) {
+                this.output.entityMove(id, entity.sprite, entity.x, entity.y);
+            }
+            if (entity.health !== null && (prev === undefined || prev.health !== entity.health)) {
+                this.output.entityHealth(id, entity.health);
+            }
+            this.entities.set(id, entity);
+        }
+    }
+
+    public render(level: DungeonLevel, viewer: Entity | null, cameraX: number, cameraY: number) {
+        Profiler.begin(ProfileZone.Draw);
+        const dx = cameraX - this.cameraX;
+        const dy = cameraY - this.cameraY;
+        const repaint = this.repaint || level !== this.level || Math.abs(dx) >= ViewWidth || Math.abs(dy) >= ViewHeight;
+        this.level = level;
+        if (!repaint && (dx !== 0 || dy !== 0)) {
+            this.scroll(dx, dy);
+        }
+        this.cameraX = cameraX;
+        this.cameraY = cameraY;
+        if (repaint) {
+            this.visibility.fill(Visibility.NotVisible);
+            this.dirty.fill(1);
+            this.sent.fill(Unsent);
+            this.entities.clear();
+            this.repaint = false;
+        }
+        this.output.view(cameraX, cameraY, repaint);
+        this.updateVisibility(viewer);
+        this.collectLevelChanges(level);
+
+        const seen: Map<Id, SentEntity> = new Map();
+        for (let vy = 0; vy < ViewHeight; vy++) {
+            for (let vx = 0; vx < ViewWidth; vx++) {
+                if (this.dirty[vy * ViewWidth + vx]) {
+                    this.updateCell(level, vx, vy, seen);
+                }
+            }
+        }
+        this.updateEntities(seen);
+        this.dirty.fill(0);
+        Profiler.end(ProfileZone.Draw);
+    }
+}
@@ -0,0 +1,246 @@
+import { Color, Red, rgb } from "./Color";
+import { CompositorBackend } from "./CompositorBackend";
+import { Visibility } from "./fov";
+import { Id } from "./Id";
+import { ProfileCounter, Profiler, ProfileZone } from "./Profiler";
+import { CanvasBackend, RenderBackend, RenderBackendKind } from "./RenderBackend";
+import { Unexplored } from "./RenderDelta";
+import { SpriteManager } from "./SpriteManager";
+import { Terrain, TerrainKind } from "./Terrain";
+import { isNotNull } from "./utils";
+import { v } from "./vdom";
+
+export const TilePixelSize = 32;
+// size in tiles, should be odd so that the camera can be centered properly
+export const ViewWidth = 41;
+export const ViewHeight = 25;
+export const HalfViewW = (ViewWidth - 1) / 2;
+export const HalfViewH = (ViewHeight - 1) / 2;
+const HpBarHeight = 3;
+const HpBarOffset = TilePixelSize - HpBarHeight;
+const HpBarFullColor: Color = rgb(0, 128, 0);
+const HpBarEmptyColor: Color = Red;
+const RememberedAlpha = 0.5;
+
+interface ViewEntity {
+    x: number;
+    y: number;
+    sprite: SpriteId;
+    health: number | null;
+}
+
+// Draws the view around the camera from the render deltas of ViewDeltas.
+// Keeps a copy of the cells in view and of the visible entities, and only repaints
+// the cells that a delta touched or that were scrolled into view.
+// Camera movement shifts the existing framebuffer instead of redrawing it.
+export class ViewRenderer {
+    public readonly canvas: HTMLCanvasElement;
+    private readonly backend: RenderBackend;
+    private cameraX: number = 0;
+    private cameraY: number = 0;
+    private readonly visibility: Uint8Array = new Uint8Array(ViewWidth * ViewHeight);
+    private readonly terrain: Uint8Array = new Uint8Array(ViewWidth * ViewHeight).fill(Unexplored);
+    // what is remembered on out of sight cells
+    private readonly objects: Array<SpriteId | null> = new Array(ViewWidth * ViewHeight).fill(null);
+    private readonly dirty: Uint8Array = new Uint8Array(ViewWidth * ViewHeight);
+    // in the order they are drawn, the last one to arrive on a cell is on top
+    private readonly entities: Map<Id, ViewEntity> = new Map();
+
+    constructor(
+        sprites: SpriteManager,
+        parent: HTMLElement,
+        backendKind: RenderBackendKind = RenderBackendKind.Canvas
+    ) {
+        this.canvas = v("canvas").appendTo(parent);
+        this.canvas.width = TilePixelSize * ViewWidth;
+        this.canvas.height = TilePixelSize * ViewHeight;
+        switch (backendKind) {
+        case RenderBackendKind.Canvas:
+            this.backend = new CanvasBackend(this.canvas, sprites);
+            break;
+        case RenderBackendKind.Compositor:
+            this.backend = new CompositorBackend(this.canvas, sprites);
+            break;
+        default:
+            throw new Error("Unknown render backend");
+        }
+    }
+
+    // number of canvas calls made during the last frame
+    public get frameCost(): number {
+        return this.backend.canvasCalls;
+    }
+
+    // the index of the view cell showing x, y, or -1 if it is out of view
+    private viewIndex(x: number, y: number): number {
+        const vx = x - this.cameraX + HalfViewW;
+        const vy = y - this.cameraY + HalfViewH;
+        if (vx >= 0 && vx < ViewWidth && vy >= 0 && vy < ViewHeight) {
+            return vy * ViewWidth + vx;
+        }
+        return -1;
+    }
+
+    private markDirty(x: number, y: number) {
+        const idx = this.viewIndex(x, y);
+        if (idx >= 0) {
+            this.dirty[idx] = 1;
+        }
+    }
+
+    private clearCell(idx: number) {
+        this.visibility[idx] = Visibility.NotVisible;
+        this.terrain[idx] = Unexplored;
+        this.objects[idx] = null;
+        this.dirty[idx] = 1;
+    }
+
+    // moves the existing image instead of redrawing it
+    private scroll(dx: number, dy: number) {
+        this.backend.scroll(-dx * TilePixelSize, -dy * TilePixelSize);
+        const visibility = this.visibility.slice();
+        const terrain = this.terrain.slice();
+        const objects = this.objects.slice();
+        for (let vy = 0; vy < ViewHeight; vy++) {
+            const oy = vy + dy;
+            for (let vx = 0; vx < ViewWidth; vx++) {
+                const ox = vx + dx;
+                const idx = vy * ViewWidth + vx;
+                if (ox >= 0 && ox < ViewWidth && oy >= 0 && oy < ViewHeight) {
+                    const from = oy * ViewWidth + ox;
+                    this.visibility[idx] = visibility[from];
+                    this.terrain[idx] = terrain[from];
+                    this.objects[idx] = objects[from];
+                } else {
+                    // exposed by the scroll and cleared by the copy, the game sends it again
+                    this.clearCell(idx);
+                }
+            }
+        }
+    }
+
+    public view(cameraX: number, cameraY: number, repaint: boolean) {
+        if (repaint) {
+            this.cameraX = cameraX;
+            this.cameraY = cameraY;
+            this.backend.clear(0, 0, this.canvas.width, this.canvas.height);
+            for (let idx = 0; idx < this.dirty.length; idx++) {
+                this.clearCell(idx);
+            }
+            this.entities.clear();
+        } else if (cameraX !== this.cameraX || cameraY !== this.cameraY) {
+            const dx = cameraX - this.cameraX;
+            const dy = cameraY - this.cameraY;
+            this.cameraX = cameraX;
+            this.cameraY = cameraY;
+            this.scroll(dx, dy);
+        }
+    }
+
+    public cell(x: number, y: number, visibility: Visibility, terrain: number, object: SpriteId | null) {
+        const idx = this.viewIndex(x, y);
+        if (idx < 0) { return; }
+        this.visibility[idx] = visibility;
+        this.terrain[idx] = terrain;
+        this.objects[idx] = object;
+        this.dirty[idx] = 1;
+    }
+
+    public entityMove(id: Id, sprite: SpriteId, x: number, y: number) {
+        const prev = this.entities.get(id);
+        if (prev !== undefined) {
+            this.markDirty(prev.x, prev.y);
+            this.entities.delete(id);
+        }
+        this.entities.set(id, {x, y, sprite, health: prev !== undefined ? prev.health : null});
+        this.markDirty(x, y);
+    }
+
+    public entityHealth(id: Id, fraction: number) {
+        const entity = this.entities.get(id);
+        if (entity !== undefined) {
+            entity.health = fraction;
+            this.markDirty(entity.x, entity.y);
+        }
+    }
+
+    public entityRemove(id: Id) {
+        const entity = this.entities.get(id);
+        if (entity !== undefined) {
+            this.markDirty(entity.x, entity.y);
+            this.entities.delete(id);
+        }
+    }
+
+    private drawTerrain(terrain: Terrain, xpx: number, ypx: number) {
+        const terrainColor = terrain.bgColor;
+        if (isNotNull(terrainColor)) {
+            this.backend.fill(xpx, ypx, TilePixelSize, TilePixelSize, terrainColor);
+        }
+        const terrainSprite = terrain.sprite;
+        if (isNotNull(terrainSprite)) {
+            this.backend.sprite(terrainSprite, xpx, ypx);
+        }
+    }
+
+    private drawEntity(entity: ViewEntity, xpx: number, ypx: number) {
+        this.backend.sprite(entity.sprite, xpx, ypx);
+        if (entity.health !== null) {
+            const barWidth = Math.floor(TilePixelSize * entity.health);
+            this.backend.fill(xpx, ypx + HpBarOffset, barWidth, HpBarHeight, HpBarFullColor);
+            this.backend.fill(xpx + barWidth, ypx + HpBarOffset, TilePixelSize - barWidth, HpBarHeight, HpBarEmptyColor);
+        }
+    }
+
+    private drawCell(idx: number, entities: Array<ViewEntity> | undefined) {
+        const xpx = (idx % ViewWidth) * TilePixelSize;
+        const ypx = Math.floor(idx / ViewWidth) * TilePixelSize;
+        this.backend.clear(xpx, ypx, TilePixelSize, TilePixelSize);
+        const terrain = this.terrain[idx];
+        if (terrain === Unexplored) {
+            return;
+        }
+        if (this.visibility[idx] !== Visibility.Visible) {
+            this.backend.setAlpha(RememberedAlpha);
+            this.drawTerrain(Terrain[terrain as TerrainKind], xpx, ypx);
+            const object = this.objects[idx];
+            if (isNotNull(object)) {
+                this.backend.sprite(object, xpx, ypx);
+            }
+            this.backend.setAlpha(1);
+            return;
+        }
+        this.drawTerrain(Terrain[terrain as TerrainKind], xpx, ypx);
+        if (entities !== undefined) {
+            for (const entity of entities) {
+                this.drawEntity(entity, xpx, ypx);
+            }
+        }
+    }
+
+    // repaints the cells the deltas since the last present touched
+    public present() {
+        Profiler.begin(ProfileZone.Draw);
+        this.backend.canvasCalls = 0;
+        const byCell: Map<number, Array<ViewEntity>> = new Map();
+        for (const entity of this.entities.values()) {
+            const idx = this.viewIndex(entity.x, entity.y);
+            if (idx < 0 || !this.dirty[idx]) { continue; }
+            const entities = byCell.get(idx);
+            if (entities !== undefined) {
+                entities.push(entity);
+            } else {
+                byCell.set(idx, [entity]);
+            }
+        }
+        for (let idx = 0; idx < this.dirty.length; idx++) {
+            if (this.dirty[idx]) {
+                this.dirty[idx] = 0;
+                this.drawCell(idx, byCell.get(idx));
+            }
+        }
+        this.backend.present();
+        Profiler.count(ProfileCounter.CanvasCalls, this.backend.canvasCalls);
+        Profiler.end(ProfileZone.Draw);
+    }
+}
@@ -0,0 +1,81 @@
+import { assertNotNull } from "./utils";
+
+interface PendingRequest<Response> {
+    resolve(response: Response): void;
+    reject(err: Error): void;
+}
+
+// Fixed set of workers that each answer one request with one message.
+// A worker announces that it has loaded by posting readyMessage first.
+export class WorkerPool<Request, Response> {
+    private readonly workers: Array<Worker> = [];
+    private readonly pending: Array<PendingRequest<Response> | null> = [];
+    private readonly started: Promise<void>;
+
+    constructor(url: string, size: number, readyMessage: string) {
+        const ready: Array<Promise<void>> = [];
+        for (let i = 0; i < size; i++) {
+            const worker = new Worker(url);
+            this.workers.push(worker);
+            this.pending.push(null);
+            ready.push(new Promise((resolve, reject) => {
+                worker.onmessage = (e: MessageEvent) => {
+                    if (e.data !== readyMessage) {
+                        reject(new Error("Worker answered before it was ready"));
+                        return;
+                    }
+                    worker.onmessage = (msg: MessageEvent) => this.onResponse(i, msg.data);
+                    resolve();
+                };
+            }));
+            worker.onerror = (e: ErrorEvent) => this.onError(i, e.message);
+        }
+        this.started = Promise.all(ready).then(() => undefined);
+    }
+
+    public get size(): number {
+        return this.workers.length;
+    }
+
+    // resolves once every worker has loaded
+    public start(): Promise<void> {
+        return this.started;
+    }
+
+    private onResponse(i: number, response: Response) {
+        const pending = assertNotNull(this.pending[i]);
+        this.pending[i] = null;
+        pending.resolve(response);
+    }
+
+    private onError(i: number, message: string) {
+        const pending = this.pending[i];
+        this.pending[i] = null;
+        if (pending !== null) {
+            pending.reject(new Error(`Worker failed: ${message}`));
+        } else {
+            console.error(`Worker failed: ${message}`);
+        }
+    }
+
+    // sends request i to worker i, there can be at most one request per worker
+    public run(requests: Array<Request>): Promise<Array<Response>> {
+        if (requests.length > this.workers.length) {
+            throw new Error("More requests than workers");
+        }
+        return Promise.all(requests.map((request, i) => new Promise<Response>((resolve, reject) => {
+            if (this.pending[i] !== null) {
+                throw new Error("Worker is still busy");
+            }
+            this.pending[i] = {resolve, reject};
+            this.workers[i].postMessage(request);
+        })));
+    }
+
+    public dispose() {
+        for (const worker of this.workers) {
+            worker.terminate();
+        }
+        this.workers.length = 0;
+    }
+}
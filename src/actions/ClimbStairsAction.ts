@@ -21,10 +21,10 @@ export class ClimbStairsAction implements IAction {
         let targetLevel: DungeonLevel;
         let directionWord: string;
         if (this.direction === ClimbDirection.Up) {
-            targetLevel = assertNotNull(curLevel.previousLevel);
+            targetLevel = assertNotNull(curLevel.getOrGeneratePreviousLevel());
             directionWord = "up";
         } else {
-            targetLevel = assertNotNull(curLevel.nextLevel);
+            targetLevel = assertNotNull(curLevel.getOrGenerateNextLevel());
             directionWord = "down";
         }
         curLevel.removeEntity(actor);
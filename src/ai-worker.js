@@ -0,0 +1,13 @@
+// Classic worker so that the emscripten glue can define the global Module,
+// the planner itself is an ES module loaded once the runtime is up.
+importScripts("digital-fov.js");
+
+function loadPlanner() {
+    import("./AIWorker.js").catch(err => console.error(err));
+}
+
+if (Module.calledRun) {
+    loadPlanner();
+} else {
+    Module.onRuntimeInitialized = loadPlanner;
+}
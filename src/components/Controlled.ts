@@ -28,6 +28,7 @@ class ControlledComponent extends Component {
 }
 
 export const energyTreshold = 100;
+export const energyGain = 10;
 export const baseEnergyCosts = {
     [ActionKind.Attack]: 100,
     [ActionKind.ClimbStairs]: 150,
@@ -61,7 +62,15 @@ export class Controlled extends ComponentData {
     }
 
     public gainEnergy() {
-        this.energy += 10;
+        this.energy += energyGain;
+    }
+
+    // gives the energy of the missed rounds at once
+    // but never enough to act more than once
+    public catchUp(rounds: number) {
+        if (rounds > 0) {
+            this.energy = Math.min(this.energy + rounds * energyGain, energyTreshold);
+        }
     }
 
     public dispose() {
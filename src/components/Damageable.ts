@@ -47,8 +47,17 @@ export class Damageable extends ComponentData {
         return this.health_;
     }
 
+    // only for restoring saved state, use takeDamage otherwise
+    public set health(value: number) {
+        this.health_ = value;
+    }
+
     public takeDamage(dmg: number) {
         this.health_ -= Math.abs(dmg);
+        if (this.owner.hasComponent(Location.Component)) {
+            const {dungeonLevel, x, y} = this.owner.location;
+            dungeonLevel.markDirty(x, y);
+        }
         if (this.health_ <= 0) {
             this.die();
         }
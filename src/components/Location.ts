@@ -43,6 +43,11 @@ export class Location extends ComponentData {
         this.pathmapIsFresh = false;
     }
 
+    public releasePathmap() {
+        this.pathmap_ = null;
+        this.pathmapIsFresh = false;
+    }
+
     public get pathmap(): Pathmap {
         if (this.pathmap_ === null) {
             this.pathmap_ = new Pathmap(this.dungeonLevel.width, this.dungeonLevel.height, this);
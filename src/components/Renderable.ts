@@ -28,7 +28,7 @@ export class Renderable extends ComponentData {
 
     constructor(
         owner: Entity,
-        public sprite: keyof Spritesheet
+        public sprite: SpriteId
     ) {
         super(owner);
     }
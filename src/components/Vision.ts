@@ -1,4 +1,5 @@
 import { Array2d } from "../Array2d";
+import { DungeonLevel } from "../DungeonLevel";
 import { Entity } from "../entities/Entity";
 import { Visibility } from "../fov";
 import { isNotNull } from "../utils";
@@ -33,6 +34,8 @@ export class Vision extends ComponentData {
     private static readonly defaultFovRadius = 10;
     protected fovRadius_: number = Vision.defaultFovRadius;
     private fov_: Array2d | null = null;
+    // the level whose pool the buffer came from
+    private fovLevel: DungeonLevel | null = null;
     private fovIsFresh: boolean = false;
 
     constructor(owner: Entity) {
@@ -52,8 +55,13 @@ export class Vision extends ComponentData {
             throw new Error("Can't get FOV for actor that has no location");
         }
         const {dungeonLevel, x, y} = this.owner.location;
+        if (this.fov_ !== null && (this.fovLevel !== dungeonLevel || this.fov_.disposed)) {
+            this.releaseFov();
+        }
         if (this.fov_ === null) {
             this.fov_ = dungeonLevel.getFieldOfViewAt(x, y, this.fovRadius_);
+            this.fovLevel = dungeonLevel;
+            this.fovIsFresh = true;
         }
         if (!this.fovIsFresh) {
             dungeonLevel.updateFieldOfViewAt(this.fov_, x, y, this.fovRadius_);
@@ -62,6 +70,16 @@ export class Vision extends ComponentData {
         return this.fov_;
     }
 
+    // frees the FOV buffer, it will be reallocated on next use
+    public releaseFov() {
+        if (isNotNull(this.fov_)) {
+            this.fov_.dispose();
+            this.fov_ = null;
+        }
+        this.fovLevel = null;
+        this.fovIsFresh = false;
+    }
+
     public canSee(x: number, y: number): boolean {
         if (this.owner.hasComponent(Location.Component)) {
             const {x: cx, y: cy} = this.owner.location;
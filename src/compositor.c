@@ -0,0 +1,247 @@
+/*
+Software tile compositor.
+Sprites and rectangles are composited into an RGBA framebuffer
+which can be handed to putImageData as is.
+Pixels are stored as little endian 0xAABBGGRR words.
+*/
+
+/* malloc, free */
+#include <stdlib.h>
+/* memmove, memset */
+#include <string.h>
+/* uint32_t */
+#include <stdint.h>
+
+typedef struct compositor
+{
+  int width;
+  int height;
+  uint32_t *pixels;
+  int atlas_width;
+  int atlas_height;
+  uint32_t *atlas;
+} compositor;
+
+/* clips the rectangle to the framebuffer
+ * return 0 if nothing is left of it
+ */
+static int
+clip_rect(compositor *c, int *x, int *y, int *w, int *h)
+{
+  if (*x < 0)
+  {
+    *w += *x;
+    *x = 0;
+  }
+  if (*y < 0)
+  {
+    *h += *y;
+    *y = 0;
+  }
+  if (*x + *w > c->width)
+    *w = c->width - *x;
+  if (*y + *h > c->height)
+    *h = c->height - *y;
+
+  return (*w > 0) && (*h > 0);
+}
+
+/* alpha is in range 0-256 */
+static uint32_t
+blend(uint32_t src, uint32_t dst, uint32_t alpha)
+{
+  uint32_t inv = 256 - alpha;
+  uint32_t rb = ((src & 0x00ff00ff) * alpha + (dst & 0x00ff00ff) * inv) >> 8;
+  uint32_t ga = ((src >> 8) & 0x00ff00ff) * alpha + ((dst >> 8) & 0x00ff00ff) * inv;
+
+  return (rb & 0x00ff00ff) | (ga & 0xff00ff00);
+}
+
+compositor *
+compositor_create(int width, int height)
+{
+  compositor *c = NULL;
+
+  if ((width <= 0) || (height <= 0))
+    return NULL;
+
+  c = (compositor *) malloc(sizeof(compositor));
+  if (c == NULL)
+    return NULL;
+
+  c->width = width;
+  c->height = height;
+  c->atlas_width = 0;
+  c->atlas_height = 0;
+  c->atlas = NULL;
+  c->pixels = (uint32_t *) calloc((size_t) width * height, sizeof(uint32_t));
+  if (c->pixels == NULL)
+  {
+    free(c);
+    return NULL;
+  }
+
+  return c;
+}
+
+void
+compositor_free(compositor *c)
+{
+  if (c == NULL)
+    return;
+  free(c->pixels);
+  free(c->atlas);
+  free(c);
+}
+
+uint32_t *
+compositor_pixels(compositor *c)
+{
+  return c->pixels;
+}
+
+/* returns a buffer the caller fills with the decoded sprite sheet */
+uint32_t *
+compositor_alloc_atlas(compositor *c, int width, int height)
+{
+  uint32_t *atlas = NULL;
+
+  if ((width <= 0) || (height <= 0))
+    return NULL;
+
+  atlas = (uint32_t *) malloc(sizeof(uint32_t) * width * height);
+  if (atlas == NULL)
+    return NULL;
+
+  free(c->atlas);
+  c->atlas = atlas;
+  c->atlas_width = width;
+  c->atlas_height = height;
+
+  return atlas;
+}
+
+void
+compositor_clear(compositor *c, int x, int y, int w, int h)
+{
+  int row;
+
+  if (!clip_rect(c, &x, &y, &w, &h))
+    return;
+
+  for (row = y; row < y + h; row++)
+    memset(c->pixels + row * c->width + x, 0, sizeof(uint32_t) * w);
+}
+
+void
+compositor_fill(compositor *c, int x, int y, int w, int h,
+                uint32_t color, int alpha)
+{
+  int row;
+  int col;
+  uint32_t *dst;
+
+  if (!clip_rect(c, &x, &y, &w, &h))
+    return;
+
+  for (row = y; row < y + h; row++)
+  {
+    dst = c->pixels + row * c->width + x;
+    if (alpha >= 256)
+    {
+      for (col = 0; col < w; col++)
+        dst[col] = color;
+    }
+    else
+    {
+      for (col = 0; col < w; col++)
+        dst[col] = blend(color, dst[col], alpha);
+    }
+  }
+}
+
+/* copies a sprite from the atlas
+ * fully transparent atlas pixels are skipped
+ */
+void
+compositor_sprite(compositor *c, int sx, int sy, int w, int h,
+                  int dx, int dy, int alpha)
+{
+  int row;
+  int col;
+  int x = dx;
+  int y = dy;
+  uint32_t *src;
+  uint32_t *dst;
+  uint32_t pixel;
+
+  if (c->atlas == NULL)
+    return;
+  if ((sx < 0) || (sy < 0)
+      || (sx + w > c->atlas_width) || (sy + h > c->atlas_height))
+    return;
+  if (!clip_rect(c, &x, &y, &w, &h))
+    return;
+
+  sx += x - dx;
+  sy += y - dy;
+  for (row = 0; row < h; row++)
+  {
+    src = c->atlas + (sy + row) * c->atlas_width + sx;
+    dst = c->pixels + (y + row) * c->width + x;
+    for (col = 0; col < w; col++)
+    {
+      pixel = src[col];
+      if ((pixel >> 24) == 0)
+        continue;
+      if (alpha >= 256)
+        dst[col] = pixel;
+      else
+        dst[col] = blend(pixel, dst[col], alpha);
+    }
+  }
+}
+
+/* moves the contents of the framebuffer by (dx, dy) pixels
+ * the exposed area is cleared
+ */
+void
+compositor_scroll(compositor *c, int dx, int dy)
+{
+  int row;
+  int w;
+  int src_x;
+  int dst_x;
+
+  if ((abs(dx) >= c->width) || (abs(dy) >= c->height))
+  {
+    memset(c->pixels, 0, sizeof(uint32_t) * c->width * c->height);
+    return;
+  }
+
+  w = c->width - abs(dx);
+  src_x = (dx < 0) ? -dx : 0;
+  dst_x = (dx < 0) ? 0 : dx;
+
+  if (dy > 0)
+  {
+    for (row = c->height - 1; row >= dy; row--)
+      memmove(c->pixels + row * c->width + dst_x,
+              c->pixels + (row - dy) * c->width + src_x,
+              sizeof(uint32_t) * w);
+    compositor_clear(c, 0, 0, c->width, dy);
+  }
+  else
+  {
+    for (row = 0; row < c->height + dy; row++)
+      memmove(c->pixels + row * c->width + dst_x,
+              c->pixels + (row - dy) * c->width + src_x,
+              sizeof(uint32_t) * w);
+    if (dy < 0)
+      compositor_clear(c, 0, c->height + dy, c->width, -dy);
+  }
+  if (dx > 0)
+    compositor_clear(c, 0, 0, dx, c->height);
+  else if (dx < 0)
+    compositor_clear(c, c->width + dx, 0, -dx, c->height);
+}
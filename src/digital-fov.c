@@ -26,20 +26,37 @@ digital FOV with recursive shadowcasting algorithm.
 #include <stdlib.h>
 /* memcpy */
 #include <string.h>
+#ifdef FOV_DIFFERENTIAL_CHECK
+/* fprintf */
+#include <stdio.h>
+#endif
+/* terrain_flags, generated from resources/terrain.json */
+#include "terrain.h"
+
+/* counters for profiling, read and reset by the game
+ * build with -DNO_FOV_STATS to leave them out
+ */
+typedef struct fov_stats
+{
+  int fov_calls;
+  int los_calls;
+  int cells_visited;
+  /* cells where the octant kernels and the generic one disagree,
+   * only counted with -DFOV_DIFFERENTIAL_CHECK
+   */
+  int fov_mismatches;
+} fov_stats;
+
+static fov_stats stats;
 
-// this needs to match the enum in ts
-typedef enum TerrainKind {
-    StoneWall,
-    WoodWall,
-    Palisade,
-    NUM_VISION_BLOCKING_TERRAIN,
-    StoneFloor,
-    WoodFloor,
-    Grass,
-    Dirt,
-    Upstairs,
-    Downstairs
-} TerrainKind;
+#ifdef NO_FOV_STATS
+#define FOV_STAT_ADD(field, n)
+#else
+#define FOV_STAT_ADD(field, n) (stats.field += (n))
+#endif
+
+#define TERRAIN_IS_OPAQUE(kind) \
+  (terrain_flags[(kind) & (TERRAIN_TABLE_SIZE - 1)] & TERRAIN_OPAQUE)
 
 struct _rays
 {
@@ -87,6 +104,9 @@ static int rays_add_top_wall(rays *rp, int u, int v);
 static int grid_is_illegal(int x, int y, int map_size_x, int map_size_y);
 static int which_side_of_line(int ax, int ay, int bx, int by,
                               int x, int y);
+#ifdef FOV_DIFFERENTIAL_CHECK
+int **create_array2d(int width, int height);
+void free_array2d(int **arr, int width, int height);
 static int digital_fov_recursive_body(int **map,
                                       int map_size_x, int map_size_y,
                                       int **map_fov,
@@ -94,6 +114,7 @@ static int digital_fov_recursive_body(int **map,
                                       int dir,
                                       int u_start,
                                       rays *rp);
+#endif
 
 static rays *
 rays_new(int radius)
@@ -487,6 +508,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
   int *bottom_wall_array_u = NULL;
   int *bottom_wall_array_v = NULL;
 
+  FOV_STAT_ADD(los_calls, 1);
   if (map == NULL)
     return 0;
   if (grid_is_illegal(ax, ay, map_size_x, map_size_y))
@@ -678,7 +700,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
         break;
       }
       if ((grid0_is_illegal)
-          || (map[x0][y0] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x0][y0]))
       {
         if (u < du_abs)
           result = 0;
@@ -717,7 +739,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
 
       /* update top and bottom ray */
       if ((grid0_is_illegal)
-          || (map[x0][y0] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x0][y0]))
       {
         if (which_side_of_line(bottom_ray_touch_top_wall_u,
                                bottom_ray_touch_top_wall_v,
@@ -747,7 +769,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
         }
       }
       if ((grid1_is_illegal)
-          || (map[x1][y1] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x1][y1]))
       {
         if (which_side_of_line(top_ray_touch_bottom_wall_u,
                                top_ray_touch_bottom_wall_v,
@@ -779,7 +801,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
 
       /* remember wall */
       if ((grid0_is_illegal)
-          || (map[x0][y0] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x0][y0]))
       {
         if (which_side_of_line(top_ray_touch_bottom_wall_u,
                                top_ray_touch_bottom_wall_v,
@@ -824,7 +846,7 @@ digital_los(int **map, int map_size_x, int map_size_y,
         }
       }
       if ((grid1_is_illegal)
-          || (map[x1][y1] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x1][y1]))
       {
         if (which_side_of_line(bottom_ray_touch_top_wall_u,
                                bottom_ray_touch_top_wall_v,
@@ -883,6 +905,11 @@ digital_los(int **map, int map_size_x, int map_size_y,
   return result;
 }
 
+#ifdef FOV_DIFFERENTIAL_CHECK
+/* The generic kernel the octant kernels are specialized from,
+ * it transforms the coordinates into the octant for every cell.
+ * Built with -DFOV_DIFFERENTIAL_CHECK to check the octant kernels against it.
+ */
 /* this function deletes rp if it is not NULL
  * return 0 on success, 1 on error
  */
@@ -1017,10 +1044,12 @@ digital_fov_recursive_body(int **map,
       illegal = grid_is_illegal(x, y, map_size_x, map_size_y);
 
       if (!illegal)
+      {
         map_fov[x - center_x + radius][y - center_y + radius] = 1;
+      }
 
       if ((illegal)
-          || (map[x][y] < NUM_VISION_BLOCKING_TERRAIN))
+          || TERRAIN_IS_OPAQUE(map[x][y]))
       {
         if (!previous_grid_is_wall)
         {
@@ -1082,10 +1111,10 @@ digital_fov_recursive_body(int **map,
   return 0;
 }
 
-int
-digital_fov(int **map, int map_size_x, int map_size_y,
-            int **map_fov,
-            int center_x, int center_y, int radius)
+static int
+digital_fov_reference(int **map, int map_size_x, int map_size_y,
+                      int **map_fov,
+                      int center_x, int center_y, int radius)
 {
   int x;
   int y;
@@ -1133,27 +1162,348 @@ digital_fov(int **map, int map_size_x, int map_size_y,
   return error_found;
 }
 
+/* runs the generic kernel on the same input and reports every cell that differs */
+static void
+check_fov(int **map, int map_size_x, int map_size_y,
+          int **map_fov,
+          int center_x, int center_y, int radius)
+{
+  int size = 2 * radius + 1;
+  int **expected = create_array2d(size, size);
+  int mismatches = 0;
+  int x;
+  int y;
+
+  if (expected == NULL)
+    return;
+  digital_fov_reference(map, map_size_x, map_size_y, expected,
+                        center_x, center_y, radius);
+  for (x = 0; x < size; x++)
+  {
+    for (y = 0; y < size; y++)
+    {
+      if (expected[x][y] != map_fov[x][y])
+      {
+        fprintf(stderr, "digital_fov: (%d, %d) is %d instead of %d, center (%d, %d) radius %d\n",
+                center_x + x - radius, center_y + y - radius, map_fov[x][y], expected[x][y],
+                center_x, center_y, radius);
+        mismatches++;
+      }
+    }
+  }
+  stats.fov_mismatches += mismatches;
+  free_array2d(expected, size, size);
+}
+#endif
+
+typedef int (*octant_kernel)(int **map,
+                             int map_size_x, int map_size_y,
+                             int **map_fov,
+                             int center_x, int center_y, int radius,
+                             int u_start, int u_end,
+                             rays *rp);
+
+/* The recursive body for one octant.
+ * It is inlined into one kernel per octant and bounds mode,
+ * so the coordinate transform and the bounds checks are resolved at compile time.
+ * The octant maps (u, v) to (center_x + xu * u + xv * v, center_y + yu * u + yv * v).
+ * Checked kernels treat cells outside of the map as walls,
+ * the others are only used when the whole octant is inside of it.
+ * u_end is the radius clipped to the map along u,
+ * every cell further than that is outside of the map.
+ * self is the kernel this is inlined into, for the recursive calls.
+ * this function deletes rp if it is not NULL
+ * return 0 on success, 1 on error
+ */
+static inline __attribute__((always_inline)) int
+octant_body(int **map,
+            int map_size_x, int map_size_y,
+            int **map_fov,
+            int center_x, int center_y, int radius,
+            int u_start, int u_end,
+            rays *rp,
+            const int xu, const int xv, const int yu, const int yv,
+            const int checked, octant_kernel self)
+{
+  /* summary:
+   * If a wall is found, divide all rays that are not blocked
+   * by it into 2 groups: rays that pass above it and rays that pass
+   * below it.  Handle the "below" group with another call of
+   * this function.
+   */
+  int u;
+  int v;
+  int x;
+  int y;
+  int illegal;
+  int v_start;
+  int v_end;
+  int previous_grid_is_wall;
+  int new_top_wall_found;
+  int new_top_wall_v;
+
+  rays *rp_child = NULL;
+
+  if (rp == NULL)
+    return 1;
+
+  if (rp->bottom_ray_touch_bottom_wall_u
+      == rp->bottom_ray_touch_top_wall_u)
+  {
+    rays_delete(rp);
+    rp = NULL;
+    return 1;
+  }
+  if (rp->top_ray_touch_top_wall_u
+      == rp->top_ray_touch_bottom_wall_u)
+  {
+    rays_delete(rp);
+    rp = NULL;
+    return 1;
+  }
+
+  for (u = u_start; u <= u_end; u++)
+  {
+    v_start = rp->bottom_ray_touch_bottom_wall_v
+      - rp->bottom_ray_touch_top_wall_v;
+    v_start *= u - rp->bottom_ray_touch_top_wall_u;
+    /* if v_start is non-negative, this round it down
+     * if v_start is negative, we don't care because
+     * v_start is set to 0 later
+     */
+    v_start /= rp->bottom_ray_touch_bottom_wall_u
+      - rp->bottom_ray_touch_top_wall_u;
+    v_start += rp->bottom_ray_touch_top_wall_v;
+    if (v_start < 0)
+      v_start = 0;
+
+    v_end = rp->top_ray_touch_top_wall_v
+      - rp->top_ray_touch_bottom_wall_v;
+    v_end *= u - rp->top_ray_touch_bottom_wall_u;
+    /* v_end must be rounded up
+     * note that v_end can't be negative
+     */
+    v_end += rp->top_ray_touch_top_wall_u
+      - rp->top_ray_touch_bottom_wall_u - 1;
+    v_end /= rp->top_ray_touch_top_wall_u
+      - rp->top_ray_touch_bottom_wall_u;
+    v_end += rp->top_ray_touch_bottom_wall_v;
+    v_end -= 1;
+    if (v_end > u)
+      v_end = u;
+
+    previous_grid_is_wall = 1;
+    new_top_wall_found = 0;
+    new_top_wall_v = rp->top_ray_touch_top_wall_v;
+
+    if (v_start > v_end)
+      break;
+
+    for (v = v_start; v <= v_end; v++)
+    {
+      x = center_x + xu * u + xv * v;
+      y = center_y + yu * u + yv * v;
+
+      illegal = checked && grid_is_illegal(x, y, map_size_x, map_size_y);
+
+      if (!illegal)
+      {
+        map_fov[x - center_x + radius][y - center_y + radius] = 1;
+        FOV_STAT_ADD(cells_visited, 1);
+      }
+
+      if ((illegal)
+          || TERRAIN_IS_OPAQUE(map[x][y]))
+      {
+        if (!previous_grid_is_wall)
+        {
+          new_top_wall_found = 1;
+          new_top_wall_v = v;
+        }
+
+        previous_grid_is_wall = 1;
+      }
+      else
+      {
+        if (previous_grid_is_wall)
+        {
+          if (new_top_wall_found)
+          {
+            rp_child = rays_new(radius);
+            if (rp_child == NULL)
+            {
+              rays_delete(rp);
+              rp = NULL;
+              return 1;
+            }
+            rays_copy(rp_child, rp);
+            rays_add_top_wall(rp_child, u, new_top_wall_v);
+            if (self(map,
+                     map_size_x, map_size_y,
+                     map_fov,
+                     center_x, center_y, radius,
+                     u + 1, u_end,
+                     rp_child) != 0)
+            {
+              rays_delete(rp);
+              rp = NULL;
+              return 1;
+            }
+            rp_child = NULL;
+            new_top_wall_found = 0;
+          }
+          rays_add_bottom_wall(rp, u, v - 1);
+        }
+        previous_grid_is_wall = 0;
+      }
+    }
+
+    if (new_top_wall_found)
+    {
+      rays_add_top_wall(rp, u, new_top_wall_v);
+    }
+    else if (previous_grid_is_wall)
+    {
+      break;
+    }
+  }
+
+  rays_delete(rp);
+  rp = NULL;
+
+  return 0;
+}
+
+#define OCTANT_KERNEL(name, xu, xv, yu, yv, checked) \
+  static int \
+  name(int **map, \
+       int map_size_x, int map_size_y, \
+       int **map_fov, \
+       int center_x, int center_y, int radius, \
+       int u_start, int u_end, \
+       rays *rp) \
+  { \
+    return octant_body(map, map_size_x, map_size_y, map_fov, \
+                       center_x, center_y, radius, u_start, u_end, rp, \
+                       xu, xv, yu, yv, checked, name); \
+  }
+
+/* octant n is the one the generic kernel visits with dir = n:
+ * bit 0 swaps x and y, bit 1 rotates by 90 degrees and bit 2 by 180
+ */
+#define OCTANT_KERNELS(n, xu, xv, yu, yv) \
+  OCTANT_KERNEL(octant_##n##_checked, xu, xv, yu, yv, 1) \
+  OCTANT_KERNEL(octant_##n##_unchecked, xu, xv, yu, yv, 0)
+
+OCTANT_KERNELS(0, 1, 0, 0, 1)
+OCTANT_KERNELS(1, 0, 1, 1, 0)
+OCTANT_KERNELS(2, 0, -1, 1, 0)
+OCTANT_KERNELS(3, -1, 0, 0, 1)
+OCTANT_KERNELS(4, -1, 0, 0, -1)
+OCTANT_KERNELS(5, 0, -1, -1, 0)
+OCTANT_KERNELS(6, 0, 1, -1, 0)
+OCTANT_KERNELS(7, 1, 0, 0, -1)
+
+static const octant_kernel checked_kernels[8] = {
+  octant_0_checked, octant_1_checked, octant_2_checked, octant_3_checked,
+  octant_4_checked, octant_5_checked, octant_6_checked, octant_7_checked
+};
+
+static const octant_kernel unchecked_kernels[8] = {
+  octant_0_unchecked, octant_1_unchecked, octant_2_unchecked, octant_3_unchecked,
+  octant_4_unchecked, octant_5_unchecked, octant_6_unchecked, octant_7_unchecked
+};
+
+/* the direction of u in each octant, and the signs of x and y within it */
+static const int octant_u_is_x[8] = { 1, 0, 0, 1, 1, 0, 0, 1 };
+static const int octant_sign_x[8] = { 1, 1, -1, -1, -1, -1, 1, 1 };
+static const int octant_sign_y[8] = { 1, 1, 1, 1, -1, -1, -1, -1 };
+
+int
+digital_fov(int **map, int map_size_x, int map_size_y,
+            int **map_fov,
+            int center_x, int center_y, int radius)
+{
+  int x;
+  int y;
+  int dir;
+  int error_found;
+  rays *rp = NULL;
+
+  FOV_STAT_ADD(fov_calls, 1);
+  if (map == NULL)
+    return 1;
+  if (map_fov == NULL)
+    return 1;
+  if (radius < 0)
+    return 1;
+
+  for (x = center_x - radius; x <= center_x + radius; x++)
+  {
+    for (y = center_y - radius; y <= center_y + radius; y++)
+    {
+      map_fov[x - center_x + radius][y - center_y + radius] = 0;
+    }
+  }
+
+  if (grid_is_illegal(center_x, center_y, map_size_x, map_size_y))
+    return 1;
+
+  map_fov[0 + radius][0 + radius] = 1;
+
+  error_found = 0;
+  for (dir = 0; dir < 8; dir++)
+  {
+    /* how far the map goes in the directions of the octant */
+    int reach_x = (octant_sign_x[dir] > 0) ? map_size_x - 1 - center_x : center_x;
+    int reach_y = (octant_sign_y[dir] > 0) ? map_size_y - 1 - center_y : center_y;
+    int reach_u = octant_u_is_x[dir] ? reach_x : reach_y;
+    octant_kernel kernel = ((reach_x >= radius) && (reach_y >= radius))
+      ? unchecked_kernels[dir] : checked_kernels[dir];
+
+    rp = rays_new(radius);
+    if (rp == NULL)
+      return 1;
+    if (kernel(map,
+               map_size_x, map_size_y,
+               map_fov,
+               center_x, center_y, radius,
+               1, (reach_u < radius) ? reach_u : radius,
+               rp) != 0)
+      error_found = 1;
+    rp = NULL;
+  }
+
+#ifdef FOV_DIFFERENTIAL_CHECK
+  check_fov(map, map_size_x, map_size_y, map_fov, center_x, center_y, radius);
+#endif
+
+  return error_found;
+}
+
+/* the column pointers and the columns are one block
+ * so an array costs a single allocation whatever its width
+ */
 int** create_array2d(int width, int height) {
-  int** arr = malloc(sizeof(int*) * width);
+  int** arr = malloc(sizeof(int*) * width + sizeof(int) * width * height);
   if (arr == NULL) {
     return NULL;
   }
+  int* cells = (int*) (arr + width);
   for (int x = 0; x < width; x++) {
-    arr[x] = malloc(sizeof(int) * height);
-    if (arr[x] == NULL) {
-      for (int i = 0; i < x; i++) {
-        free(arr[i]);
-      }
-      free(arr);
-      return NULL;
-    }
+    arr[x] = cells + x * height;
   }
   return arr;
 }
 
 void free_array2d(int** arr, int width, int height) {
-  for (int x = 0; x < width; x++) {
-    free(arr[x]);
-  }
+  (void) width;
+  (void) height;
   free(arr);
 }
+
+fov_stats *
+get_fov_stats(void)
+{
+  return &stats;
+}
@@ -13,6 +13,16 @@ export abstract class Entity implements HasId {
         this.id = Entity.idCounter++;
     }
 
+    // ids are handed out in construction order
+    // restoring a snapshot moves the counter to recreate the saved ids
+    public static get nextId(): Id {
+        return Entity.idCounter;
+    }
+
+    public static set nextId(id: Id) {
+        Entity.idCounter = id;
+    }
+
     public hasComponent<T extends typeof Component>(component: T): this is this & T["prototype"] {
         return component.checker.call(this);
     }
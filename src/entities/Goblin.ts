@@ -37,7 +37,7 @@ export class Goblin extends Entity {
         if (this.addComponent(new Equipment.Component(this)) && defaultWeapon.hasComponent(Equipable.Component)) {
             this.equipment.equip(defaultWeapon);
         }
-        this.addComponent(new Renderable.Component(this, "goblin"));
+        this.addComponent(new Renderable.Component(this, SpriteId.goblin));
         this.addComponent(new Physical.Component(this, true));
         this.addComponent(new Vision.Component(this));
     }
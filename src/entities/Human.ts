@@ -38,7 +38,7 @@ export class Human extends Entity {
         if (this.addComponent(new Equipment.Component(this)) && defaultWeapon.hasComponent(Equipable.Component)) {
             this.equipment.equip(defaultWeapon);
         }
-        this.addComponent(new Renderable.Component(this, "human_male2"));
+        this.addComponent(new Renderable.Component(this, SpriteId.human_male2));
         this.addComponent(new Physical.Component(this, true));
         this.addComponent(new Storage.Component(this, 30));
         this.addComponent(new Vision.Component(this));
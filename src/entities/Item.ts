@@ -4,7 +4,7 @@ import { Game } from "../Game";
 import { Entity } from "./Entity";
 
 export abstract class Item extends Entity {
-    constructor(game: Game, name: string, sprite: keyof Spritesheet) {
+    constructor(game: Game, name: string, sprite: SpriteId) {
         super(game, name);
         this.addComponent(new Renderable.Component(this, sprite));
         this.addComponent(new Physical.Component(this, false));
@@ -5,7 +5,7 @@ import { Item } from "./Item";
 
 export class Trinket extends Item {
     constructor(game: Game) {
-        super(game, "Trinket", "trinket");
+        super(game, "Trinket", SpriteId.trinket);
         this.addComponent(new Equipable.Component(this, EquipmentSlot.Amulet));
     }
 }
@@ -0,0 +1,97 @@
+/*
+Native differential check of the octant FOV kernels, see make check-fov.
+Built together with digital-fov.c and -DFOV_DIFFERENTIAL_CHECK, so every
+digital_fov call is compared against the generic kernel.
+Runs digital_fov on random maps, centers and radii
+and exits with 1 if any cell differed.
+
+usage: fov-check [maps] [seed]
+*/
+
+/* atoi, exit */
+#include <stdlib.h>
+/* printf, fprintf */
+#include <stdio.h>
+/* uint32_t */
+#include <stdint.h>
+/* terrain kinds and their flags, shared with digital-fov.c */
+#include "terrain.h"
+
+#define MAX_MAP_SIZE 48
+#define MAX_RADIUS 16
+
+typedef struct fov_stats
+{
+  int fov_calls;
+  int los_calls;
+  int cells_visited;
+  int fov_mismatches;
+} fov_stats;
+
+int digital_fov(int **map, int map_size_x, int map_size_y,
+                int **map_fov,
+                int center_x, int center_y, int radius);
+int **create_array2d(int width, int height);
+void free_array2d(int **arr, int width, int height);
+fov_stats *get_fov_stats(void);
+
+static uint32_t random_state;
+
+static uint32_t
+random_next(void)
+{
+  /* xorshift32 */
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+/* uniform in [0, n) */
+static int
+random_below(int n)
+{
+  return (int) (random_next() % (uint32_t) n);
+}
+
+int
+main(int argc, char **argv)
+{
+  int maps = (argc > 1) ? atoi(argv[1]) : 200000;
+  int seed = (argc > 2) ? atoi(argv[2]) : 1;
+  int **map = create_array2d(MAX_MAP_SIZE, MAX_MAP_SIZE);
+  int **map_fov = create_array2d(2 * MAX_RADIUS + 1, 2 * MAX_RADIUS + 1);
+  fov_stats *stats = get_fov_stats();
+  int i;
+  int x;
+  int y;
+
+  if ((map == NULL) || (map_fov == NULL))
+  {
+    fprintf(stderr, "fov-check: out of memory\n");
+    return 2;
+  }
+  random_state = (seed == 0) ? 1 : (uint32_t) seed;
+
+  for (i = 0; i < maps; i++)
+  {
+    int size_x = 1 + random_below(MAX_MAP_SIZE);
+    int size_y = 1 + random_below(MAX_MAP_SIZE);
+    /* from open caves to mostly walls */
+    int walls = random_below(70);
+    int radius = random_below(MAX_RADIUS + 1);
+    /* the center is on the map but the FOV may reach past its edges */
+    int center_x = random_below(size_x);
+    int center_y = random_below(size_y);
+
+    for (x = 0; x < size_x; x++)
+      for (y = 0; y < size_y; y++)
+        map[x][y] = (random_below(100) < walls) ? T_STONE_WALL : T_STONE_FLOOR;
+    digital_fov(map, size_x, size_y, map_fov, center_x, center_y, radius);
+  }
+
+  printf("fov-check: %d maps, %d cells differed\n", maps, stats->fov_mismatches);
+  free_array2d(map_fov, 2 * MAX_RADIUS + 1, 2 * MAX_RADIUS + 1);
+  free_array2d(map, MAX_MAP_SIZE, MAX_MAP_SIZE);
+  return (stats->fov_mismatches == 0) ? 0 : 1;
+}
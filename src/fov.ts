@@ -1,36 +1,70 @@
 import { Array2d } from "./Array2d";
+import { chebyshevDistance } from "./geometry";
+import { ProfileCounter, Profiler, ProfileZone } from "./Profiler";
 
 interface DigitalFovModule extends EmscriptenModule {
     _create_array2d(width: number, height: number): IntPtrPtr;
     _free_array2d(arr: IntPtrPtr, width: number, height: number): void;
     _digital_los(map: IntPtrPtr, width: number, height: number, fromx: number, fromy: number, tox: number, toy: number): number;
     _digital_fov(map: IntPtrPtr, width: number, height: number, fov: IntPtrPtr, cx: number, cy: number, r: number): number;
+    _get_fov_stats(): number;
 }
 
 declare const Module: DigitalFovModule;
 export const FovModule = Module;
 
+// fields of fov_stats in digital-fov.c
+const enum FovStat {
+    FovCalls,
+    LosCalls,
+    CellsVisited,
+    FovMismatches,
+    NUM_FOV_STATS
+}
+
+// moves the counters of the kernel into the profiler and resets them
+export function collectKernelStats() {
+    const offset = Module._get_fov_stats() / Int32Array.BYTES_PER_ELEMENT;
+    const stats = Module.HEAP32.subarray(offset, offset + FovStat.NUM_FOV_STATS);
+    Profiler.count(ProfileCounter.KernelFovCalls, stats[FovStat.FovCalls]);
+    Profiler.count(ProfileCounter.KernelLosCalls, stats[FovStat.LosCalls]);
+    Profiler.count(ProfileCounter.KernelCellsVisited, stats[FovStat.CellsVisited]);
+    Profiler.count(ProfileCounter.KernelFovMismatches, stats[FovStat.FovMismatches]);
+    stats.fill(0);
+}
+
 export enum Visibility {
     NotVisible = 0,
     Visible = 1
 }
 
-export function lineOfSight(map: Array2d, fromx: number, fromy: number, tox: number, toy: number): boolean {
-    return Module._digital_los(map.ptr, map.width, map.height, fromx, fromy, tox, toy) > 0;
+// true if something at x, y that sees as far as reach sees the observer at ox, oy.
+// Digital FOV is symmetric, within its radius the FOV of the observer answers for both ends,
+// further away only the longer reach of the seer gets there and the line of sight decides.
+export function seesObserver(
+    x: number, y: number, reach: number,
+    ox: number, oy: number, observerRadius: number,
+    observerFov: () => Array2d, lineOfSightToObserver: () => boolean
+): boolean {
+    const dist = chebyshevDistance(x, y, ox, oy);
+    if (dist > reach) { return false; }
+    if (dist <= observerRadius) {
+        return observerFov().columns[x - ox + observerRadius][y - oy + observerRadius] === Visibility.Visible;
+    }
+    return lineOfSightToObserver();
 }
 
-export function getFieldOfView(map: Array2d, cx: number, cy: number, r: number): Array2d {
-    const d = 2 * r + 1;
-    const fov = new Array2d(d, d);
-    const err = Module._digital_fov(map.ptr, map.width, map.height, fov.ptr, cx, cy, r);
-    if (err) {
-        throw new Error("Failed to calculate FOV");
-    }
-    return fov;
+// the map may be larger than width and height, only that part of it is read
+export function lineOfSight(map: Array2d, width: number, height: number, fromx: number, fromy: number, tox: number, toy: number): boolean {
+    Profiler.count(ProfileCounter.LosCalls);
+    return Module._digital_los(map.ptr, width, height, fromx, fromy, tox, toy) > 0;
 }
 
-export function updateFieldOfView(map: Array2d, fov: Array2d, cx: number, cy: number, r: number) {
-    const err = Module._digital_fov(map.ptr, map.width, map.height, fov.ptr, cx, cy, r);
+export function updateFieldOfView(map: Array2d, width: number, height: number, fov: Array2d, cx: number, cy: number, r: number) {
+    Profiler.begin(ProfileZone.Fov);
+    Profiler.count(ProfileCounter.FovCalls);
+    const err = Module._digital_fov(map.ptr, width, height, fov.ptr, cx, cy, r);
+    Profiler.end(ProfileZone.Fov);
     if (err) {
         throw new Error("Failed to calculate FOV");
     }
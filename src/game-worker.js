@@ -0,0 +1,19 @@
+// Classic worker that loads the wasm build the page uses and then the game,
+// module workers can not importScripts the emscripten glue.
+var queued = [];
+
+self.onmessage = function (e) {
+    var init = e.data;
+    // key presses that arrive while loading are handed over to the game
+    self.onmessage = function (e) {
+        queued.push(e.data);
+    };
+    self.Module = {
+        onRuntimeInitialized: function () {
+            import("./GameWorker.js")
+                .then(function (m) { m.startGameWorker(init, queued); })
+                .catch(function (err) { console.error(err); });
+        }
+    };
+    importScripts(init.wasmBuild);
+};
@@ -81,6 +81,10 @@ export function manhattanDistance(ax: number, ay: number, bx: number, by: number
     return Math.abs(ax - bx) + Math.abs(ay - by);
 }
 
+export function chebyshevDistance(ax: number, ay: number, bx: number, by: number): number {
+    return Math.max(Math.abs(ax - bx), Math.abs(ay - by));
+}
+
 export function distance(ax: number, ay: number, bx: number, by: number): number {
     return Math.hypot(ax - bx, ay - by);
 }
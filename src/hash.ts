@@ -0,0 +1,26 @@
+const fnvOffsetBasis = 0x811c9dc5;
+const fnvPrime = 0x01000193;
+
+// 32-bit FNV-1a, fed a 32-bit word at a time
+export class Fnv1a {
+    private hash: number = fnvOffsetBasis;
+
+    public get value(): number {
+        return this.hash >>> 0;
+    }
+
+    public u32(word: number) {
+        let h = this.hash;
+        h = Math.imul(h ^ (word & 0xff), fnvPrime);
+        h = Math.imul(h ^ ((word >>> 8) & 0xff), fnvPrime);
+        h = Math.imul(h ^ ((word >>> 16) & 0xff), fnvPrime);
+        h = Math.imul(h ^ (word >>> 24), fnvPrime);
+        this.hash = h;
+    }
+
+    public words(words: Uint32Array | Int32Array) {
+        for (let i = 0; i < words.length; i++) {
+            this.u32(words[i]);
+        }
+    }
+}
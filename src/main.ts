@@ -1,8 +1,91 @@
+import { benchmarkCoarse } from "./CoarseBenchmark";
 import { Game } from "./Game";
+import { GameClient } from "./GameClient";
+import { benchmarkMapgen } from "./mapgen/MapgenBenchmark";
+import { benchmarkPlanner } from "./PlanBenchmark";
+import { Profiler } from "./Profiler";
+import { ProfilerOverlay } from "./ProfilerOverlay";
+import { benchmarkRandom } from "./RandomBenchmark";
+import { RemoteGame } from "./RemoteGame";
+import { RenderBackendKind } from "./RenderBackend";
+import { runReplay } from "./Replay";
+import { benchmarkSnapshot } from "./SnapshotBenchmark";
+import { assertNotNull } from "./utils";
+
+function download(data: Uint8Array | string, name: string) {
+    const url = URL.createObjectURL(new Blob([data]));
+    const link = document.createElement("a");
+    link.href = url;
+    link.download = name;
+    link.click();
+    URL.revokeObjectURL(url);
+}
+
+function downloadRecording(game: Game) {
+    download(assertNotNull(game.recorder).finish(), `punycrawl-${game.rng.seed}.rec`);
+}
+
+function downloadTrace() {
+    // load the file in chrome://tracing or the performance panel
+    download(Profiler.exportTrace(), `punycrawl-${Date.now()}.trace.json`);
+}
+
+async function replay(path: string) {
+    const res = await fetch(path);
+    const report = await runReplay(new Uint8Array(await res.arrayBuffer()));
+    console.log(report);
+}
 
 function main() {
     try {
-        const game = new Game();
+        const params = new URLSearchParams(location.search);
+        if (params.get("bench") === "rng") {
+            console.table(benchmarkRandom());
+            return;
+        }
+        if (params.get("bench") === "mapgen") {
+            console.table(benchmarkMapgen());
+            return;
+        }
+        if (params.get("bench") === "snapshot") {
+            benchmarkSnapshot().then(result => console.table([result])).catch(err => console.error(err));
+            return;
+        }
+        if (params.get("bench") === "coarse") {
+            benchmarkCoarse().then(results => console.table(results)).catch(err => console.error(err));
+            return;
+        }
+        if (params.get("bench") === "plan") {
+            benchmarkPlanner().then(results => console.table(results)).catch(err => console.error(err));
+            return;
+        }
+        const replayPath = params.get("replay");
+        if (replayPath !== null) {
+            replay(replayPath).catch(err => console.error(err));
+            return;
+        }
+        if (params.has("profile")) {
+            const overlay = new ProfilerOverlay(document.body);
+            Profiler.enable(profile => overlay.update(profile));
+            Object.assign(window, {downloadTrace});
+        }
+        const renderBackend = params.get("renderer") === "compositor" ? RenderBackendKind.Compositor : RenderBackendKind.Canvas;
+        const record = params.has("record");
+        // ?workers=n lets the AI decide in n workers, ?workers alone uses one per spare core
+        const workersParam = params.get("workers");
+        const aiWorkers = workersParam === null ? 0 :
+            workersParam === "" ? Math.max(navigator.hardwareConcurrency - 1, 1) : parseInt(workersParam, 10) || 0;
+        if (params.has("split")) {
+            // ?split runs the game in a worker, recording and profiling stay with the local game
+            const client = new GameClient(document.body, renderBackend);
+            new RemoteGame(client, {aiWorkers}).run().catch(err => console.error(err));
+            return;
+        }
+        const game = new Game({renderBackend, record, aiWorkers});
+        if (record) {
+            // call downloadRecording() from the console to save the session
+            Object.assign(window, {downloadRecording: () => downloadRecording(game)});
+        }
         game.run();
     } catch (err) {
         console.error(err);
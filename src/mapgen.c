@@ -0,0 +1,658 @@
+/*
+Seeded level generators.
+A level is generated into a column major scratch grid,
+made fully connected between its entry and exit,
+and then packed into square chunks laid out like ByteChunks in Chunks.ts
+so the game can adopt them without touching single cells.
+*/
+
+/* malloc, free */
+#include <stdlib.h>
+/* memset, memcpy */
+#include <string.h>
+/* uint32_t, uint64_t */
+#include <stdint.h>
+/* terrain_kind, terrain_flags, generated from resources/terrain.json */
+#include "terrain.h"
+
+#define IS_WALL(kind) (terrain_flags[kind] & TERRAIN_BLOCKS_MOVEMENT)
+
+/* must match MapKind in mapgen/MapGenerator.ts */
+enum map_kind
+{
+  MAP_ROOMS = 0,
+  MAP_CAVES = 1,
+  MAP_VILLAGE = 2
+};
+
+#define STAIRS_UP 1
+#define STAIRS_DOWN 2
+
+/* smallest level the generators leave room for stairs in */
+#define MIN_SIZE 16
+/* coordinates are packed into 16 bits each */
+#define MAX_SIZE 0x8000
+
+/* from rng.c */
+typedef struct rng rng;
+rng *rng_create(int kind, uint32_t seed_lo, uint32_t seed_hi, int pool_size);
+void rng_free(rng *r);
+uint32_t *rng_pool(rng *r);
+void rng_fill(rng *r);
+
+#define RNG_XOSHIRO256 0
+#define RNG_POOL_SIZE 256
+
+typedef struct mapgen
+{
+  int width;
+  int height;
+  int chunk_shift;
+  int chunks_wide;
+  int chunks_high;
+  /* terrain kinds, column major */
+  unsigned char *cells;
+  /* per cell state of the pass at hand */
+  unsigned char *scratch;
+  int *labels;
+  int *queue;
+  /* output, the cells of every chunk followed by the next chunk */
+  unsigned char *chunks;
+  /* value of the uniform chunks, -1 for the others */
+  int *uniform;
+  /* what unreachable cells are filled with */
+  unsigned char wall;
+  unsigned char floor;
+  rng *r;
+  int pool_pos;
+} mapgen;
+
+typedef struct rect
+{
+  int x;
+  int y;
+  int w;
+  int h;
+} rect;
+
+static const int dir_x[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+static const int dir_y[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+#define CELL(g, x, y) ((g)->cells[(x) * (g)->height + (y)])
+
+static uint32_t
+next_u32(mapgen *g)
+{
+  if (g->pool_pos >= RNG_POOL_SIZE)
+  {
+    rng_fill(g->r);
+    g->pool_pos = 0;
+  }
+  return rng_pool(g->r)[g->pool_pos++];
+}
+
+/* in range [0, n) */
+static int
+rand_below(mapgen *g, int n)
+{
+  return (int) (((uint64_t) next_u32(g) * (uint32_t) n) >> 32);
+}
+
+/* in range [lo, hi] */
+static int
+rand_range(mapgen *g, int lo, int hi)
+{
+  return lo + rand_below(g, hi - lo + 1);
+}
+
+mapgen *
+mapgen_create(int width, int height, int chunk_shift)
+{
+  mapgen *g = NULL;
+  int area = width * height;
+  int chunk_area = 1 << (2 * chunk_shift);
+
+  if ((width < MIN_SIZE) || (height < MIN_SIZE) || (width > MAX_SIZE) || (height > MAX_SIZE))
+    return NULL;
+  if ((chunk_shift <= 0) || (chunk_shift > 12))
+    return NULL;
+
+  g = (mapgen *) malloc(sizeof(mapgen));
+  if (g == NULL)
+    return NULL;
+  g->width = width;
+  g->height = height;
+  g->chunk_shift = chunk_shift;
+  g->chunks_wide = (width + (1 << chunk_shift) - 1) >> chunk_shift;
+  g->chunks_high = (height + (1 << chunk_shift) - 1) >> chunk_shift;
+  g->cells = (unsigned char *) malloc(area);
+  g->scratch = (unsigned char *) malloc(area);
+  g->labels = (int *) malloc(sizeof(int) * area);
+  g->queue = (int *) malloc(sizeof(int) * area);
+  g->chunks = (unsigned char *) malloc(g->chunks_wide * g->chunks_high * chunk_area);
+  g->uniform = (int *) malloc(sizeof(int) * g->chunks_wide * g->chunks_high);
+  g->r = NULL;
+  g->pool_pos = RNG_POOL_SIZE;
+  if ((g->cells == NULL) || (g->scratch == NULL) || (g->labels == NULL)
+      || (g->queue == NULL) || (g->chunks == NULL) || (g->uniform == NULL))
+  {
+    free(g->cells);
+    free(g->scratch);
+    free(g->labels);
+    free(g->queue);
+    free(g->chunks);
+    free(g->uniform);
+    free(g);
+    return NULL;
+  }
+
+  return g;
+}
+
+void
+mapgen_free(mapgen *g)
+{
+  if (g == NULL)
+    return;
+  free(g->cells);
+  free(g->scratch);
+  free(g->labels);
+  free(g->queue);
+  free(g->chunks);
+  free(g->uniform);
+  free(g);
+}
+
+unsigned char *
+mapgen_chunks(mapgen *g)
+{
+  return g->chunks;
+}
+
+int *
+mapgen_uniform(mapgen *g)
+{
+  return g->uniform;
+}
+
+static void
+fill_rect(mapgen *g, int x0, int y0, int w, int h, unsigned char kind)
+{
+  int x;
+
+  for (x = x0; x < x0 + w; x++)
+    memset(g->cells + x * g->height + y0, kind, h);
+}
+
+/* the walls of the rectangle */
+static void
+outline_rect(mapgen *g, int x0, int y0, int w, int h, unsigned char kind)
+{
+  int i;
+
+  for (i = x0; i < x0 + w; i++)
+  {
+    CELL(g, i, y0) = kind;
+    CELL(g, i, y0 + h - 1) = kind;
+  }
+  for (i = y0; i < y0 + h; i++)
+  {
+    CELL(g, x0, i) = kind;
+    CELL(g, x0 + w - 1, i) = kind;
+  }
+}
+
+/* horizontal then vertical or the other way around */
+static void
+carve_corridor(mapgen *g, int x0, int y0, int x1, int y1, unsigned char kind)
+{
+  int x = x0;
+  int y = y0;
+  int horizontal_first = rand_below(g, 2);
+
+  if (horizontal_first)
+    for (; x != x1; x += (x1 > x) ? 1 : -1)
+      CELL(g, x, y) = kind;
+  for (; y != y1; y += (y1 > y) ? 1 : -1)
+    CELL(g, x, y) = kind;
+  for (; x != x1; x += (x1 > x) ? 1 : -1)
+    CELL(g, x, y) = kind;
+  CELL(g, x, y) = kind;
+}
+
+static int
+rects_overlap(const rect *a, const rect *b, int padding)
+{
+  return (a->x - padding < b->x + b->w) && (b->x - padding < a->x + a->w)
+    && (a->y - padding < b->y + b->h) && (b->y - padding < a->y + a->h);
+}
+
+/* rooms carved out of rock, each joined to the one placed before it */
+static void
+generate_rooms(mapgen *g)
+{
+  int max_rooms = g->width * g->height / 400 + 2;
+  int tries = max_rooms * 8;
+  int num_rooms = 0;
+  /* the queue is not in use yet and has room for many more */
+  rect *rooms = (rect *) g->queue;
+  int i;
+
+  g->wall = T_STONE_WALL;
+  g->floor = T_STONE_FLOOR;
+  fill_rect(g, 0, 0, g->width, g->height, T_STONE_WALL);
+
+  while ((num_rooms < max_rooms) && (tries-- > 0))
+  {
+    rect room;
+    int overlaps = 0;
+
+    room.w = rand_range(g, 4, 12);
+    room.h = rand_range(g, 4, 10);
+    room.x = rand_range(g, 1, g->width - room.w - 1);
+    room.y = rand_range(g, 1, g->height - room.h - 1);
+    for (i = 0; i < num_rooms; i++)
+    {
+      if (rects_overlap(&room, &rooms[i], 2))
+      {
+        overlaps = 1;
+        break;
+      }
+    }
+    if (overlaps)
+      continue;
+    fill_rect(g, room.x, room.y, room.w, room.h, T_STONE_FLOOR);
+    if (num_rooms > 0)
+    {
+      rect *prev = &rooms[num_rooms - 1];
+
+      carve_corridor(g, prev->x + prev->w / 2, prev->y + prev->h / 2,
+                     room.x + room.w / 2, room.y + room.h / 2, T_STONE_FLOOR);
+    }
+    rooms[num_rooms++] = room;
+  }
+}
+
+/* random noise smoothed by cellular automata
+ * a cell becomes rock when most of its 3x3 neighbourhood is,
+ * the first passes also seed rock in the middle of wide open areas
+ * the passes work on a 1 for rock mask and count neighbours
+ * from the sums of three columns at a time
+ */
+static void
+generate_caves(mapgen *g)
+{
+  int width = g->width;
+  int height = g->height;
+  /* 45% rock */
+  uint32_t rock_threshold = (uint32_t) (0.45 * 4294967296.0);
+  int *sums = g->labels;
+  unsigned char *mask = g->cells;
+  unsigned char *next = g->scratch;
+  int pass;
+  int x;
+  int y;
+
+  g->wall = T_STONE_WALL;
+  g->floor = T_STONE_FLOOR;
+  for (x = 0; x < width * height; x++)
+    mask[x] = next_u32(g) < rock_threshold;
+
+  for (pass = 0; pass < 5; pass++)
+  {
+    memset(next, 1, height);
+    memset(next + (width - 1) * height, 1, height);
+    for (x = 1; x < width - 1; x++)
+    {
+      const unsigned char *left = mask + (x - 1) * height;
+      const unsigned char *col = mask + x * height;
+      const unsigned char *right = mask + (x + 1) * height;
+      unsigned char *out = next + x * height;
+
+      for (y = 0; y < height; y++)
+        sums[y] = left[y] + col[y] + right[y];
+      out[0] = 1;
+      out[height - 1] = 1;
+      for (y = 1; y < height - 1; y++)
+      {
+        /* the cell itself counts too */
+        int n = sums[y - 1] + sums[y] + sums[y + 1];
+
+        out[y] = (n >= 5) || ((pass < 3) && (n == 0));
+      }
+    }
+    memcpy(mask, next, width * height);
+  }
+
+  for (x = 0; x < width * height; x++)
+    mask[x] = mask[x] ? T_STONE_WALL : T_STONE_FLOOR;
+}
+
+/* a palisade around grass with roads crossing at the middle and houses along them */
+static void
+generate_village(mapgen *g)
+{
+  int width = g->width;
+  int height = g->height;
+  int cx = width / 2;
+  int cy = height / 2;
+  int max_houses = width * height / 300 + 1;
+  int tries = max_houses * 8;
+  int x;
+  int y;
+
+  g->wall = T_PALISADE;
+  g->floor = T_DIRT;
+  fill_rect(g, 0, 0, width, height, T_GRASS);
+  for (x = 0; x < width; x++)
+    for (y = 0; y < height; y++)
+      if (rand_below(g, 100) < 4)
+        CELL(g, x, y) = T_DIRT;
+
+  /* the scratch marks the cells that can not be built on */
+  memset(g->scratch, 0, width * height);
+  outline_rect(g, 2, 2, width - 4, height - 4, T_PALISADE);
+  fill_rect(g, 2, cy - 1, width - 4, 2, T_DIRT);
+  fill_rect(g, cx - 1, 2, 2, height - 4, T_DIRT);
+  for (x = 0; x < width; x++)
+  {
+    for (y = 0; y < height; y++)
+    {
+      int edge = (x <= 3) || (y <= 3) || (x >= width - 4) || (y >= height - 4);
+      int road = ((x >= cx - 2) && (x <= cx + 1)) || ((y >= cy - 2) && (y <= cy + 1));
+
+      g->scratch[x * height + y] = edge || road;
+    }
+  }
+
+  while ((max_houses > 0) && (tries-- > 0))
+  {
+    int w = rand_range(g, 5, 9);
+    int h = rand_range(g, 4, 7);
+    int x0 = rand_range(g, 1, width - w - 1);
+    int y0 = rand_range(g, 1, height - h - 1);
+    int free_area = 1;
+    int side;
+    int door_x;
+    int door_y;
+
+    /* one cell of yard around every house */
+    for (x = x0 - 1; (x <= x0 + w) && free_area; x++)
+      for (y = y0 - 1; (y <= y0 + h) && free_area; y++)
+        if (g->scratch[x * height + y])
+          free_area = 0;
+    if (!free_area)
+      continue;
+
+    fill_rect(g, x0, y0, w, h, T_WOOD_FLOOR);
+    outline_rect(g, x0, y0, w, h, T_WOOD_WALL);
+    side = rand_below(g, 4);
+    door_x = (side == 1) ? x0 + w - 1 : (side == 3) ? x0 : rand_range(g, x0 + 1, x0 + w - 2);
+    door_y = (side == 0) ? y0 : (side == 2) ? y0 + h - 1 : rand_range(g, y0 + 1, y0 + h - 2);
+    CELL(g, door_x, door_y) = T_WOOD_FLOOR;
+    for (x = x0 - 1; x <= x0 + w; x++)
+      memset(g->scratch + x * height + y0 - 1, 1, h + 2);
+    max_houses--;
+  }
+
+  /* gates */
+  fill_rect(g, 2, cy - 1, 1, 2, T_DIRT);
+  fill_rect(g, width - 3, cy - 1, 1, 2, T_DIRT);
+  fill_rect(g, cx - 1, 2, 2, 1, T_DIRT);
+  fill_rect(g, cx - 1, height - 3, 2, 1, T_DIRT);
+}
+
+/* queue entries hold both coordinates so no division is needed to get them back */
+#define PACK_XY(x, y) (((x) << 16) | (y))
+#define UNPACK_X(p) ((p) >> 16)
+#define UNPACK_Y(p) ((p) & 0xffff)
+
+/* labels the passable regions with consecutive numbers from 1, walls with 0
+ * returns the label of the largest region
+ */
+static int
+label_regions(mapgen *g)
+{
+  int width = g->width;
+  int height = g->height;
+  int area = width * height;
+  int label = 0;
+  int largest = 0;
+  int largest_size = 0;
+  int i;
+  int x;
+  int y;
+
+  for (i = 0; i < area; i++)
+    g->labels[i] = IS_WALL(g->cells[i]) ? 0 : -1;
+
+  for (x = 0; x < width; x++)
+  {
+    for (y = 0; y < height; y++)
+    {
+      int head = 0;
+      int tail = 0;
+
+      if (g->labels[x * height + y] != -1)
+        continue;
+      label++;
+      g->labels[x * height + y] = label;
+      g->queue[tail++] = PACK_XY(x, y);
+      while (head < tail)
+      {
+        int cur = g->queue[head++];
+        int cx = UNPACK_X(cur);
+        int cy = UNPACK_Y(cur);
+        int d;
+
+        for (d = 0; d < 8; d++)
+        {
+          int nx = cx + dir_x[d];
+          int ny = cy + dir_y[d];
+          int next;
+
+          if ((nx < 0) || (ny < 0) || (nx >= width) || (ny >= height))
+            continue;
+          next = nx * height + ny;
+          if (g->labels[next] == -1)
+          {
+            g->labels[next] = label;
+            g->queue[tail++] = PACK_XY(nx, ny);
+          }
+        }
+      }
+      if (tail > largest_size)
+      {
+        largest_size = tail;
+        largest = label;
+      }
+    }
+  }
+
+  return largest;
+}
+
+/* digs the shortest way from the cell to the region through whatever is in between
+ * the dug cells become part of the region
+ * the scratch holds the direction each cell was reached from
+ */
+static void
+tunnel_to_region(mapgen *g, int x, int y, int region)
+{
+  int width = g->width;
+  int height = g->height;
+  int head = 0;
+  int tail = 0;
+  int found = -1;
+
+  memset(g->scratch, 0, width * height);
+  g->scratch[x * height + y] = 0xff;
+  g->queue[tail++] = PACK_XY(x, y);
+  while ((head < tail) && (found < 0))
+  {
+    int cur = g->queue[head++];
+    int cx = UNPACK_X(cur);
+    int cy = UNPACK_Y(cur);
+    int d;
+
+    /* cardinal steps only so the tunnel is walkable without cutting corners */
+    for (d = 0; d < 4; d++)
+    {
+      int nx = cx + dir_x[d];
+      int ny = cy + dir_y[d];
+      int next;
+
+      if ((nx <= 0) || (ny <= 0) || (nx >= width - 1) || (ny >= height - 1))
+        continue;
+      next = nx * height + ny;
+      if (g->scratch[next])
+        continue;
+      g->scratch[next] = (unsigned char) (d + 1);
+      if (g->labels[next] == region)
+      {
+        found = PACK_XY(nx, ny);
+        break;
+      }
+      g->queue[tail++] = PACK_XY(nx, ny);
+    }
+  }
+  if (found < 0)
+    return;
+
+  /* walk back to the start */
+  x = UNPACK_X(found);
+  y = UNPACK_Y(found);
+  while (g->scratch[x * height + y] != 0xff)
+  {
+    int d = g->scratch[x * height + y] - 1;
+
+    if (IS_WALL(CELL(g, x, y)))
+      CELL(g, x, y) = g->floor;
+    g->labels[x * height + y] = region;
+    x -= dir_x[d];
+    y -= dir_y[d];
+  }
+}
+
+/* clears the stairs, joins them to the largest region
+ * and fills whatever can not be reached from them
+ */
+static void
+connect_level(mapgen *g, int entry_x, int entry_y, int exit_x, int exit_y)
+{
+  int area = g->width * g->height;
+  int region;
+  int entry_region;
+  int exit_region;
+  int i;
+
+  fill_rect(g, entry_x - 1, entry_y - 1, 3, 3, g->floor);
+  if (exit_x >= 0)
+    fill_rect(g, exit_x - 1, exit_y - 1, 3, 3, g->floor);
+
+  region = label_regions(g);
+  entry_region = g->labels[entry_x * g->height + entry_y];
+  exit_region = (exit_x >= 0) ? g->labels[exit_x * g->height + exit_y] : region;
+  if (entry_region != region)
+    tunnel_to_region(g, entry_x, entry_y, region);
+  if (exit_region != region && exit_region != entry_region)
+    tunnel_to_region(g, exit_x, exit_y, region);
+
+  for (i = 0; i < area; i++)
+  {
+    int label = g->labels[i];
+
+    if ((label != 0) && (label != region) && (label != entry_region) && (label != exit_region))
+      g->cells[i] = g->wall;
+  }
+}
+
+/* the cells of every chunk, uniform chunks are marked so they need not be copied */
+static void
+pack_chunks(mapgen *g)
+{
+  int shift = g->chunk_shift;
+  int size = 1 << shift;
+  int chunk_area = size * size;
+  int cx;
+  int cy;
+
+  for (cy = 0; cy < g->chunks_high; cy++)
+  {
+    for (cx = 0; cx < g->chunks_wide; cx++)
+    {
+      int idx = cy * g->chunks_wide + cx;
+      unsigned char *chunk = g->chunks + idx * chunk_area;
+      int x0 = cx << shift;
+      int y0 = cy << shift;
+      int w = (x0 + size > g->width) ? g->width - x0 : size;
+      int h = (y0 + size > g->height) ? g->height - y0 : size;
+      unsigned char first = CELL(g, x0, y0);
+      int uniform = 1;
+      int x;
+      int y;
+
+      /* cells past the edge of the level take the value of the first one */
+      if ((w < size) || (h < size))
+        memset(chunk, first, chunk_area);
+      for (x = 0; x < w; x++)
+      {
+        const unsigned char *col = g->cells + (x0 + x) * g->height + y0;
+
+        memcpy(chunk + (x << shift), col, h);
+        for (y = 0; (y < h) && uniform; y++)
+          uniform = col[y] == first;
+      }
+      g->uniform[idx] = uniform ? first : -1;
+    }
+  }
+}
+
+/* generates a level of the kind into the chunks
+ * the entry and exit are kept inside the level and reachable from each other,
+ * an exit at a negative x is left out
+ * returns 0 on invalid arguments
+ */
+int
+mapgen_generate(mapgen *g, int kind, uint32_t seed_lo, uint32_t seed_hi,
+                int entry_x, int entry_y, int exit_x, int exit_y, int stairs)
+{
+  if ((entry_x < 2) || (entry_y < 2) || (entry_x >= g->width - 2) || (entry_y >= g->height - 2))
+    return 0;
+  if ((exit_x >= 0)
+      && ((exit_x < 2) || (exit_y < 2) || (exit_x >= g->width - 2) || (exit_y >= g->height - 2)))
+    return 0;
+
+  g->r = rng_create(RNG_XOSHIRO256, seed_lo, seed_hi, RNG_POOL_SIZE);
+  if (g->r == NULL)
+    return 0;
+  g->pool_pos = RNG_POOL_SIZE;
+
+  switch (kind)
+  {
+  case MAP_ROOMS:
+    generate_rooms(g);
+    break;
+  case MAP_CAVES:
+    generate_caves(g);
+    break;
+  case MAP_VILLAGE:
+    generate_village(g);
+    break;
+  default:
+    rng_free(g->r);
+    g->r = NULL;
+    return 0;
+  }
+  connect_level(g, entry_x, entry_y, exit_x, exit_y);
+  if (stairs & STAIRS_UP)
+    CELL(g, entry_x, entry_y) = T_UPSTAIRS;
+  if ((exit_x >= 0) && (stairs & STAIRS_DOWN))
+    CELL(g, exit_x, exit_y) = T_DOWNSTAIRS;
+  pack_chunks(g);
+
+  rng_free(g->r);
+  g->r = NULL;
+
+  return 1;
+}
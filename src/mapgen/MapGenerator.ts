@@ -0,0 +1,150 @@
+import { ByteChunks, chunkArea, chunkShift } from "../Chunks";
+import { Point } from "../geometry";
+import { Fnv1a } from "../hash";
+import { Profiler, ProfileZone } from "../Profiler";
+import { TerrainKind } from "../Terrain";
+
+type MapgenPtr = number;
+
+interface MapgenModule extends EmscriptenModule {
+    _mapgen_create(width: number, height: number, chunkShift: number): MapgenPtr;
+    _mapgen_free(g: MapgenPtr): void;
+    _mapgen_generate(
+        g: MapgenPtr, kind: number, seedLo: number, seedHi: number,
+        entryX: number, entryY: number, exitX: number, exitY: number, stairs: number
+    ): number;
+    _mapgen_chunks(g: MapgenPtr): number;
+    _mapgen_uniform(g: MapgenPtr): number;
+}
+
+declare const Module: MapgenModule;
+
+const NULL = 0;
+const twoPow32 = 0x100000000;
+const sizeofInt32 = Int32Array.BYTES_PER_ELEMENT;
+// the stairs keep this far from the edges so the village palisade stays closed
+const stairsMargin = 5;
+
+// must match map_kind in mapgen.c
+export enum MapKind {
+    Rooms,
+    Caves,
+    Village
+}
+
+// must match STAIRS_UP and STAIRS_DOWN in mapgen.c
+const enum Stairs {
+    Up = 1,
+    Down = 2
+}
+
+// everything a level is generated from, the same plan always gives the same level
+export interface LevelPlan {
+    readonly kind: MapKind;
+    readonly seedLo: number;
+    readonly seedHi: number;
+    // the upstairs, or where the player starts on the first level
+    readonly entry: Point;
+    // the downstairs, null on the last level
+    readonly exit: Point | null;
+    readonly hasUpstairs: boolean;
+}
+
+function hashWords(...words: Array<number>): number {
+    const hash = new Fnv1a();
+    for (const word of words) {
+        hash.u32(word);
+    }
+    return hash.value;
+}
+
+function seedWords(seed: number): [number, number] {
+    return [seed >>> 0, Math.floor(seed / twoPow32) >>> 0];
+}
+
+function randomPoint(seed: number, depth: number, width: number, height: number): Point {
+    const [lo, hi] = seedWords(seed);
+    return {
+        x: stairsMargin + hashWords(lo, hi, depth, 0) % (width - 2 * stairsMargin),
+        y: stairsMargin + hashWords(lo, hi, depth, 1) % (height - 2 * stairsMargin)
+    };
+}
+
+// The downstairs of a level and the upstairs of the one below are on the same cell,
+// so the stairs of every level follow from the game seed without generating the ones above.
+function stairsBelow(seed: number, depth: number, width: number, height: number): Point {
+    // close stairs are moved to the opposite side of the level
+    const minDistance = Math.floor(Math.min(width, height) / 3);
+    let above = randomPoint(seed, -1, width, height);
+    let stairs = above;
+    for (let d = 0; d <= depth; d++) {
+        stairs = randomPoint(seed, d, width, height);
+        if (Math.max(Math.abs(stairs.x - above.x), Math.abs(stairs.y - above.y)) < minDistance) {
+            stairs = {x: width - 1 - stairs.x, y: height - 1 - stairs.y};
+        }
+        above = stairs;
+    }
+    return stairs;
+}
+
+export function planLevel(seed: number, depth: number, numLevels: number, width: number, height: number): LevelPlan {
+    const [lo, hi] = seedWords(seed);
+    return {
+        kind: depth === 0 ? MapKind.Village : depth % 2 === 1 ? MapKind.Rooms : MapKind.Caves,
+        seedLo: hashWords(lo, hi, depth, 2),
+        seedHi: hashWords(lo, hi, depth, 3),
+        entry: depth === 0 ? randomPoint(seed, -1, width, height) : stairsBelow(seed, depth - 1, width, height),
+        exit: depth < numLevels - 1 ? stairsBelow(seed, depth, width, height) : null,
+        hasUpstairs: depth > 0
+    };
+}
+
+// Generates levels of one size in wasm.
+// The buffers of the generator are reused, so generating a level allocates
+// only the chunks of it that are not a single kind of terrain.
+export class MapGenerator {
+    private ptr: MapgenPtr = NULL;
+
+    constructor(public readonly width: number, public readonly height: number) {
+        if ((this.ptr = Module._mapgen_create(width, height, chunkShift)) === NULL) {
+            throw new Error("Failed to allocate map generator");
+        }
+    }
+
+    public generate(plan: LevelPlan): ByteChunks {
+        if (this.ptr === NULL) {
+            throw new Error("Trying to use disposed MapGenerator");
+        }
+        Profiler.begin(ProfileZone.Mapgen);
+        const {entry, exit} = plan;
+        const stairs = (plan.hasUpstairs ? Stairs.Up : 0) | (exit !== null ? Stairs.Down : 0);
+        const ok = Module._mapgen_generate(
+            this.ptr, plan.kind, plan.seedLo, plan.seedHi,
+            entry.x, entry.y, exit !== null ? exit.x : -1, exit !== null ? exit.y : -1, stairs
+        );
+        if (ok === 0) {
+            Profiler.end(ProfileZone.Mapgen);
+            throw new Error("Invalid level plan");
+        }
+        const terrain = new ByteChunks(this.width, this.height, TerrainKind.StoneWall);
+        // read after generating, the heap may have grown in between
+        const chunks = Module._mapgen_chunks(this.ptr);
+        const uniformOffset = Module._mapgen_uniform(this.ptr) / sizeofInt32;
+        const uniform = Module.HEAP32.subarray(uniformOffset, uniformOffset + terrain.numChunks);
+        for (let i = 0; i < terrain.numChunks; i++) {
+            if (uniform[i] >= 0) {
+                terrain.setUniform(i, uniform[i]);
+            } else {
+                const start = chunks + i * chunkArea;
+                terrain.setChunk(i, Module.HEAPU8.slice(start, start + chunkArea));
+            }
+        }
+        Profiler.end(ProfileZone.Mapgen);
+        return terrain;
+    }
+
+    public dispose() {
+        Module._mapgen_free(this.ptr);
+        this.ptr = NULL;
+    }
+}
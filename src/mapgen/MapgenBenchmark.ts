@@ -0,0 +1,44 @@
+import { MapGenerator, MapKind, planLevel } from "./MapGenerator";
+
+export interface MapgenBenchmarkResult {
+    readonly kind: string;
+    readonly size: string;
+    readonly msPerLevel: number;
+    // chunks that are not a single kind of terrain
+    readonly allocatedChunks: number;
+    readonly totalChunks: number;
+}
+
+// milliseconds per generated level for every kind of map at a few sizes
+export function benchmarkMapgen(
+    sizes: Array<number> = [100, 250, 500, 1000],
+    levelsPerSize: number = 10,
+    seed: number = 1
+): Array<MapgenBenchmarkResult> {
+    const results: Array<MapgenBenchmarkResult> = [];
+    const kinds = [MapKind.Rooms, MapKind.Caves, MapKind.Village];
+    for (const size of sizes) {
+        const generator = new MapGenerator(size, size);
+        for (const kind of kinds) {
+            let allocatedChunks = 0;
+            let totalChunks = 0;
+            const start = performance.now();
+            for (let depth = 0; depth < levelsPerSize; depth++) {
+                const plan = {...planLevel(seed, depth, levelsPerSize, size, size), kind};
+                const terrain = generator.generate(plan);
+                allocatedChunks += terrain.numAllocated;
+                totalChunks += terrain.numChunks;
+            }
+            const elapsed = performance.now() - start;
+            results.push({
+                kind: MapKind[kind],
+                size: `${size}x${size}`,
+                msPerLevel: elapsed / levelsPerSize,
+                allocatedChunks,
+                totalChunks
+            });
+        }
+        generator.dispose();
+    }
+    return results;
+}
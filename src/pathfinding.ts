@@ -1,26 +1,113 @@
+import { ByteReader, ByteWriter } from "./ByteBuffer";
+import { ByteChunks } from "./Chunks";
 import { Location } from "./components/Location";
 import { DungeonLevel } from "./DungeonLevel";
 import { cardinalDirections, manhattanDistance, ordinalDirections, principalDirections, Vec2 } from "./geometry";
-import { Grid } from "./Grid";
 import { PriorityQueue } from "./PriorityQueue";
+import { ProfileCounter, Profiler, ProfileZone } from "./Profiler";
 import { Queue } from "./Queue";
 import { Random } from "./Random";
 import { assertDefined, assertNotNull } from "./utils";
-import { Vec2HashMap } from "./Vec2HashMap";
 
-export class Pathmap extends Grid {
-    private static readonly defaultValue: number = 255;
-    private static readonly biasedDirections = ordinalDirections.concat(cardinalDirections, [0, 0]);
-    private readonly map: Uint8Array;
+// distance of the cells the flood did not reach
+export const unreachedDistance = 255;
+// the largest distance that fits in a byte below unreachedDistance
+const maxDistance = unreachedDistance - 1;
+// the order stepTowards tries the neighbours in, diagonals first
+export const stepDirections: Array<Vec2> = ordinalDirections.concat(cardinalDirections);
+
+export interface Walkable {
+    travelable(x: number, y: number): boolean;
+}
+
+// distances to a target as flooded by floodDistances
+export interface Distances {
+    withinBounds(x: number, y: number): boolean;
+    distanceAt(x: number, y: number): number;
+}
+
+// what floodDistances fills in, every cell has to start at unreachedDistance
+export interface DistanceGrid {
+    withinBounds(x: number, y: number): boolean;
+    get(x: number, y: number): number;
+    set(x: number, y: number, value: number): void;
+}
+
+// Breadth first distances to the target, the cells next to it are at distance 0.
+// Shared by Pathmap and the AI workers so both see the same distances.
+// Returns true if the flood got back to the target.
+export function floodDistances(grid: DistanceGrid, walkable: Walkable, tx: number, ty: number): boolean {
+    Profiler.begin(ProfileZone.Pathmap);
+    Profiler.count(ProfileCounter.PathCalls);
+    let reachesTarget = false;
+    let expanded = 0;
+    const start: Vec2 = [tx, ty];
+    const frontier = new Queue<Vec2>();
+    frontier.enqueue(start);
+
+    while (!frontier.isEmpty()) {
+        const [curx, cury] = frontier.dequeue();
+        expanded++;
+
+        for (const nextDir of principalDirections) {
+            const nx = curx + nextDir[0];
+            const ny = cury + nextDir[1];
+            if (nx === tx && ny === ty) {
+                reachesTarget = true;
+                grid.set(nx, ny, 0);
+            } else if (grid.withinBounds(nx, ny) && walkable.travelable(nx, ny)) {
+                const nextVal = grid.get(nx, ny);
+                // the cells next to the target are at distance 0
+                const curVal = curx === tx && cury === ty ? -1 : grid.get(curx, cury);
+                if (nextVal === unreachedDistance && curVal < maxDistance) {
+                    grid.set(nx, ny, curVal + 1);
+                    frontier.enqueue([nx, ny]);
+                }
+            }
+        }
+    }
+    Profiler.count(ProfileCounter.CellsExpanded, expanded);
+    Profiler.end(ProfileZone.Pathmap);
+    return reachesTarget;
+}
+
+// the neighbour of x, y closest to the target, the target itself if it is next to x, y
+// ties go to the later of the stepDirections
+export function stepTowards(distances: Distances, walkable: Walkable, x: number, y: number, tx: number, ty: number): Vec2 | null {
+    let bestVal: number = Infinity;
+    let bestDir: Vec2 | null = null;
+    for (const dir of stepDirections) {
+        const dx = x + dir[0];
+        const dy = y + dir[1];
+        if (dx === tx && dy === ty) {
+            return dir;
+        } else if (distances.withinBounds(dx, dy)) {
+            const val = distances.distanceAt(dx, dy);
+            if (val <= bestVal && walkable.travelable(dx, dy)) {
+                bestVal = val;
+                bestDir = dir;
+            }
+        }
+    }
+    return bestDir;
+}
+
+// Distances to the target, only the chunks the search reaches are allocated.
+// The search stops at the largest distance that fits in a byte,
+// which also bounds the memory used on open levels.
+export class Pathmap implements Distances {
+    private readonly map: ByteChunks;
     private reachesTarget_: boolean = false;
 
     constructor(
         width: number, height: number,
         private readonly target: Location
     ) {
-        super(width, height);
-        this.map = new Uint8Array(width * height);
-        this.map.fill(Pathmap.defaultValue);
+        this.map = new ByteChunks(width, height, unreachedDistance);
+    }
+
+    public withinBounds(x: number, y: number): boolean {
+        return this.map.withinBounds(x, y);
     }
 
     public get reachesTarget(): boolean {
@@ -31,86 +118,46 @@ export class Pathmap extends Grid {
         this.reachesTarget_ = false;
         const level = this.target.dungeonLevel;
         if (level === null) { return; }
-        this.map.fill(Pathmap.defaultValue);
+        this.map.reset();
         const tx = assertNotNull(this.target.x);
         const ty =  assertNotNull(this.target.y);
-        const start: Vec2 = [tx, ty];
-        const frontier = new Queue<Vec2>();
-        frontier.enqueue(start);
-
-        while (!frontier.isEmpty()) {
-            const [curx, cury] = frontier.dequeue();
-            
-            for (const nextDir of principalDirections) {
-                const nx = curx + nextDir[0];
-                const ny = cury + nextDir[1];
-                if (nx === tx && ny === ty) {
-                    this.reachesTarget_ = true;
-                    this.map[this.index(nx, ny)] = 0;
-                } else if (this.withinBounds(nx, ny) && level.travelable(nx, ny)) {
-                    const nextIdx = this.index(nx, ny);
-                    const nextVal = this.map[nextIdx];
-                    if (nextVal === Pathmap.defaultValue) {
-                        const curIdx = this.index(curx, cury);
-                        const curVal = this.map[curIdx];
-                        this.map[nextIdx] = curVal + 1;
-                        frontier.enqueue([nx, ny]);
-                    }
-                }
-            }
-        }
-    }
-
-    public getNextDirection(x: number, y: number): Vec2 | null {
-        const level = assertNotNull(this.target.dungeonLevel);
-        const tx = assertNotNull(this.target.x);
-        const ty =  assertNotNull(this.target.y);
-        let bestVal: number = Infinity;
-        let bestDir: Vec2 | null = null;
-        for (const dir of Pathmap.biasedDirections) {
-            const dx = x + dir[0];
-            const dy = y + dir[1];
-            if (dx === tx && dy === ty) {
-                return dir;
-            } else if (this.withinBounds(dx, dy)) {
-                const val = this.map[this.index(dx, dy)];
-                if (val <= bestVal && level.travelable(dx, dy)) {
-                    bestVal = val;
-                    bestDir = dir;
-                }
-            }
-        }
-        return bestDir;
+        this.reachesTarget_ = floodDistances(this.map, level, tx, ty);
     }
 
     public distanceAt(x: number, y: number): number {
-        return this.map[this.index(x, y)];
+        return this.map.get(x, y);
     }
 }
 
-function reconstructPath(cameFrom: Vec2HashMap<Vec2>, fromx: number, fromy: number, tox: number, toy: number): Array<Vec2> {
+// cells are keyed by their index in the level so any level size works
+function reconstructPath(level: DungeonLevel, cameFrom: Map<number, Vec2>, fromx: number, fromy: number, tox: number, toy: number): Array<Vec2> {
     const path = [];
     let cur: Vec2 = [tox, toy];
     while (!(cur[0] === fromx && cur[1] === fromy)) {
         path.push(cur);
-        const next = cameFrom.get(cur);
+        const next = cameFrom.get(cur[1] * level.width + cur[0]);
         if (next === undefined) { break; }
         cur = next;
     }
     return path.reverse();
 }
 
-function aStar(level: DungeonLevel, fromx: number, fromy: number, tox: number, toy: number): Vec2HashMap<Vec2> {
+function aStar(level: DungeonLevel, fromx: number, fromy: number, tox: number, toy: number): Map<number, Vec2> {
+    const {width} = level;
     const frontier = new PriorityQueue<Vec2>();
-    const cameFrom = new Vec2HashMap<Vec2>();
-    const costs = new Vec2HashMap<number>();
+    const cameFrom: Map<number, Vec2> = new Map();
+    const costs: Map<number, number> = new Map();
     const start: Vec2 = [fromx, fromy];
     frontier.put(start, 0);
-    costs.set(start, 0);
+    costs.set(fromy * width + fromx, 0);
+    Profiler.begin(ProfileZone.AStar);
+    Profiler.count(ProfileCounter.PathCalls);
+    let expanded = 0;
     while (!frontier.isEmpty()) {
         const cur = frontier.pop();
+        expanded++;
         const [curx, cury] = cur;
-        const curCost = assertDefined(costs.get(cur));
+        const curCost = assertDefined(costs.get(cury * width + curx));
         const newCost = curCost + 1;
         if (curx === tox && cury === toy) {
             break;
@@ -119,45 +166,114 @@ function aStar(level: DungeonLevel, fromx: number, fromy: number, tox: number, t
             const nx = curx + nextDir[0];
             const ny = cury + nextDir[1];
             if (level.withinBounds(nx, ny) && level.travelable(nx, ny)) {
-                const next: Vec2 = [nx, ny];
-                if (!costs.has(next) || newCost < assertDefined(costs.get(next))) {
-                    costs.set(next, newCost);
+                const nextIdx = ny * width + nx;
+                const nextCost = costs.get(nextIdx);
+                if (nextCost === undefined || newCost < nextCost) {
+                    costs.set(nextIdx, newCost);
                     const priority = newCost + manhattanDistance(tox, toy, nx, ny);
-                    frontier.put(next, priority);
-                    cameFrom.set(next, cur);
+                    frontier.put([nx, ny], priority);
+                    cameFrom.set(nextIdx, cur);
                 }
             }
         }
     }
+    Profiler.count(ProfileCounter.CellsExpanded, expanded);
+    Profiler.end(ProfileZone.AStar);
     return cameFrom;
 }
 
-// recalculates if bumps into something
-export function* blindPath(level: DungeonLevel, fromx: number, fromy: number, tox: number, toy: number): IterableIterator<Vec2> {
-    let curx = fromx;
-    let cury = fromy;
-    // regenerate paths until at target
-    do {
-        const cameFrom = aStar(level, curx, cury, tox, toy);
-        const path = reconstructPath(cameFrom, curx, cury, tox, toy);
-        const last = path[path.length - 1];
-        const reachesTarget = path.length > 0 && last[0] === tox && last[1] === toy;
-        // standing next to target but it's blocked
-        if (reachesTarget && path.length === 1 && !level.travelable(tox, toy)) {
-            break;
+// Walks to the target, recalculates if bumps into something.
+// Kept as explicit state instead of a generator so that snapshots can save it.
+export class BlindPath {
+    // the path being walked, null until the next one is calculated
+    private path: Array<Vec2> | null = null;
+    private index: number = 0;
+    private reachesTarget: boolean = false;
+    private done: boolean = false;
+
+    constructor(
+        private readonly level: DungeonLevel,
+        private curx: number,
+        private cury: number,
+        private readonly tox: number,
+        private readonly toy: number
+    ) {}
+
+    // the next step or null once the walk is over
+    public next(): Vec2 | null {
+        const {level, tox, toy} = this;
+        // regenerate paths until at target
+        while (!this.done) {
+            if (this.path === null) {
+                const cameFrom = aStar(level, this.curx, this.cury, tox, toy);
+                const path = reconstructPath(level, cameFrom, this.curx, this.cury, tox, toy);
+                const last = path[path.length - 1];
+                this.reachesTarget = path.length > 0 && last[0] === tox && last[1] === toy;
+                // standing next to target but it's blocked
+                if (this.reachesTarget && path.length === 1 && !level.travelable(tox, toy)) {
+                    this.done = true;
+                    break;
+                }
+                this.path = path;
+                this.index = 0;
+            }
+            // go through the path even if it doesn't reach target
+            // stops early if bumped, to recalculate
+            if (this.index < this.path.length) {
+                const next = this.path[this.index];
+                if (level.travelable(next[0], next[1])) {
+                    this.curx = next[0];
+                    this.cury = next[1];
+                    this.index++;
+                    return next;
+                }
+            }
+            // could not find path to target
+            if (!this.reachesTarget || !(this.curx !== tox && this.cury !== toy)) {
+                this.done = true;
+            } else {
+                this.path = null;
+            }
         }
-        // go through the path even if it doesn't reach target
-        for (const next of path) {
-            const [nx, ny] = next;
-            // bumped, recalculate
-            if (!level.travelable(nx, ny)) { break; }
-            curx = nx;
-            cury = ny;
-            yield next;
+        return null;
+    }
+
+    public save(writer: ByteWriter) {
+        writer.u16(this.curx);
+        writer.u16(this.cury);
+        writer.u16(this.tox);
+        writer.u16(this.toy);
+        writer.u8(this.reachesTarget ? 1 : 0);
+        writer.u8(this.done ? 1 : 0);
+        // only the steps left, -1 if there is no path yet
+        const path = this.path;
+        writer.i32(path === null ? -1 : path.length - this.index);
+        if (path !== null) {
+            for (let i = this.index; i < path.length; i++) {
+                writer.u16(path[i][0]);
+                writer.u16(path[i][1]);
+            }
+        }
+    }
+
+    public static restore(level: DungeonLevel, reader: ByteReader): BlindPath {
+        const curx = reader.u16();
+        const cury = reader.u16();
+        const tox = reader.u16();
+        const toy = reader.u16();
+        const walk = new BlindPath(level, curx, cury, tox, toy);
+        walk.reachesTarget = reader.u8() !== 0;
+        walk.done = reader.u8() !== 0;
+        const steps = reader.i32();
+        if (steps >= 0) {
+            const path: Array<Vec2> = [];
+            for (let i = 0; i < steps; i++) {
+                path.push([reader.u16(), reader.u16()]);
+            }
+            walk.path = path;
         }
-        // could not find path to target
-        if (!reachesTarget) { break; }
-    } while (curx !== tox && cury !== toy);
+        return walk;
+    }
 }
 
 export function drunkWalk(rng: Random, level: DungeonLevel, fromx: number, fromy: number): Vec2 | null {
@@ -0,0 +1,85 @@
+import { ByteChunks, chunkArea } from "./Chunks";
+
+const maxRunLength = 255;
+
+const enum ChunkEncoding {
+    Uniform,
+    RunLength
+}
+
+function countRuns(cells: Uint8Array): number {
+    let numRuns = 0;
+    let run = 0;
+    for (let i = 0; i < cells.length; i++) {
+        if (run === 0 || cells[i] !== cells[i - 1] || run >= maxRunLength) {
+            numRuns++;
+            run = 0;
+        }
+        run++;
+    }
+    return numRuns;
+}
+
+// run-length encodes the chunks in order
+// a uniform chunk is (Uniform, value), any other (RunLength, ...(value, length) byte pairs)
+export function encodeChunks(chunks: ByteChunks): Uint8Array {
+    let size = 0;
+    for (let c = 0; c < chunks.numChunks; c++) {
+        const cells = chunks.chunk(c);
+        size += cells === undefined ? 2 : 1 + countRuns(cells) * 2;
+    }
+    const encoded = new Uint8Array(size);
+    let i = 0;
+    for (let c = 0; c < chunks.numChunks; c++) {
+        const cells = chunks.chunk(c);
+        if (cells === undefined) {
+            encoded[i++] = ChunkEncoding.Uniform;
+            encoded[i++] = chunks.uniformValue(c);
+            continue;
+        }
+        encoded[i++] = ChunkEncoding.RunLength;
+        let run = 0;
+        for (let j = 0; j < cells.length; j++) {
+            if (run === 0 || cells[j] !== cells[j - 1] || run >= maxRunLength) {
+                if (run > 0) {
+                    encoded[i++] = cells[j - 1];
+                    encoded[i++] = run;
+                }
+                run = 0;
+            }
+            run++;
+        }
+        encoded[i++] = cells[cells.length - 1];
+        encoded[i++] = run;
+    }
+    return encoded;
+}
+
+export function decodeChunks(encoded: Uint8Array, chunks: ByteChunks) {
+    let i = 0;
+    for (let c = 0; c < chunks.numChunks; c++) {
+        if (i >= encoded.length) {
+            throw new Error("Encoded data does not match the number of chunks");
+        }
+        if (encoded[i++] === ChunkEncoding.Uniform) {
+            chunks.setUniform(c, encoded[i++]);
+            continue;
+        }
+        const cells = new Uint8Array(chunkArea);
+        let j = 0;
+        while (j < chunkArea) {
+            const value = encoded[i];
+            const run = encoded[i + 1];
+            if (run === 0 || j + run > chunkArea) {
+                throw new Error("Invalid run in encoded chunk");
+            }
+            cells.fill(value, j, j + run);
+            j += run;
+            i += 2;
+        }
+        chunks.setChunk(c, cells);
+    }
+    if (i !== encoded.length) {
+        throw new Error("Encoded data does not match the number of chunks");
+    }
+}
@@ -0,0 +1,169 @@
+/*
+Pooled pseudo random number generators.
+A whole pool of 32 bit numbers is generated at once
+and drained by the caller one number at a time.
+
+xoshiro256** by David Blackman and Sebastiano Vigna
+PCG32 (XSH RR) by Melissa O'Neill
+*/
+
+/* malloc, free */
+#include <stdlib.h>
+/* uint32_t, uint64_t */
+#include <stdint.h>
+
+enum rng_kind
+{
+  RNG_XOSHIRO256 = 0,
+  RNG_PCG32 = 1
+};
+
+typedef struct rng
+{
+  /* xoshiro uses all four words, pcg uses the state and the increment */
+  uint64_t s[4];
+  int kind;
+  int pool_size;
+  uint32_t *pool;
+} rng;
+
+static uint64_t
+splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+}
+
+static uint64_t
+rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/* upper half of the 64 bit output, the lower bits are the weakest */
+static uint32_t
+xoshiro256_next(uint64_t *s)
+{
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return (uint32_t) (result >> 32);
+}
+
+static uint32_t
+pcg32_next(uint64_t *s)
+{
+  uint64_t old = s[0];
+  uint32_t xorshifted;
+  uint32_t rot;
+
+  s[0] = old * 6364136223846793005ULL + s[1];
+  xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+  rot = (uint32_t) (old >> 59);
+
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+rng *
+rng_create(int kind, uint32_t seed_lo, uint32_t seed_hi, int pool_size)
+{
+  rng *r = NULL;
+  uint64_t x = ((uint64_t) seed_hi << 32) | seed_lo;
+  int i;
+
+  if ((kind != RNG_XOSHIRO256) && (kind != RNG_PCG32))
+    return NULL;
+  if (pool_size <= 0)
+    return NULL;
+
+  r = (rng *) malloc(sizeof(rng));
+  if (r == NULL)
+    return NULL;
+  r->pool = (uint32_t *) malloc(sizeof(uint32_t) * pool_size);
+  if (r->pool == NULL)
+  {
+    free(r);
+    return NULL;
+  }
+  r->kind = kind;
+  r->pool_size = pool_size;
+
+  for (i = 0; i < 4; i++)
+    r->s[i] = splitmix64(&x);
+  if (kind == RNG_PCG32)
+  {
+    /* same as pcg32_srandom(initstate, initseq) */
+    uint64_t initstate = r->s[0];
+
+    r->s[0] = 0;
+    r->s[1] = (r->s[1] << 1) | 1;
+    r->s[2] = 0;
+    r->s[3] = 0;
+    pcg32_next(r->s);
+    r->s[0] += initstate;
+    pcg32_next(r->s);
+  }
+
+  return r;
+}
+
+void
+rng_free(rng *r)
+{
+  if (r == NULL)
+    return;
+  free(r->pool);
+  free(r);
+}
+
+uint32_t *
+rng_pool(rng *r)
+{
+  return r->pool;
+}
+
+/* the generator state as eight 32 bit words */
+uint32_t *
+rng_state(rng *r)
+{
+  return (uint32_t *) r->s;
+}
+
+void
+rng_fill(rng *r)
+{
+  uint32_t *pool = r->pool;
+  uint64_t s[4];
+  int i;
+
+  /* a local copy keeps the state in registers */
+  s[0] = r->s[0];
+  s[1] = r->s[1];
+  s[2] = r->s[2];
+  s[3] = r->s[3];
+  if (r->kind == RNG_XOSHIRO256)
+  {
+    for (i = 0; i < r->pool_size; i++)
+      pool[i] = xoshiro256_next(s);
+  }
+  else
+  {
+    for (i = 0; i < r->pool_size; i++)
+      pool[i] = pcg32_next(s);
+  }
+  r->s[0] = s[0];
+  r->s[1] = s[1];
+  r->s[2] = s[2];
+  r->s[3] = s[3];
+}
@@ -20,3 +20,20 @@ declare type Sprite = {
   w: number;
   h: number;
 };
+
+declare const enum SpriteId {
+  sprite = 0,
+  downstairs = 1,
+  upstairs = 2,
+  human_male2 = 3,
+  puny8x10 = 4,
+  goblin = 5,
+  trinket = 6,
+  sasquatch = 7,
+  dirt = 8,
+  planks = 9,
+  grass = 10,
+  stonewall = 11,
+  palisade = 12,
+  NUM_SPRITES = 13
+}
@@ -0,0 +1,31 @@
+/* generated by scripts/gen_terrain.js from resources/terrain.json, do not edit */
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+/* TerrainKind in terrainKinds.ts */
+enum terrain_kind
+{
+  T_STONE_WALL = 0,
+  T_WOOD_WALL = 1,
+  T_PALISADE = 2,
+  T_STONE_FLOOR = 3,
+  T_WOOD_FLOOR = 4,
+  T_GRASS = 5,
+  T_DIRT = 6,
+  T_UPSTAIRS = 7,
+  T_DOWNSTAIRS = 8
+};
+
+#define TERRAIN_KINDS 9
+#define TERRAIN_TABLE_SIZE 256
+#define TERRAIN_OPAQUE 1
+#define TERRAIN_BLOCKS_MOVEMENT 2
+
+/* flags of every terrain kind, unused kinds have none */
+static const unsigned char terrain_flags[TERRAIN_TABLE_SIZE] =
+{
+  3, 3, 3, 0, 0, 0, 0, 0, 0
+};
+
+#endif
@@ -0,0 +1,21 @@
+// generated by scripts/gen_terrain.js from resources/terrain.json, do not edit
+
+export enum TerrainKind {
+    StoneWall,
+    WoodWall,
+    Palisade,
+    StoneFloor,
+    WoodFloor,
+    Grass,
+    Dirt,
+    Upstairs,
+    Downstairs
+}
+
+export const enum TerrainFlag {
+    Opaque = 1,
+    BlocksMovement = 2
+}
+
+// flags of every terrain kind, indexed by kind
+export const terrainFlags = new Uint8Array([3, 3, 3, 0, 0, 0, 0, 0, 0]);
@@ -274,3 +274,25 @@ export function v<T extends TagName>(
 ): VirtualNode<T> {
     return new VirtualNodeImpl(tagName, attrsOrChildren, children);
 }
+
+// a virtual node as plain data, so a menu built in a worker can be shown by the main thread
+export interface SerializedNode {
+    readonly tagName: TagName;
+    readonly className: string;
+    readonly text: string | null;
+    readonly children: Array<SerializedNode>;
+}
+
+export function serializeNode(node: VirtualNode<any>): SerializedNode {
+    return {
+        tagName: node.tagName,
+        className: node.attrs.classList.value,
+        text: node.text,
+        children: node.children.map(serializeNode)
+    };
+}
+
+export function deserializeNode(data: SerializedNode): VirtualNode<any> {
+    const attrs = data.className === "" ? {} : {class: data.className};
+    return v(data.tagName, attrs, data.text !== null ? data.text : data.children.map(deserializeNode));
+}
@@ -0,0 +1,36 @@
+// Picks the build of the wasm kernels before main.js runs.
+// ?wasm=size|release|simd|check overrides the choice, otherwise the SIMD build is used
+// where the browser validates SIMD instructions and the release build elsewhere.
+// The glue fills in this Module when it loads, main.js waits for onRuntimeInitialized.
+var Module = {};
+// the chosen build, the game worker loads the same one
+var wasmBuild = null;
+
+(function () {
+    var builds = {
+        size: "digital-fov.js",
+        release: "digital-fov-release.js",
+        simd: "digital-fov-simd.js",
+        check: "digital-fov-check.js"
+    };
+    // a function returning i8x16.splat(0) turned into a v128
+    var simdProbe = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+        10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+    ]);
+
+    function detect() {
+        try {
+            return WebAssembly.validate(simdProbe) ? "simd" : "release";
+        } catch (err) {
+            return "release";
+        }
+    }
+
+    var requested = new URLSearchParams(window.location.search).get("wasm");
+    var profile = requested !== null && builds.hasOwnProperty(requested) ? requested : detect();
+    wasmBuild = builds[profile];
+    var script = document.createElement("script");
+    script.src = wasmBuild;
+    document.head.appendChild(script);
+})();